@@ -0,0 +1,167 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+#ifndef _PM_BYTECODE_H_
+#define _PM_BYTECODE_H_
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include "pmTensor.h"
+
+namespace Nauticle {
+	class pmExpression;
+	class pmField;
+	class pmParticle_system;
+
+	/** This class represents an expression tree lowered into a flat register program.
+	//  The program is executed for a block of consecutive nodes at once. Registers
+	//  have a fixed shape determined at compile time and store their elements for the
+	//  whole block contiguously (element by element), hence each instruction reduces
+	//  to simple loops over the nodes of the block. Registers depending only on constants
+	//  and variables are uniform: they are stored and computed once per block.
+	//  Expressions which cannot be lowered make the emitter functions return -1.
+	//  The program can also be translated to C++ source for runtime compilation. The
+	//  generated kernel receives the raw data of the bound fields and the single values
+	//  (see bind) and writes the result and the condition of each node into contiguous
+	//  arrays.
+	//  Interactions are lowered only if it is requested at construction. SPH operators
+	//  with field and single operands become neighbour sums, which are generated into the
+	//  kernel specialised for the operator type and its template parameters, while the
+	//  neighbours of the block are collected by the particle system. Other interactions
+	//  are evaluated by their own evaluate function into contiguous arrays read by the
+	//  kernel. Empty interaction results are replaced by zeros. If the shape of an
+	//  interaction result differs from its compiled shape, execute and run return false.
+	*/
+	class pmBytecode {
+	public:
+		static constexpr int block_size = 128;
+		using Function = double(*)(double const&);
+		using Kernel = void(*)(int, int, double const* const*, double const*, double const* const*, int const*, int const*, double const*, double const*, Function const*, double*, double*);
+		enum Opcode {LOAD_CONSTANT, LOAD_SINGLE, LOAD_FIELD, NEGATE, ADD, SUBTRACT, SCALE, MATMUL, DIVIDE, TERM_MULTIPLY, TERM_DIVIDE, POWER, TRANSPOSE, MAGNITUDE,
+			ABS, ACOS, ACOT, ASIN, ATAN, COS, COSH, COT, COTH, EXP, FLOOR, LOG, SGN, SIN, SINH, SQRT, TAN, TANH, TRUNC,
+			MIN, MAX, MOD, GT, GTE, LT, LTE, EQUAL, NOTEQUAL, AND, OR, XOR, NOT, IF, LIMIT, INTERACTION, NEIGHBOR_SUM};
+		/** Describes an SPH operator evaluated as a neighbour sum. The operands are
+		//  ordered as B (only for six operands, nullptr otherwise), A, m, rho and h.
+		*/
+		struct pmNeighbor_sum {
+			int type;
+			int variant;
+			int k;
+			int num_operands;
+			bool position;
+			bool symmetric;
+			pmExpression const* operand[5];
+			Function smoothing_radius;
+			Function coefficient;
+			Function shape;
+			pmParticle_system const* psys;
+			pmField const* field[5];
+			int rows[5];
+			int columns[5];
+		};
+		/** Holds the arrays filled by run. The same object can be passed to the consecutive
+		//  calls of a thread, hence the arrays are allocated only when they grow.
+		*/
+		struct pmRun_memory {
+			std::vector<double> value;
+			std::vector<double> condition;
+			std::vector<double const*> field;
+			std::vector<double> single;
+			std::vector<Function> function;
+			std::vector<std::vector<double>> interaction_value;
+			std::vector<double const*> interaction;
+			std::vector<int> neighbor_start;
+			std::vector<int> neighbor_index;
+			std::vector<double> neighbor_rel_pos;
+			std::vector<double> neighbor_guide;
+		};
+	private:
+		struct pmRegister {
+			int rows;
+			int columns;
+			bool uniform;
+			size_t offset;
+		};
+		struct pmInstruction {
+			Opcode opcode;
+			int destination;
+			int source[3];
+			pmExpression const* single;
+			pmField const* field;
+			pmExpression const* interaction;
+			int sum;
+			size_t level;
+			pmTensor constant;
+		};
+		std::vector<pmInstruction> program;
+		std::vector<pmRegister> registers;
+		std::vector<pmNeighbor_sum> sums;
+		size_t memory_size=0;
+		bool interactions=false;
+	private:
+		int add_instruction(Opcode const& opcode, int const& rows, int const& columns, std::vector<int> const& source);
+		int numel(int const& r) const;
+		size_t address(int const& r, int const& e) const;
+		int stride(int const& r) const;
+		template <typename F> void map_unary(pmInstruction const& ins, int const& n, double* memory, F const& func) const;
+		template <typename F> void map_binary(pmInstruction const& ins, int const& n, double* memory, bool const& broadcast, F const& func) const;
+		template <typename F> void map_ternary(pmInstruction const& ins, int const& n, double* memory, F const& func) const;
+		bool execute_instruction(pmInstruction const& ins, int const& first, int const& n, double* memory) const;
+		std::string register_name(int const& r, int const& e) const;
+		std::string generate_instruction(pmInstruction const& ins, int const& e) const;
+		std::string operand_value(pmInstruction const& ins, int const& o, std::string const& node, int const& e) const;
+		void generate_neighbor_sum(std::ostream& os, std::ostream& node, pmInstruction const& ins, int& field_index, size_t& single_index) const;
+		bool evaluate_interaction(pmInstruction const& ins, int const& i, pmTensor& value) const;
+	public:
+		pmBytecode(bool const& lower_interactions=false);
+		int load_constant(pmTensor const& value);
+		int load_single(pmExpression const* single, size_t const& level);
+		int load_field(pmField const* field, size_t const& level);
+		int load_interaction(pmExpression const* interaction, int const& rows, int const& columns, size_t const& level);
+		int load_neighbor_sum(pmExpression const* interaction, pmNeighbor_sum const& sum, size_t const& level);
+		bool is_lowering_interactions() const;
+		int negate(int const& a);
+		int add(int const& a, int const& b);
+		int subtract(int const& a, int const& b);
+		int multiply(int const& a, int const& b);
+		int divide(int const& a, int const& b);
+		int power(int const& a, int const& b);
+		int transpose(int const& a);
+		int magnitude(int const& a);
+		int elementwise(Opcode const& opcode, int const& a);
+		int elementwise(Opcode const& opcode, int const& a, int const& b);
+		int logical(Opcode const& opcode, int const& a, int const& b=-1);
+		int select(int const& condition, int const& a, int const& b);
+		int limit(int const& a, int const& minimum, int const& maximum);
+		bool is_scalar(int const& r) const;
+		size_t get_memory_size() const;
+		size_t get_program_size() const;
+		bool execute(int const& first, int const& n, std::vector<double>& memory) const;
+		pmTensor get_tensor(std::vector<double> const& memory, int const& r, int const& p) const;
+		int get_numel(int const& r) const;
+		pmTensor make_tensor(int const& r, double const* values) const;
+		void bind(std::vector<double const*>& field, std::vector<double>& single) const;
+		bool run(Kernel kernel, int const& start, int const& end, int const& result, pmRun_memory& memory) const;
+		void generate_code(std::ostream& os, std::string const& function_name, int const& result, int const& condition) const;
+	};
+}
+
+#endif //_PM_BYTECODE_H_
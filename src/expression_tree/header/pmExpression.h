@@ -28,6 +28,8 @@
 
 namespace Nauticle {
     class pmParticle_system;
+    class pmBytecode;
+    class pmSph_sweep;
 
     /** This interface represents an algebraic expression as an expression tree.
     */
@@ -49,10 +51,17 @@ namespace Nauticle {
     	virtual void write_to_string(std::ostream& os) const=0;
         virtual bool is_symmetric() const;
         virtual bool is_position() const;
-        virtual void update(size_t const& level=0) {}
+        virtual void update(size_t const& level=0, size_t const& num_threads=1) {}
         virtual bool is_interaction() const;
+        virtual bool is_referencing(std::string const& symbol_name) const;
+        virtual bool is_reading_neighbors(std::string const& symbol_name) const;
         virtual void delete_member(size_t const& i) {}
         virtual void delete_set(std::vector<size_t> const& indices) {}
+        virtual void reorder(std::vector<int> const& order) {}
+        virtual void precompute(size_t const& num_threads) {}
+        virtual void release_precomputed() {}
+        virtual void join_sweep(pmSph_sweep& sweep) {}
+        virtual int compile(pmBytecode& code, size_t const& level=0) const { return -1; }
         virtual int get_precedence() const=0;
     };
 
@@ -22,6 +22,8 @@
 #define _PM_ARITHMFC_H_  
 
 #include "pmOperator.h"
+#include "pmField.h"
+#include "pmBytecode.h"
 #include "pmRandom.h"
 #include "prolog/pLogger.h"
 #include "Color_define.h"
@@ -37,6 +39,8 @@ namespace Nauticle {
 	template <Ari_fn_type ARI_TYPE, size_t S>
 	class pmArithmetic_function final : public pmOperator<S> {
 		std::string op_name;
+		uint32_t stream=0;
+		std::shared_ptr<pmField> id;
 	protected:
 		virtual std::shared_ptr<pmExpression> clone_impl() const override;
 	public:
@@ -47,7 +51,9 @@ namespace Nauticle {
 		pmArithmetic_function& operator=(pmArithmetic_function&& other);
 		~pmArithmetic_function() override {}
 		void print() const override;
+		void set_id(std::shared_ptr<pmField> id_field);
 		pmTensor evaluate(int const&, size_t const& level=0) const override;
+		int compile(pmBytecode& code, size_t const& level=0) const override;
 		std::shared_ptr<pmArithmetic_function> clone() const;
 		void write_to_string(std::ostream& os) const override;
 		virtual int get_precedence() const { return 0; }
@@ -87,9 +93,9 @@ namespace Nauticle {
 			case MOD : op_name="mod"; break;
 			case NOT : op_name="not"; break;
 			case OR : op_name="or"; break;
-			case URAND : op_name="urand"; break;
-			case NRAND : op_name="nrand"; break;
-			case LNRAND : op_name="lnrand"; break;
+			case URAND : op_name="urand"; stream=pmRandom::new_stream(); break;
+			case NRAND : op_name="nrand"; stream=pmRandom::new_stream(); break;
+			case LNRAND : op_name="lnrand"; stream=pmRandom::new_stream(); break;
 			case SGN : op_name="sgn"; break;
 			case SIN : op_name="sin"; break;
 			case SINH : op_name="sinh"; break;
@@ -125,6 +131,8 @@ namespace Nauticle {
 	template <Ari_fn_type ARI_TYPE, size_t S>
 	pmArithmetic_function<ARI_TYPE,S>::pmArithmetic_function(pmArithmetic_function const& other) : pmOperator<S>{other} {
 		this->op_name = other.op_name;
+		this->stream = other.stream;
+		this->id = other.id;
 	}
 
 	/////////////////////////////////////////////////////////////////////////////////////////
@@ -133,6 +141,8 @@ namespace Nauticle {
 	template <Ari_fn_type ARI_TYPE, size_t S>
 	pmArithmetic_function<ARI_TYPE,S>::pmArithmetic_function(pmArithmetic_function&& other) : pmOperator<S>{other} {
 		this->op_name = other.op_name;
+		this->stream = other.stream;
+		this->id = other.id;
 	}
 
 	/////////////////////////////////////////////////////////////////////////////////////////
@@ -178,11 +188,22 @@ namespace Nauticle {
 		this->print_operands();
 	}
 
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Sets the field of the particle identifiers. The random functions are keyed on the
+	/// identifier of the particle instead of its index, hence the numbers do not change
+	/// when the particles are reordered or deleted.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <Ari_fn_type ARI_TYPE, size_t S>
+	void pmArithmetic_function<ARI_TYPE,S>::set_id(std::shared_ptr<pmField> id_field) {
+		id = id_field;
+	}
+
 	/////////////////////////////////////////////////////////////////////////////////////////
 	/// Evaluates artihmetic operator.
 	/////////////////////////////////////////////////////////////////////////////////////////
 	template <Ari_fn_type ARI_TYPE, size_t S>
 	pmTensor pmArithmetic_function<ARI_TYPE,S>::evaluate(int const& i, size_t const& level/*=0*/) const {
+		uint32_t node = (ARI_TYPE==URAND || ARI_TYPE==NRAND || ARI_TYPE==LNRAND) && id ? (uint32_t)id->get_scalar(i) : (uint32_t)i;
 		switch(ARI_TYPE) {
 			case ABS : return abs(this->operand[0]->evaluate(i, level));
 			case ACOS : return acos(this->operand[0]->evaluate(i, level));
@@ -214,9 +235,9 @@ namespace Nauticle {
 			case MOD : return mod(this->operand[0]->evaluate(i, level), this->operand[1]->evaluate(i, level));
 			case NOT : return !tensor_cast<bool>(this->operand[0]->evaluate(i, level));
 			case OR : return (tensor_cast<double>(this->operand[0]->evaluate(i, level)) || tensor_cast<double>(this->operand[1]->evaluate(i, level)));
-			case URAND : return pmRandom::random<pmRandom::UNIFORM>(this->operand[0]->evaluate(i, level), this->operand[1]->evaluate(i, level));
-			case NRAND : return pmRandom::random<pmRandom::NORMAL>(this->operand[0]->evaluate(i, level), this->operand[1]->evaluate(i, level));
-			case LNRAND : return pmRandom::random<pmRandom::LOGNORMAL>(this->operand[0]->evaluate(i, level), this->operand[1]->evaluate(i, level));
+			case URAND : return pmRandom::random<pmRandom::UNIFORM>(this->operand[0]->evaluate(i, level), this->operand[1]->evaluate(i, level), stream, node);
+			case NRAND : return pmRandom::random<pmRandom::NORMAL>(this->operand[0]->evaluate(i, level), this->operand[1]->evaluate(i, level), stream, node);
+			case LNRAND : return pmRandom::random<pmRandom::LOGNORMAL>(this->operand[0]->evaluate(i, level), this->operand[1]->evaluate(i, level), stream, node);
 			case SGN : return sgn(this->operand[0]->evaluate(i, level));
 			case SIN : return sin(this->operand[0]->evaluate(i, level));
 			case SINH : return sinh(this->operand[0]->evaluate(i, level));
@@ -257,6 +278,68 @@ namespace Nauticle {
 		}
 	}
 
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Lowers the function and its operands into the given bytecode. Returns the register
+	/// of the result or -1 if the function cannot be lowered. Functions with side effects
+	/// or random output are never lowered.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <Ari_fn_type ARI_TYPE, size_t S>
+	int pmArithmetic_function<ARI_TYPE,S>::compile(pmBytecode& code, size_t const& level/*=0*/) const {
+		auto op = [&](size_t const& k, size_t const& l) {
+			return k<S ? this->operand[k]->compile(code, l) : -1;
+		};
+		switch(ARI_TYPE) {
+			case ABS : return code.elementwise(pmBytecode::ABS, op(0,level));
+			case ACOS : return code.elementwise(pmBytecode::ACOS, op(0,level));
+			case ACOT : return code.elementwise(pmBytecode::ACOT, op(0,level));
+			case AND : return code.logical(pmBytecode::AND, op(0,level), op(1,level));
+			case ASIN : return code.elementwise(pmBytecode::ASIN, op(0,level));
+			case ATAN : return code.elementwise(pmBytecode::ATAN, op(0,level));
+			case COS : return code.elementwise(pmBytecode::COS, op(0,level));
+			case COSH : return code.elementwise(pmBytecode::COSH, op(0,level));
+			case COT : return code.elementwise(pmBytecode::COT, op(0,level));
+			case COTH : return code.elementwise(pmBytecode::COTH, op(0,level));
+			case EXP : return code.elementwise(pmBytecode::EXP, op(0,level));
+			case FLOOR : return code.elementwise(pmBytecode::FLOOR, op(0,level));
+			case GT : return code.logical(pmBytecode::GT, op(0,level), op(1,level));
+			case GTE : return code.logical(pmBytecode::GTE, op(0,level), op(1,level));
+			case EQUAL : return code.logical(pmBytecode::EQUAL, op(0,level), op(1,level));
+			case NOTEQUAL : return code.logical(pmBytecode::NOTEQUAL, op(0,level), op(1,level));
+			case IF : return code.select(op(0,level), op(1,level), op(2,level));
+			case LOG : return code.elementwise(pmBytecode::LOG, op(0,level));
+			case LT : return code.logical(pmBytecode::LT, op(0,level), op(1,level));
+			case LTE : return code.logical(pmBytecode::LTE, op(0,level), op(1,level));
+			case MAGNITUDE : return code.magnitude(op(0,level));
+			case MAX : return code.elementwise(pmBytecode::MAX, op(0,level), op(1,level));
+			case MIN : return code.elementwise(pmBytecode::MIN, op(0,level), op(1,level));
+			case MOD : return code.elementwise(pmBytecode::MOD, op(0,level), op(1,level));
+			case NOT : return code.logical(pmBytecode::NOT, op(0,level));
+			case OR : return code.logical(pmBytecode::OR, op(0,level), op(1,level));
+			case SGN : return code.elementwise(pmBytecode::SGN, op(0,level));
+			case SIN : return code.elementwise(pmBytecode::SIN, op(0,level));
+			case SINH : return code.elementwise(pmBytecode::SINH, op(0,level));
+			case SQRT : return code.elementwise(pmBytecode::SQRT, op(0,level));
+			case TAN : return code.elementwise(pmBytecode::TAN, op(0,level));
+			case TANH : return code.elementwise(pmBytecode::TANH, op(0,level));
+			case TRANSPOSE : return code.transpose(op(0,level));
+			case TRUNC : return code.elementwise(pmBytecode::TRUNC, op(0,level));
+			case XOR : return code.logical(pmBytecode::XOR, op(0,level), op(1,level));
+			case EULER : return code.add(op(0,0), code.multiply(op(1,0), op(2,0)));
+			case PREDICTOR : return code.add(op(0,0), code.multiply(op(1,0), op(2,0)));
+			case CORRECTOR : return code.add(op(0,1), code.multiply(op(1,0), op(2,0)));
+			case VERLET_R : {
+				int dt = op(3,0);
+				if(!code.is_scalar(dt)) { return -1; }
+				int first = code.add(op(0,0), code.multiply(op(1,0), dt));
+				int second = code.multiply(op(2,0), code.power(dt, code.load_constant(pmTensor{1,1,2})));
+				return code.add(first, code.divide(second, code.load_constant(pmTensor{1,1,2.0})));
+			}
+			case VERLET_V : return code.add(op(0,0), code.divide(code.multiply(code.add(op(1,0), op(1,1)), op(2,0)), code.load_constant(pmTensor{1,1,2.0})));
+			case LIMIT : return code.limit(op(0,level), op(1,level), op(2,level));
+			default : return -1;
+		}
+	}
+
 	/////////////////////////////////////////////////////////////////////////////////////////
 	/// Clone implementation.
 	/////////////////////////////////////////////////////////////////////////////////////////
@@ -22,6 +22,7 @@
 #define _PM_ARITHMOP_H_
     
 #include "pmOperator.h"
+#include "pmBytecode.h"
 #include "prolog/pLogger.h"
 #include "Color_define.h"
 
@@ -43,6 +44,7 @@ namespace Nauticle {
 		~pmArithmetic_operator() override {}
 		void print() const override;
 		pmTensor evaluate(int const&, size_t const& level=0) const override;
+		int compile(pmBytecode& code, size_t const& level=0) const override;
 		std::shared_ptr<pmArithmetic_operator> clone() const;
 		void write_to_string(std::ostream& os) const override;
 		virtual int get_precedence() const override;
@@ -136,6 +138,34 @@ namespace Nauticle {
 		}
 	}
 
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Lowers the arithmetic operator and its operands into the given bytecode. Returns the
+	/// register of the result or -1 if the operator cannot be lowered.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <char ARI_TYPE, size_t S>
+	int pmArithmetic_operator<ARI_TYPE,S>::compile(pmBytecode& code, size_t const& level/*=0*/) const {
+		if(S==1) {
+			if(ARI_TYPE=='+') {
+				return this->operand[0]->compile(code, level);
+			} else if(ARI_TYPE=='-') {
+				return code.negate(this->operand[0]->compile(code, level));
+			}
+			return -1;
+		}
+		int a = this->operand[0]->compile(code, level);
+		int b = this->operand[S-1]->compile(code, level);
+		switch(ARI_TYPE) {
+			case '+' : return code.add(a, b);
+			case '-' : return code.subtract(a, b);
+			case '*' : return code.multiply(a, b);
+			case '/' : return code.divide(a, b);
+			case ':' : return code.elementwise(pmBytecode::TERM_MULTIPLY, a, b);
+			case '^' : return code.power(a, b);
+			case '%' : return code.elementwise(pmBytecode::TERM_DIVIDE, a, b);
+		}
+		return -1;
+	}
+
 	/////////////////////////////////////////////////////////////////////////////////////////
 	/// Clone implementation.
 	/////////////////////////////////////////////////////////////////////////////////////////
@@ -53,6 +53,11 @@ namespace Nauticle {
 		void print_operands() const;
 		void write_operands_to_string(std::ostream& os) const;
 		virtual bool is_interaction() const override;
+		virtual bool is_referencing(std::string const& symbol_name) const override;
+		virtual bool is_reading_neighbors(std::string const& symbol_name) const override;
+		virtual void precompute(size_t const& num_threads) override;
+		virtual void release_precomputed() override;
+		virtual void join_sweep(pmSph_sweep& sweep) override;
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////////////
@@ -193,6 +198,62 @@ namespace Nauticle {
 		}
 		return false;
 	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns true if any of the operands contains the symbol with the given name.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <size_t S>
+	bool pmOperator<S>::is_referencing(std::string const& symbol_name) const {
+		for(auto const& it:operand) {
+			if(it->is_referencing(symbol_name)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns true if any of the operands reads the symbol with the given name at other nodes.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <size_t S>
+	bool pmOperator<S>::is_reading_neighbors(std::string const& symbol_name) const {
+		for(auto const& it:operand) {
+			if(it->is_reading_neighbors(symbol_name)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Precomputes the operands which are evaluated for the whole field at once.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <size_t S>
+	void pmOperator<S>::precompute(size_t const& num_threads) {
+		for(auto const& it:operand) {
+			it->precompute(num_threads);
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Releases the precomputed results of the operands.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <size_t S>
+	void pmOperator<S>::release_precomputed() {
+		for(auto const& it:operand) {
+			it->release_precomputed();
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Passes the sweep to the operands.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <size_t S>
+	void pmOperator<S>::join_sweep(pmSph_sweep& sweep) {
+		for(auto const& it:operand) {
+			it->join_sweep(sweep);
+		}
+	}
 }
  
 #endif //_PM_OPERATOR_H_
\ No newline at end of file
@@ -34,7 +34,7 @@ namespace Nauticle {
 		mutable std::vector<int> count;
 	private:
 		std::shared_ptr<pmExpression> clone_impl() const override;
-		void create_pairs(int const& i, size_t const& level=0);
+		void create_pairs(size_t const& level=0);
 		void remove_unnecessary_pairs(size_t const& level=0);
 		void evaluate_pairs(size_t const& level=0);
 		void count_collisions(size_t const& level=0) const;
@@ -47,7 +47,7 @@ namespace Nauticle {
 		virtual ~pmCollision_handler() {}
 		std::shared_ptr<pmCollision_handler> clone() const;
 		pmTensor evaluate(int const& i, size_t const& level=0) const override;
-		virtual void update(size_t const& level=0) override;
+		virtual void update(size_t const& level=0, size_t const& num_threads=1) override;
 		void print() const override;
 	};
 }
@@ -30,14 +30,17 @@
 
 namespace Nauticle {
 	/** This abstract class implements the conventianal Smoothed Particle Hydrodynamics
-	//  through interactions between particles.
+	//  through interactions between particles. Every instance owns its pairs (one set
+	//  for each stored level). The pairs are rebuilt on the number of threads given at
+	//  the last update.
 	*/
 	class pmNontemplate {};
 
 	template <typename Derived>
 	class pmConnectivity : public pmNontemplate {
 	protected:
-		static std::vector<pmPairs> pairs;
+		std::vector<pmPairs> pairs;
+		size_t num_threads=1;
 	protected:
 		using Func_delete_marker = std::function<bool(pmTensor const&, int const&, int const&)>;
 		virtual void delete_pairs(Func_delete_marker condition, size_t const& level=0);
@@ -49,8 +52,6 @@ namespace Nauticle {
 		pmPairs& get_pairs(size_t const& level=0);
 	};
 
-	template <typename Derived> std::vector<pmPairs> pmConnectivity<Derived>::pairs;
-	
 	template <typename Derived>
 	void pmConnectivity<Derived>::add_pair(int const& i1, int const& i2, std::vector<double> const& new_values_ordered) {
 		for(auto& it:pairs) {
@@ -71,7 +72,7 @@ namespace Nauticle {
 	template <typename Derived>
 	void pmConnectivity<Derived>::set_number_of_nodes(int const& num_particles) {
 		for(auto& it:pairs) {
-			it.set_number_of_nodes(num_particles);
+			it.set_number_of_nodes(num_particles, num_threads);
 		}
 	}
 }
@@ -0,0 +1,82 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+
+#ifndef _PM_DEM_CONTACTS_H_
+#define _PM_DEM_CONTACTS_H_
+
+#include <vector>
+#include <functional>
+#include "pmTensor.h"
+#include "pmParticle_system.h"
+
+namespace Nauticle {
+	/** This class stores the contacts of the discrete element method in compact arrays.
+	//  The contacts are updated incrementally: every update visits the candidates of
+	//  the cell structure once (over the half stencil) and keeps the contacts which are
+	//  still overlapping together with their cached coefficients and tangential history.
+	//  The coefficients of new contacts are evaluated only once, when the contact is
+	//  created. Contacts with mirrored images (symmetric boundaries) act only on their
+	//  first particle, hence they are stored from both sides. The contacts are ordered by
+	//  their first particle and the mutual contacts are indexed by their second particle
+	//  too, hence the contributions can be gathered in parallel without synchronization.
+	*/
+	class pmDem_contacts {
+	public:
+		static constexpr int num_coefficients = 4;
+		using Func_radius = std::function<double(int const&)>;
+		using Func_coefficients = std::function<void(int const&, int const&, double*)>;
+	private:
+		struct pmContact_buffer {
+			std::vector<int> first;
+			std::vector<int> second;
+			std::vector<int> image;
+			std::vector<char> mutual;
+			std::vector<double> rel_pos;
+			std::vector<double> coefficient;
+			std::vector<double> history;
+		};
+		int dimensions=0;
+		pmContact_buffer contact;
+		std::vector<int> start;
+		std::vector<int> second_start;
+		std::vector<int> second_index;
+	private:
+		static int image_code(pmTensor const& guide);
+		void permute(std::vector<int> const& permutation);
+		void build_index(int const& num_nodes);
+	public:
+		void update(pmParticle_system const& psys, Func_radius radius, Func_coefficients coefficients, size_t const& num_threads);
+		void clear();
+		void remap(std::vector<int> const& new_index, int const& num_nodes);
+		void reorder(std::vector<int> const& order);
+		int get_number_of_contacts() const;
+		int get_first(int const& c) const;
+		int get_second(int const& c) const;
+		bool is_mutual(int const& c) const;
+		pmTensor get_relative_position(int const& c) const;
+		pmTensor get_guide(int const& c) const;
+		double* get_coefficients(int const& c);
+		double* get_history(int const& c);
+		void gather(std::vector<pmTensor> const& on_first, std::vector<pmTensor> const& on_second, std::vector<pmTensor>& result, size_t const& num_threads) const;
+	};
+}
+
+#endif //_PM_DEM_CONTACTS_H_
@@ -22,6 +22,9 @@
 #define _PM_DEM_H_
 
 #include "pmInteraction.h"
+#include "pmDem_contacts.h"
+#include "pmParallel.h"
+#include "pmSort.h"
 #include "prolog/pLogger.h"
 #include "nauticle_constants.h"
 #include "Color_define.h"
@@ -33,12 +36,20 @@ namespace Nauticle {
 	};
 	
 	/** This class implements the conventianal Discrete element method as 
-	//  through interactions between particles. 
+	//  through interactions between particles. The contacts are kept between the
+	//  evaluations (see pmDem_contacts). With eight operands the last one is the time
+	//  step and the tangential force is computed by a spring stored for each contact
+	//  (capped by the Coulomb limit) instead of the sliding friction.
 	*/
 	template <DEM_TYPE TYPE, size_t NOPS>
 	class pmDem_operator : public pmInteraction<NOPS> {
+	private:
+		pmDem_contacts contacts;
 	private:
 		std::shared_ptr<pmExpression> clone_impl() const override;
+		static double hertz_spring(double const& Ri, double const& Rj, double const& Ei, double const& Ej, double const& nui, double const& nuj);
+		static double hertz_damping(double const& khz, double const& mi, double const& mj);
+		static double tangential_stiffness(double const& Ri, double const& Rj, double const& Ei, double const& Ej, double const& nui, double const& nuj);
 	public:
 		pmDem_operator() {}
 		pmDem_operator(std::array<std::shared_ptr<pmExpression>,NOPS> op);
@@ -49,6 +60,10 @@ namespace Nauticle {
 		virtual ~pmDem_operator() {}
 		void print() const override;
 		pmTensor evaluate(int const& i, size_t const& level=0) const override;
+		void precompute(size_t const& num_threads) override;
+		void delete_member(size_t const& i) override;
+		void delete_set(std::vector<size_t> const& indices) override;
+		void reorder(std::vector<int> const& order) override;
 		std::shared_ptr<pmDem_operator> clone() const;
 	};
 
@@ -67,7 +82,11 @@ namespace Nauticle {
 	template <DEM_TYPE TYPE, size_t NOPS>
 	pmDem_operator<TYPE, NOPS>::pmDem_operator(std::array<std::shared_ptr<pmExpression>,NOPS> op) {
 		this->operand = std::move(op);
-		this->op_name = TYPE==LINEAR ? "dem_l" : "dem_a";
+		if(NOPS==8) {
+			this->op_name = TYPE==LINEAR ? "dem_lh" : "dem_ah";
+		} else {
+			this->op_name = TYPE==LINEAR ? "dem_l" : "dem_a";
+		}
 	}
 
 	/////////////////////////////////////////////////////////////////////////////////////////
@@ -138,6 +157,34 @@ namespace Nauticle {
 		return std::static_pointer_cast<pmDem_operator<TYPE, NOPS>, pmExpression>(clone_impl());
 	}
 
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the Hertzian spring coefficient of the given pair of particles.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <DEM_TYPE TYPE, size_t NOPS>
+	double pmDem_operator<TYPE, NOPS>::hertz_spring(double const& Ri, double const& Rj, double const& Ei, double const& Ej, double const& nui, double const& nuj) {
+		return Ei==0 && Ej==0 ? 0 : 4.0/3.0*std::sqrt(Ri*Rj/(Ri+Rj))*(Ei*Ej/(Ej*(1-nui*nui)+Ei*(1-nuj*nuj)));
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the damping coefficient of the given pair of particles.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <DEM_TYPE TYPE, size_t NOPS>
+	double pmDem_operator<TYPE, NOPS>::hertz_damping(double const& khz, double const& mi, double const& mj) {
+		return std::sqrt(khz*(mi*mj)/(mi+mj)/2.0)/8.0;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the tangential (Mindlin) spring coefficient of the given pair of particles
+	/// without the square root of the overlap.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <DEM_TYPE TYPE, size_t NOPS>
+	double pmDem_operator<TYPE, NOPS>::tangential_stiffness(double const& Ri, double const& Rj, double const& Ei, double const& Ej, double const& nui, double const& nuj) {
+		if(Ei==0 && Ej==0) { return 0; }
+		double Gi = Ei/2.0/(1+nui);
+		double Gj = Ej/2.0/(1+nuj);
+		return 8.0*Gi*Gj/((2-nui)*Gj+(2-nuj)*Gi)*std::sqrt(Ri*Rj/(Ri+Rj));
+	}
+
 	/////////////////////////////////////////////////////////////////////////////////////////
 	/// Prints DEM content.
 	/////////////////////////////////////////////////////////////////////////////////////////
@@ -153,6 +200,9 @@ namespace Nauticle {
 	template <DEM_TYPE TYPE, size_t NOPS>
 	pmTensor pmDem_operator<TYPE, NOPS>::evaluate(int const& i, size_t const& level/*=0*/) const {
 		if(!this->assigned) { ProLog::pLogger::error_msgf("DEM model is not assigned to any particle system.\n"); }
+		if(this->precomputed && level==0) {
+			return this->pairwise_result[i];
+		}
 		size_t dimension = this->psys->get_dimensions();
 
 		pmTensor vi = this->operand[0]->evaluate(i,level);
@@ -165,18 +215,12 @@ namespace Nauticle {
 		
 		auto normal_force = [&](double const& delta, double const& delta_dot, double const& khz, double const& ck)->double {
 				// damping+Hertz
-				return ck*delta_dot*std::pow(delta,0.25) - khz*std::pow(delta, 1.5);
+				return ck*delta_dot*std::sqrt(std::sqrt(delta)) - khz*delta*std::sqrt(delta);
 		};
 		auto tangential_force = [&](double const& F_normal)->double {
 				// damping & Coulomb
 				return -F_normal*ct;
 		};
-		auto hertz_spring = [&](double const& Rj, double const& Ej, double const& nuj)->double {
-			return Ei==0 && Ej==0 ? 0 : 4.0/3.0*std::sqrt(Ri*Rj/(Ri+Rj))*(Ei*Ej/(Ej*(1-nui*nui)+Ei*(1-nuj*nuj)));
-		};
-		auto hertz_damping = [&](double const& khz, double const& mj)->double {
-			return std::sqrt(khz*(mi*mj)/(mi+mj)/2.0)/8.0;
-		};
 
 		if(TYPE==LINEAR) {
 			auto contribute = [&](pmTensor const& rel_pos, int const& i, int const& j, pmTensor const& cell_size, pmTensor const& guide)->pmTensor{
@@ -207,8 +251,8 @@ namespace Nauticle {
 						// overlap
 						double delta = min_dist-d_ji;
 						double delta_dot = (rel_vel.transpose()*n_ji)[0];
-						double khz = hertz_spring(Rj,Ej,nuj);
-						double ck = hertz_damping(khz, mj);
+						double khz = hertz_spring(Ri,Rj,Ei,Ej,nui,nuj);
+						double ck = hertz_damping(khz, mi, mj);
 						// normal_force
 						double F_normal = normal_force(delta, delta_dot, khz, ck);
 						force = F_normal*n_ji;
@@ -269,8 +313,8 @@ namespace Nauticle {
 
 						double delta = min_dist-d_ji;
 						double delta_dot = (rel_vel.transpose()*n_ji)[0];
-						double khz = hertz_spring(Rj,Ej,nuj);
-						double ck = hertz_damping(khz,mj);
+						double khz = hertz_spring(Ri,Rj,Ei,Ej,nui,nuj);
+						double ck = hertz_damping(khz, mi, mj);
 						// normal_force
 						double F_normal = normal_force(delta, delta_dot, khz, ck);
 						pmTensor tan_vel = rel_vel - (rel_vel.transpose()*n_ji) * n_ji;
@@ -316,6 +360,175 @@ namespace Nauticle {
 			return this->interact(i, contribute);
 		}
 	}
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Evaluates the DEM forces (or torques) for all nodes at once. The contacts are
+	/// updated incrementally and their coefficients are evaluated only when they are
+	/// created. The normal force is equal and opposite for the particles
+	/// of the contact. Without history, the tangential force is scaled by the friction
+	/// coefficient of the given particle, otherwise it is given by the tangential spring
+	/// of the contact, which is rotated onto the current tangential plane, integrated over
+	/// the time step and limited by the Coulomb condition. The spring is advanced at every
+	/// call, hence the operator is expected to be evaluated once per time step.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <DEM_TYPE TYPE, size_t NOPS>
+	void pmDem_operator<TYPE, NOPS>::precompute(size_t const& num_threads) {
+		if(this->precomputed) { return; }
+		pmInteraction<NOPS>::precompute(num_threads);
+		if(!this->assigned) { return; }
+		int dimension = this->psys->get_dimensions();
+		auto radius = [&](int const& i)->double {
+			return this->operand[2]->evaluate(i,0)[0];
+		};
+		auto coefficients = [&](int const& i, int const& j, double* coef) {
+			double Ri = this->operand[2]->evaluate(i,0)[0];
+			double Rj = this->operand[2]->evaluate(j,0)[0];
+			double mi = this->operand[3]->evaluate(i,0)[0];
+			double mj = this->operand[3]->evaluate(j,0)[0];
+			double Ei = this->operand[4]->evaluate(i,0)[0];
+			double Ej = this->operand[4]->evaluate(j,0)[0];
+			double nui = this->operand[5]->evaluate(i,0)[0];
+			double nuj = this->operand[5]->evaluate(j,0)[0];
+			coef[0] = hertz_spring(Ri,Rj,Ei,Ej,nui,nuj);
+			coef[1] = hertz_damping(coef[0], mi, mj);
+			coef[2] = tangential_stiffness(Ri,Rj,Ei,Ej,nui,nuj);
+			coef[3] = (this->operand[6]->evaluate(i,0)[0]+this->operand[6]->evaluate(j,0)[0])/2.0;
+		};
+		contacts.update(*this->psys, radius, coefficients, num_threads);
+		int num_contacts = contacts.get_number_of_contacts();
+		double dt = NOPS==8 ? this->operand[NOPS-1]->evaluate(0,0)[0] : 0.0;
+		pmTensor zero = TYPE==LINEAR ? pmTensor{dimension,1,0.0} : pmTensor{dimension==2?1:3,1,0.0};
+		auto torque = [&](pmTensor const& force, pmTensor const& arm)->pmTensor {
+			if(dimension==2) {
+				return cross(force.append(3,1),arm.append(3,1)).sub_tensor(2,2,0,0);
+			}
+			return cross(arm,force);
+		};
+		std::vector<pmTensor> on_first(num_contacts);
+		std::vector<pmTensor> on_second(num_contacts);
+		auto contribute = [&](int const& c_begin, int const& c_end) {
+			for(int c=c_begin; c<c_end; c++) {
+				int i = contacts.get_first(c);
+				int j = contacts.get_second(c);
+				pmTensor rel_pos = contacts.get_relative_position(c);
+				pmTensor guide = contacts.get_guide(c);
+				double const* coef = contacts.get_coefficients(c);
+				double d_ji = rel_pos.norm();
+				double Ri = radius(i);
+				double Rj = radius(j);
+				pmTensor n_ji = rel_pos / d_ji;
+				pmTensor vi = this->operand[0]->evaluate(i,0);
+				pmTensor omi = this->operand[1]->evaluate(i,0);
+				pmTensor vj = this->operand[0]->evaluate(j,0).reflect_perpendicular(guide);
+				pmTensor omj = this->operand[1]->evaluate(j,0).reflect_perpendicular(guide);
+				if(!this->operand[1]->is_symmetric()) {
+					pmTensor flip = pmTensor::make_tensor(guide, 1);
+					for(int k=0; k<guide.numel(); k++) {
+						if(guide[k]!=0) {
+							flip = -1;
+						}
+					}
+					omj *= flip.productum();
+				}
+				pmTensor rel_vel = vj-vi;
+				// overlap
+				double delta = Ri+Rj-d_ji;
+				double delta_dot = (rel_vel.transpose()*n_ji)[0];
+				// damping+Hertz
+				double F_normal = coef[1]*delta_dot*std::sqrt(std::sqrt(delta)) - coef[0]*delta*std::sqrt(delta);
+				// relative tangential velocity
+				pmTensor tan_vel = rel_vel - (rel_vel.transpose()*n_ji) * n_ji;
+				double rci = Ri-delta/2.0;
+				double rcj = Rj-delta/2.0;
+				if(dimension==2) {
+					pmTensor wi{3,1,0.0};
+					wi[2] = omi[0];
+					pmTensor wj{3,1,0.0};
+					wj[2] = omj[0];
+					pmTensor nji = n_ji.append(3,1);
+					tan_vel += (cross(wi,rci*nji) + cross(wj,rcj*nji)).sub_tensor(0,1,0,0);
+				} else if(dimension==3) {
+					tan_vel += cross(omi,rci*n_ji) + cross(omj,rcj*n_ji);
+				}
+				pmTensor force_i{dimension,1,0.0};
+				pmTensor force_j{dimension,1,0.0};
+				if(NOPS==8) {
+					// tangential spring & Coulomb
+					double* history = contacts.get_history(c);
+					pmTensor spring{dimension,1,0.0};
+					for(int k=0; k<dimension; k++) {
+						spring[k] = history[k];
+					}
+					double length = spring.norm();
+					spring -= (spring.transpose()*n_ji)[0]*n_ji;
+					double projected = spring.norm();
+					if(projected>NAUTICLE_EPS) {
+						spring = length/projected*spring;
+					}
+					spring += dt*tan_vel;
+					double kt = coef[2]*std::sqrt(delta);
+					double limit = coef[3]*std::max(0.0, -F_normal);
+					double F_tangential = kt*spring.norm();
+					if(F_tangential>limit && F_tangential>NAUTICLE_EPS) {
+						spring = limit/F_tangential*spring;
+					}
+					for(int k=0; k<dimension; k++) {
+						history[k] = spring[k];
+					}
+					force_i = kt*spring;
+					force_j = -force_i;
+				} else {
+					// tangential friction force (damping & Coulomb)
+					double vt = tan_vel.norm();
+					if(vt>NAUTICLE_EPS) {
+						pmTensor t_ji = tan_vel/vt;
+						force_i = -F_normal*this->operand[6]->evaluate(i,0)[0]*t_ji;
+						force_j = F_normal*this->operand[6]->evaluate(j,0)[0]*t_ji;
+					}
+				}
+				if(TYPE==LINEAR) {
+					on_first[c] = F_normal*n_ji + force_i;
+					on_second[c] = -F_normal*n_ji + force_j;
+				} else {
+					on_first[c] = torque(force_i, rci*n_ji);
+					on_second[c] = torque(force_j, -rcj*n_ji);
+				}
+			}
+		};
+		pmParallel::parallel_for(0, num_contacts, num_threads, contribute);
+		this->pairwise_result.assign(this->psys->get_field_size(), zero);
+		contacts.gather(on_first, on_second, this->pairwise_result, num_threads);
+		this->precomputed = true;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Removes the contacts of the ith particle. The last particle takes its place (as in
+	/// the fields), which are already deleted.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <DEM_TYPE TYPE, size_t NOPS>
+	void pmDem_operator<TYPE, NOPS>::delete_member(size_t const& i) {
+		if(!this->assigned) { return; }
+		size_t n = this->psys->get_field_size();
+		contacts.remap(pmSort::swap_removal(n+1, i), n);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Removes the contacts of the given particles. The order of the remaining particles
+	/// is kept (as in the fields), which are already deleted.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <DEM_TYPE TYPE, size_t NOPS>
+	void pmDem_operator<TYPE, NOPS>::delete_set(std::vector<size_t> const& indices) {
+		if(!this->assigned || indices.empty()) { return; }
+		size_t n = this->psys->get_field_size();
+		contacts.remap(pmSort::compaction(n+indices.size(), indices), n);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Renumbers the contacts according to the new order of the particles.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <DEM_TYPE TYPE, size_t NOPS>
+	void pmDem_operator<TYPE, NOPS>::reorder(std::vector<int> const& order) {
+		contacts.reorder(order);
+	}
 }
 
 #include "Color_undefine.h"
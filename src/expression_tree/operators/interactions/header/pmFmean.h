@@ -29,7 +29,8 @@ namespace Nauticle {
     class pmFmean : public pmFsearch {
     	std::shared_ptr<pmExpression> clone_impl() const override;
     private:
-    	void process(pmTensor& value, size_t const& level=0) const override;
+    	void combine(pmTensor& value, pmTensor const& other) const override;
+    	void finish(pmTensor& value, int const& num_nodes) const override;
     public:
     	pmFmean(std::shared_ptr<pmExpression>);
     	pmFmean(pmFmean const& other);
@@ -29,7 +29,7 @@ namespace Nauticle {
     class pmFmin : public pmFsearch {
     	std::shared_ptr<pmExpression> clone_impl() const override;
     private:
-    	void process(pmTensor& value, size_t const& level=0) const override;
+    	void combine(pmTensor& value, pmTensor const& other) const override;
     public:
     	pmFmin(std::shared_ptr<pmExpression>);
     	pmFmin(pmFmin const& other);
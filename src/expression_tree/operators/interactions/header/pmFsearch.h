@@ -24,16 +24,25 @@
 #include "pmInteraction.h"
 
 namespace Nauticle {
-    /** This abstract class forms a parent class for pmField operations.
+    /** This abstract class forms a parent class for pmField operations. The reduction is
+    //  computed in parallel: each thread reduces a contiguous partition of the nodes and the
+    //  partial results are combined pairwise in a tree. The partitions depend only on the
+    //  number of threads, hence the result is reproducible. When precomputed, the result
+    //  is cached and returned for every node until release_precomputed is called.
     */
     class pmFsearch : public pmInteraction<1> {
     private:
-    	virtual void process(pmTensor& value, size_t const& level=0) const=0;
+    	pmTensor result;
+    private:
+    	virtual void combine(pmTensor& value, pmTensor const& other) const=0;
+    	virtual void finish(pmTensor& value, int const& num_nodes) const {}
+    	pmTensor reduce(size_t const& num_threads, size_t const& level=0) const;
     public:
     	virtual ~pmFsearch() {}
     	virtual int get_field_size() const override;
     	bool is_assigned() const override;
     	pmTensor evaluate(int const& i, size_t const& level=0) const override;
+    	void precompute(size_t const& num_threads) override;
     };
 }
 
@@ -25,8 +25,10 @@
 #include <mutex>
 #include <functional>
 #include "pmOperator.h"
+#include "pmBytecode.h"
 #include "pmParticle_system.h"
 #include "pmCounter.h"
+#include "pmParallel.h"
 
 namespace Nauticle {
 	/** This interface forms the base for the interaction models. Since interactions
@@ -37,24 +39,31 @@ namespace Nauticle {
 	class pmInteraction : public pmOperator<S>, public pmCounter<uint> {
 		std::string declaration_type;
 		using Func_ith = std::function<pmTensor(pmTensor const&, int const&, int const&, pmTensor const&, pmTensor const& guide)>;
+		using Func_pair = std::function<void(pmTensor const&, int const&, int const&, pmTensor const&, pmTensor const& guide, bool const& mutual, pmTensor& contribution_i, pmTensor& contribution_j)>;
+		std::vector<std::vector<pmTensor>> thread_buffer;
 	protected:
 		std::string op_name;
 		std::shared_ptr<pmParticle_system> psys;
 		bool assigned=false;
+		bool precomputed=false;
+		std::vector<pmTensor> pairwise_result;
 	protected:
 		pmInteraction();
 		virtual ~pmInteraction() {}
 		bool is_assigned() const override;
 		int get_field_size() const override;
-		bool cutoff_cell(pmTensor const& beta, pmTensor const& delta, size_t const& dimensions) const;
 		pmTensor interact(int const& i, Func_ith contribute) const;
+		void interact_pairwise(Func_pair contribute, size_t const& num_threads);
 	public:
 		void assign(std::shared_ptr<pmParticle_system> ps) override;
 		virtual void write_to_string(std::ostream& os) const override;
 		void set_declaration_type(std::string const& decl_type);
 		std::string const& get_declaration_type() const;
 		virtual bool is_interaction() const override;
+		virtual bool is_reading_neighbors(std::string const& symbol_name) const override;
 		virtual int get_precedence() const { return 0; }
+		virtual void release_precomputed() override;
+		virtual int compile(pmBytecode& code, size_t const& level=0) const override;
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////////////
@@ -99,21 +108,6 @@ namespace Nauticle {
 		return psys->get_field_size();
 	}
 
-	/////////////////////////////////////////////////////////////////////////////////////////
-	/// Checks if query cell is cutoff.
-	/////////////////////////////////////////////////////////////////////////////////////////
-	template <size_t S>
-	bool pmInteraction<S>::cutoff_cell(pmTensor const& beta, pmTensor const& delta, size_t const& dimensions) const {
-		bool cutoff_cell = false;
-		for(int k=0; k<dimensions; k++) {
-			if(std::abs(beta[k])>=2.0-NAUTICLE_EPS && std::abs(delta[k])>NAUTICLE_EPS) {
-				cutoff_cell = true;
-				break;
-			}
-		}
-		return cutoff_cell;
-	}
-
 	/////////////////////////////////////////////////////////////////////////////////////////
 	/// Calculates the interaction between adjacent particles using the given contribution 
 	/// lambda-function.
@@ -121,46 +115,84 @@ namespace Nauticle {
 	template <size_t S>
 	pmTensor pmInteraction<S>::interact(int const& i, Func_ith contribute) const {
 		pmTensor result;
+		pmTensor const& cell_size = psys->get_cell_size();
+		psys->for_each_neighbor(i, [&](int const& j, pmTensor const& rel_pos, pmTensor const& guide) {
+			result += contribute(rel_pos, i, j, cell_size, guide);
+		});
+		return result;
+	}
 
-		auto cell_iterator = psys->get_cell_iterator();
-		pmTensor cell_size = psys->get_cell_size();
-		pmTensor domain_minimum = psys->get_minimum();
-		pmTensor domain_maximum = psys->get_maximum();
-		pmTensor domain_cells = domain_maximum-domain_minimum;
-		pmTensor domain_physical_minimum = psys->get_physical_minimum();
-		pmTensor domain_physical_maximum = psys->get_physical_maximum();
-		pmTensor domain_physical_size = psys->get_physical_size();
-		pmTensor const beta = psys->get_boundary();
-		pmTensor const ones = pmTensor::make_tensor(beta,1);
-		size_t dimensions = psys->get_dimensions();
-		std::vector<int> nbs;
-		pmTensor pos_i = psys->get_value(i);
-		pmTensor grid_pos_i = psys->grid_coordinates(pos_i);
-		
-		for(auto const& it:cell_iterator) {
-			pmTensor grid_pos_j = grid_pos_i+it;
-			pmTensor delta = -floor((grid_pos_j).divide_term_by_term(domain_cells));
-			if(cutoff_cell(beta, delta, dimensions)) {
-				continue;
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Evaluates the interaction for all the particles at once by visiting every pair of
+	/// particles only once over the half stencil. The contribute lambda-function returns the
+	/// contributions of the pair to both particles (the one of j is required only if mutual
+	/// is true). The threads accumulate the contributions into separate buffers which are
+	/// summed up afterwards, hence no synchronization is needed. The results are returned
+	/// by the evaluate function until release_precomputed is called.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <size_t S>
+	void pmInteraction<S>::interact_pairwise(Func_pair contribute, size_t const& num_threads) {
+		int n = psys->get_field_size();
+		int nt = std::max(1, std::min((int)num_threads, n));
+		int ppt = (n+nt-1)/nt; // particles per thread
+		pmTensor const& cell_size = psys->get_cell_size();
+		pairwise_result.resize(n);
+		thread_buffer.resize(nt-1);
+		auto scatter = [&](int const& t_begin, int const& t_end) {
+			for(int t=t_begin; t<t_end; t++) {
+				std::vector<pmTensor>& buffer = t==0 ? pairwise_result : thread_buffer[t-1];
+				buffer.assign(n, pmTensor{});
+				int p_end = std::min(n, (t+1)*ppt);
+				for(int i=t*ppt; i<p_end; i++) {
+					psys->for_each_half_neighbor(i, [&](int const& j, pmTensor const& rel_pos, pmTensor const& guide, bool const& mutual) {
+						pmTensor contribution_i;
+						pmTensor contribution_j;
+						contribute(rel_pos, i, j, cell_size, guide, mutual, contribution_i, contribution_j);
+						buffer[i] += contribution_i;
+						if(mutual) {
+							buffer[j] += contribution_j;
+						}
+					});
+				}
 			}
-			pmTensor guide = delta.multiply_term_by_term(beta);
-			grid_pos_j += delta.multiply_term_by_term(domain_cells-beta.multiply_term_by_term(domain_cells)+beta);
-			int j = -1;
-			std::vector<int> const& pidx = psys->get_cell_content(grid_pos_j,j);
-			for(;j!=-1;j=pidx[j]) {
-				pmTensor pos_j = psys->get_value(j);
-				for(int k=0; k<beta.numel(); k++) {
-					if(beta[k]==1) {
-						pos_j[k] += delta[k]*(delta[k]-1)*(domain_physical_maximum[k]-pos_j[k]) + delta[k]*(delta[k]+1)*(domain_physical_minimum[k]-pos_j[k]);
-					} else {
-						pos_j[k] -= delta[k]*domain_physical_size[k];
-					}
+		};
+		pmParallel::parallel_for(0, nt, nt, scatter);
+		auto reduce = [&](int const& start, int const& end) {
+			for(auto const& it:thread_buffer) {
+				for(int i=start; i<end; i++) {
+					pairwise_result[i] += it[i];
 				}
-				pmTensor rel_pos = pos_j-pos_i;
-				result += contribute(rel_pos, i, j, cell_size, guide);
+			}
+		};
+		pmParallel::parallel_for(0, n, nt, reduce);
+		precomputed = true;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Releases the results of the pairwise evaluation.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <size_t S>
+	void pmInteraction<S>::release_precomputed() {
+		precomputed = false;
+		pmOperator<S>::release_precomputed();
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Emits the interaction into the given bytecode if it lowers interactions. The shape is
+	/// taken from the first nonempty result of the first nodes, the values are evaluated by
+	/// the interaction at execution.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <size_t S>
+	int pmInteraction<S>::compile(pmBytecode& code, size_t const& level/*=0*/) const {
+		if(!assigned || !code.is_lowering_interactions()) { return -1; }
+		int n = std::min(this->get_field_size(), pmBytecode::block_size);
+		for(int i=0; i<n; i++) {
+			pmTensor value = this->evaluate(i, level);
+			if(value.numel()>0) {
+				return code.load_interaction(this, value.get_numrows(), value.get_numcols(), level);
 			}
 		}
-		return result;
+		return -1;
 	}
 
 	/////////////////////////////////////////////////////////////////////////////////////////
@@ -201,6 +233,18 @@ namespace Nauticle {
 	bool pmInteraction<S>::is_interaction() const {
 		return true;
 	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns true if the operands or the positions of the assigned particle system refer
+	/// to the symbol with the given name, since they are evaluated at the neighbors.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <size_t S>
+	bool pmInteraction<S>::is_reading_neighbors(std::string const& symbol_name) const {
+		if(psys.use_count()>0 && psys->get_name()==symbol_name) {
+			return true;
+		}
+		return pmOperator<S>::is_referencing(symbol_name);
+	}
 }
 
 #endif //_PM_INTERACTION_H_
\ No newline at end of file
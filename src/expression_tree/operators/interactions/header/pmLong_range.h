@@ -26,6 +26,8 @@
 #include "prolog/pLogger.h"
 #include "pmKernel.h"
 #include "pmConnectivity.h"
+#include "pmParallel.h"
+#include "pmSort.h"
 
 namespace Nauticle {
 	/** This abstract class implements the conventianal Smoothed Particle Hydrodynamics
@@ -38,65 +40,96 @@ namespace Nauticle {
 	public:
 		virtual ~pmLong_range() {}
 		void set_storage_depth(size_t const& d) override;
-		void update(size_t const& level=0) override;
+		void update(size_t const& level=0, size_t const& num_threads=1) override;
 		virtual void delete_member(size_t const& i) override;
 		virtual void delete_set(std::vector<size_t> const& indices) override;
+		virtual void reorder(std::vector<int> const& order) override;
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////////////
-	/// Set the number of former values to be stored.
+	/// Set the number of former values to be stored. New levels start with the pairs of the
+	/// current one.
 	/////////////////////////////////////////////////////////////////////////////////////////
 	template <size_t S, typename Derived>
 	void pmLong_range<S,Derived>::set_storage_depth(size_t const& d) {
 		pmOperator<S>::set_storage_depth(d);
-		pmConnectivity<Derived>::pairs.resize(d);
+		auto& pairs = pmConnectivity<Derived>::pairs;
+		pairs.resize(d, pairs.empty() ? pmPairs{} : pairs[0]);
 	}
 
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Updates the number of particles. The pairs are handled on num_threads threads until
+	/// the next update.
+	/////////////////////////////////////////////////////////////////////////////////////////
 	template <size_t S, typename Derived>
-	void pmLong_range<S,Derived>::update(size_t const& level/*=0*/) {
+	void pmLong_range<S,Derived>::update(size_t const& level/*=0*/, size_t const& num_threads/*=1*/) {
+		pmConnectivity<Derived>::num_threads = num_threads;
 		this->set_number_of_nodes(this->psys->get_field_size());
 	}
 
 	/////////////////////////////////////////////////////////////////////////////////////////
-	/// Delete marked pairs from the mesh.
+	/// Delete marked pairs from the mesh. The condition is evaluated for the pairs in
+	/// parallel, hence it must not modify shared data.
 	/////////////////////////////////////////////////////////////////////////////////////////
 	template <size_t S, typename Derived>
 	void pmLong_range<S,Derived>::delete_pairs(typename pmConnectivity<Derived>::Func_delete_marker condition, size_t const& level/*=0*/) {
-		auto first = pmConnectivity<Derived>::pairs[level].get_first();
-		auto second = pmConnectivity<Derived>::pairs[level].get_second();
-		for(int pi=0; pi<pmConnectivity<Derived>::pairs[level].get_number_of_pairs(); pi++) {
-			int i = first[pi];
-			int j = second[pi];
-			pmTensor pos_i = this->psys->get_value(i);
-			pmTensor pos_j = this->psys->get_value(j);
-			pmTensor rel_pos = pos_j-pos_i;
-			if(condition(rel_pos,i,j)) {
-				pmConnectivity<Derived>::pairs[level].mark_to_delete(pi);
+		pmPairs& pairs = pmConnectivity<Derived>::pairs[level];
+		std::vector<int> const& first = pairs.get_first();
+		std::vector<int> const& second = pairs.get_second();
+		size_t num_threads = pmConnectivity<Derived>::num_threads;
+		std::vector<char> marker(pairs.get_number_of_pairs(), 0);
+		pmParallel::parallel_for(0, pairs.get_number_of_pairs(), num_threads, [&](int const& start, int const& end){
+			for(int pi=start; pi<end; pi++) {
+				int i = first[pi];
+				int j = second[pi];
+				pmTensor pos_i = this->psys->get_value(i);
+				pmTensor pos_j = this->psys->get_value(j);
+				pmTensor rel_pos = pos_j-pos_i;
+				marker[pi] = condition(rel_pos,i,j);
+			}
+		});
+		for(int pi=0; pi<marker.size(); pi++) {
+			if(marker[pi]) {
+				pairs.mark_to_delete(pi);
 			}
 		}
-		pmConnectivity<Derived>::pairs[level].delete_marked_pairs();
+		pairs.delete_marked_pairs(num_threads);
 	}
 
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Deletes the pairs of the ith particle. The fields (already deleted) move the last
+	/// particle in its place, hence the pairs of the last particle are renumbered too.
+	/////////////////////////////////////////////////////////////////////////////////////////
 	template <size_t S, typename Derived>
 	void pmLong_range<S,Derived>::delete_member(size_t const& i) {
-		for(int level=0; level<pmConnectivity<Derived>::pairs.size(); level++) {
-			auto const& first = pmConnectivity<Derived>::pairs[level].get_first();
-			auto const& second = pmConnectivity<Derived>::pairs[level].get_second();
-			for(int pi=0; pi<pmConnectivity<Derived>::pairs[level].get_number_of_pairs(); pi++) {
-				int p1 = first[pi];
-				int p2 = second[pi];
-				if(p1==i || p2==i) {
-					pmConnectivity<Derived>::pairs[level].mark_to_delete(pi);
-				}
-			}
-			pmConnectivity<Derived>::pairs[level].delete_marked_pairs();
+		size_t n = this->psys->get_field_size();
+		std::vector<int> new_index = pmSort::swap_removal(n+1, i);
+		for(auto& it:pmConnectivity<Derived>::pairs) {
+			it.remap(new_index, n, pmConnectivity<Derived>::num_threads);
 		}
 	}
 
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Deletes the pairs of the given particles at once. The remaining particles are
+	/// renumbered keeping their order, as in the fields (already deleted).
+	/////////////////////////////////////////////////////////////////////////////////////////
 	template <size_t S, typename Derived>
 	void pmLong_range<S,Derived>::delete_set(std::vector<size_t> const& indices) {
-		for(auto const& it:indices) {
-			pmLong_range<S,Derived>::delete_member(it);
+		if(indices.empty()) { return; }
+		size_t n = this->psys->get_field_size();
+		std::vector<int> new_index = pmSort::compaction(n+indices.size(), indices);
+		for(auto& it:pmConnectivity<Derived>::pairs) {
+			it.remap(new_index, n, pmConnectivity<Derived>::num_threads);
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Renumbers the pairs according to the new order of the particles.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <size_t S, typename Derived>
+	void pmLong_range<S,Derived>::reorder(std::vector<int> const& order) {
+		for(auto& it:pmConnectivity<Derived>::pairs) {
+			it.reorder(order, pmConnectivity<Derived>::num_threads);
 		}
 	}
 }
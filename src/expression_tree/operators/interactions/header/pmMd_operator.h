@@ -46,6 +46,7 @@ namespace Nauticle {
 		virtual ~pmMd_operator() {}
 		void print() const override;
 		pmTensor evaluate(int const& i, size_t const& level=0) const override;
+		void precompute(size_t const& num_threads) override;
 		std::shared_ptr<pmMd_operator> clone() const;
 	};
 }
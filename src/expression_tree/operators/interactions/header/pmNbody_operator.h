@@ -26,35 +26,274 @@
 #include <array>
 #include "pmInteraction.h"
 #include "pmTensor.h"
+#include "pmBarnes_hut.h"
+#include "pmParticle_mesh.h"
+#include "prolog/pLogger.h"
+#include "Color_define.h"
 
 namespace Nauticle {
+	enum NBODY_TYPE {
+		DIRECT,
+		BARNES_HUT,
+		PARTICLE_MESH,
+		P3M
+	};
+
 	/** This class implements an N-body interaction between particles defined in the assigned
-	//  pmParticle_system. This interaction has N^2 complexity.
+	//  pmParticle_system. The DIRECT type sums up the contributions of all the particles with
+	//  N^2 complexity and serves as the reference. The BARNES_HUT type takes the opening angle
+	//  theta as third operand and approximates the distant particles by the moments of the
+	//  nodes of a tree rebuilt in every precomputation, resulting in N*log(N) complexity.
+	//  The PARTICLE_MESH type solves the Poisson equation on a periodic mesh by FFT (one
+	//  mesh cell per domain cell, TSC assignment), hence it requires periodic boundaries
+	//  and includes the periodic images. The P3M type refines the mesh four times, splits
+	//  the interaction at cell_size/4.5 and adds the short-range part over the neighbours.
+	//  Both follow the 1/r^(D-1) law of the D-dimensional Poisson equation.
 	*/
-	class pmNbody_operator : public pmInteraction<2> {
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	class pmNbody_operator : public pmInteraction<NOPS> {
+	private:
+		pmBarnes_hut tree;
+		pmParticle_mesh mesh;
 	private:
 		std::shared_ptr<pmExpression> clone_impl() const override;
 	public:
 		pmNbody_operator() {}
-		pmNbody_operator(std::array<std::shared_ptr<pmExpression>,2> op);
+		pmNbody_operator(std::array<std::shared_ptr<pmExpression>,NOPS> op);
 		pmNbody_operator(pmNbody_operator const& other);
 		pmNbody_operator(pmNbody_operator&& other);
 		pmNbody_operator& operator=(pmNbody_operator const& other);
 		pmNbody_operator& operator=(pmNbody_operator&& other);
 		virtual ~pmNbody_operator() {}
 		void print() const override;
-		pmTensor process(pmTensor const& A_i, pmTensor const& A_j, double const& rho_i, double const& rho_j, double const& m_i, double const& m_j, pmTensor const& r_ji, double const& d_ji, double const& W_ij) const;
 		pmTensor evaluate(int const& i, size_t const& level=0) const override;
+		void precompute(size_t const& num_threads) override;
+		int compile(pmBytecode& code, size_t const& level=0) const override;
 		std::shared_ptr<pmNbody_operator> clone() const;
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////////////
 	/// Implementaton of << operator.
 	/////////////////////////////////////////////////////////////////////////////////////////
-	inline std::ostream& operator<<(std::ostream& os, pmNbody_operator const* obj) {
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	inline std::ostream& operator<<(std::ostream& os, pmNbody_operator<TYPE, NOPS> const* obj) {
 		obj->write_to_string(os);
 		return os;
 	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Constructor.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	pmNbody_operator<TYPE, NOPS>::pmNbody_operator(std::array<std::shared_ptr<pmExpression>,NOPS> op) {
+		this->operand = std::move(op);
+		switch(TYPE) {
+			case DIRECT : this->op_name = "nbody"; break;
+			case BARNES_HUT : this->op_name = "nbody_bh"; break;
+			case PARTICLE_MESH : this->op_name = "nbody_pm"; break;
+			case P3M : this->op_name = "nbody_p3m"; break;
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Copy constructor.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	pmNbody_operator<TYPE, NOPS>::pmNbody_operator(pmNbody_operator<TYPE, NOPS> const& other) {
+		this->assigned = false;
+		for(int i=0; i<this->operand.size(); i++) {
+			this->operand[i] = other.operand[i]->clone();
+		}
+		this->op_name = other.op_name;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Move constructor.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	pmNbody_operator<TYPE, NOPS>::pmNbody_operator(pmNbody_operator<TYPE, NOPS>&& other) {
+		this->psys = std::move(other.psys);
+		this->assigned = std::move(other.assigned);
+		this->operand = std::move(other.operand);
+		this->op_name = std::move(other.op_name);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Copy assignment operator.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	pmNbody_operator<TYPE, NOPS>& pmNbody_operator<TYPE, NOPS>::operator=(pmNbody_operator<TYPE, NOPS> const& other) {
+		if(this!=&other) {
+			this->assigned = false;
+			for(int i=0; i<this->operand.size(); i++) {
+				this->operand[i] = other.operand[i]->clone();
+			}
+			this->op_name = other.op_name;
+		}
+		return *this;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Move assignment operator.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	pmNbody_operator<TYPE, NOPS>& pmNbody_operator<TYPE, NOPS>::operator=(pmNbody_operator<TYPE, NOPS>&& other) {
+		if(this!=&other) {
+			this->psys = std::move(other.psys);
+			this->assigned = std::move(other.assigned);
+			this->operand = std::move(other.operand);
+			this->op_name = std::move(other.op_name);
+		}
+		return *this;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Clone implementation.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	std::shared_ptr<pmExpression> pmNbody_operator<TYPE, NOPS>::clone_impl() const {
+		return std::make_shared<pmNbody_operator<TYPE, NOPS>>(*this);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the copy of the object.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	std::shared_ptr<pmNbody_operator<TYPE, NOPS>> pmNbody_operator<TYPE, NOPS>::clone() const {
+		return std::static_pointer_cast<pmNbody_operator<TYPE, NOPS>, pmExpression>(clone_impl());
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Prints N-body content.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	void pmNbody_operator<TYPE, NOPS>::print() const {
+		ProLog::pLogger::logf<NAUTICLE_COLOR>(this->op_name.c_str());
+		this->print_operands();
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Evaluates the interaction. Unless precomputed, the direct sum is calculated, which
+	/// is not available for the periodic mesh types. Coincident particles do not interact.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	pmTensor pmNbody_operator<TYPE, NOPS>::evaluate(int const& i, size_t const& level/*=0*/) const {
+		if(!this->assigned) { ProLog::pLogger::error_msgf("N-body model is not assigned to any particle system.\n"); }
+		if(this->precomputed && level==0) {
+			return this->pairwise_result[i];
+		}
+		int dimension = this->psys->get_dimensions();
+		if(TYPE==PARTICLE_MESH || TYPE==P3M) {
+			ProLog::pLogger::error_msgf("\"%s\" can be evaluated only at the current time level.\n", this->op_name.c_str());
+			return pmTensor{dimension,1,0.0};
+		}
+		int stride = this->psys->get_number_of_components();
+		double const* pos = this->psys->get_data(level);
+		double const* pos_i = pos+(size_t)i*stride;
+		double mass_i = this->operand[0]->evaluate(i,level)[0];
+		double coef = this->operand[1]->evaluate(0,level)[0];
+		pmTensor force{dimension,1,0.0};
+		for(int j=0; j<this->psys->get_field_size(); j++) {
+			if(i==j) { continue; }
+			double const* pos_j = pos+(size_t)j*stride;
+			double distance2 = 0;
+			for(int k=0; k<dimension; k++) {
+				distance2 += (pos_j[k]-pos_i[k])*(pos_j[k]-pos_i[k]);
+			}
+			if(distance2==0) { continue; }
+			double mass_j = this->operand[0]->evaluate(j,level)[0];
+			double f = coef*mass_i*mass_j/(distance2*std::sqrt(distance2));
+			for(int k=0; k<dimension; k++) {
+				force[k] += f*(pos_j[k]-pos_i[k]);
+			}
+		}
+		return force;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Emits the interaction into the given bytecode. The mesh types are available only
+	/// after precomputation, hence they cannot be emitted.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	int pmNbody_operator<TYPE, NOPS>::compile(pmBytecode& code, size_t const& level/*=0*/) const {
+		if(TYPE==PARTICLE_MESH || TYPE==P3M) { return -1; }
+		return pmInteraction<NOPS>::compile(code, level);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Builds the Barnes-Hut tree or fills the mesh and evaluates the interaction for all
+	/// particles in parallel. The result does not depend on the number of threads.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <NBODY_TYPE TYPE, size_t NOPS>
+	void pmNbody_operator<TYPE, NOPS>::precompute(size_t const& num_threads) {
+		pmInteraction<NOPS>::precompute(num_threads);
+		if(TYPE==DIRECT || !this->assigned) { return; }
+		int n = this->psys->get_field_size();
+		int dimension = this->psys->get_dimensions();
+		std::vector<double> mass(n);
+		pmParallel::parallel_for(0, n, num_threads, [&](int const& start, int const& end) {
+			for(int i=start; i<end; i++) {
+				mass[i] = this->operand[0]->evaluate(i,0)[0];
+			}
+		});
+		double coef = this->operand[1]->evaluate(0,0)[0];
+		std::vector<double> acceleration;
+		if(TYPE==BARNES_HUT) {
+			double theta = this->operand[NOPS-1]->evaluate(0,0)[0];
+			tree.build(this->psys->get_data(), this->psys->get_number_of_components(), dimension, mass, num_threads);
+			tree.compute(theta, num_threads, acceleration);
+		} else {
+			pmTensor const& boundary = this->psys->get_boundary();
+			pmTensor const& cell_size = this->psys->get_cell_size();
+			pmTensor minimum = this->psys->get_physical_minimum();
+			pmTensor size = this->psys->get_physical_size();
+			double mesh_minimum[3];
+			double mesh_size[3];
+			int mesh_cells[3];
+			double min_cell_size = cell_size[0];
+			for(int k=0; k<dimension; k++) {
+				if(boundary[k]!=0) {
+					ProLog::pLogger::error_msgf("\"%s\" requires periodic boundaries.\n", this->op_name.c_str());
+					return;
+				}
+				mesh_minimum[k] = minimum[k];
+				mesh_size[k] = size[k];
+				mesh_cells[k] = (int)std::round(size[k]/cell_size[k])*(TYPE==P3M ? 4 : 1);
+				min_cell_size = std::min(min_cell_size, (double)cell_size[k]);
+			}
+			mesh.set_grid(mesh_minimum, mesh_size, mesh_cells, dimension);
+			mesh.set_split(TYPE==P3M ? min_cell_size/4.5 : 0.0);
+			mesh.compute(this->psys->get_data(), this->psys->get_number_of_components(), mass, 1.0, num_threads, acceleration);
+			if(TYPE==P3M) {
+				double cutoff = 4.5*mesh.get_split();
+				pmParallel::parallel_for(0, n, num_threads, [&](int const& start, int const& end) {
+					for(int i=start; i<end; i++) {
+						this->psys->for_each_neighbor(i, [&](int const& j, pmTensor const& rel_pos, pmTensor const& guide) {
+							double distance = rel_pos.norm();
+							if(distance==0 || distance>=cutoff) { return; }
+							double f = mass[j]*mesh.short_range(distance)/std::pow(distance, dimension);
+							for(int k=0; k<dimension; k++) {
+								acceleration[i*3+k] += f*rel_pos[k];
+							}
+						});
+					}
+				});
+			}
+		}
+		this->pairwise_result.resize(n);
+		pmParallel::parallel_for(0, n, num_threads, [&](int const& start, int const& end) {
+			for(int i=start; i<end; i++) {
+				pmTensor force{dimension,1,0.0};
+				for(int k=0; k<dimension; k++) {
+					force[k] = coef*mass[i]*acceleration[i*3+k];
+				}
+				this->pairwise_result[i] = force;
+			}
+		});
+		this->precomputed = true;
+	}
 }
 
-#endif //_PM_NBODY_H_
\ No newline at end of file
+#include "Color_undefine.h"
+
+#endif //_PM_NBODY_H_
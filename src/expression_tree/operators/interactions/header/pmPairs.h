@@ -25,22 +25,36 @@
 #include <memory>
 #include <vector>
 #include <utility>
+#include <string>
 
 namespace Nauticle {
 	using pmPair_data = std::pair<std::string,std::vector<double>>;
+
+	/** This class stores pairs of particles with arbitrary named data attached to them.
+	//  The particle indices and the data are stored in separate arrays (one per data).
+	//  The pairs of each particle are indexed by a compressed adjacency list, which is
+	//  rebuilt on the given number of threads by set_number_of_nodes, delete_marked_pairs,
+	//  remap and reorder (pairs added in between are not indexed until then). Marked pairs are removed by moving
+	//  the last pairs in their places, hence deletion does not preserve the order.
+	*/
 	class pmPairs {
 		std::vector<pmPair_data> pair_data;
-		std::vector<std::vector<size_t>> pair_index;
+		std::vector<int> adjacency_start;
+		std::vector<int> adjacency;
 		std::vector<size_t> delete_marker;
 		std::vector<int> first;
 		std::vector<int> second;
+		int num_nodes=0;
 	private:
-		void update_pair_idx();
+		void remove_marked();
 	public:
 		pmPairs() = default;
-		void set_number_of_nodes(int const& num_particles);
+		void set_number_of_nodes(int const& num_particles, size_t const& num_threads=1);
+		void build_adjacency(size_t const& num_threads=1);
 		void add_pair(int const& i1, int const& i2, std::vector<double> const& new_values_ordered);
-		void delete_marked_pairs();
+		void reserve(size_t const& num_pairs);
+		void delete_marked_pairs(size_t const& num_threads=1);
+		void remap(std::vector<int> const& new_index, int const& num_particles, size_t const& num_threads=1);
 		void reset();
 		int get_number_of_pairs() const;
 		std::vector<int> const& get_first() const;
@@ -50,9 +64,10 @@ namespace Nauticle {
 		std::vector<pmPair_data> const& get_data() const;
 		std::vector<double>& get_data(std::string const& name);
 		std::vector<double> const& get_data(std::string const& name) const;
-		std::vector<size_t> const& get_pair_index(size_t const& i) const;
-		std::vector<std::vector<size_t>> const& get_pair_index() const;
+		std::vector<int> const& get_adjacency_start() const;
+		std::vector<int> const& get_adjacency() const;
 		void mark_to_delete(size_t const& i);
+		void reorder(std::vector<int> const& order, size_t const& num_threads=1);
 	};
 }
 
@@ -25,6 +25,7 @@
 #include <array>
 #include <string>
 #include "pmFilter.h"
+#include "pmSph_sweep.h"
 #include "prolog/pLogger.h"
 #include "commonutils/Common.h"
 #include "nauticle_constants.h"
@@ -37,9 +38,12 @@ namespace Nauticle {
 	//  It requires a pmParticle_system assigned to it.
 	*/
 	template <OPERATOR_TYPE OP_TYPE, size_t VAR, size_t K, size_t NOPS>
-	class pmSph_operator : public pmFilter<NOPS> {
+	class pmSph_operator : public pmFilter<NOPS>, public pmSph_fusable {
+	private:
+		pmKernel weight;
 	private:
 		std::shared_ptr<pmExpression> clone_impl() const override;
+		bool is_pairwise() const;
 	public:
 		pmSph_operator() {}
 		pmSph_operator(std::array<std::shared_ptr<pmExpression>,NOPS> op);
@@ -51,6 +55,12 @@ namespace Nauticle {
 		void print() const override;
 		pmTensor process(pmTensor const& A_i, pmTensor const& A_j, double const& rho_i, double const& rho_j, double const& m_i, double const& m_j, pmTensor const& r_ji, double const& d_ji, double const& W_ij) const;
 		pmTensor evaluate(int const& i, size_t const& level=0) const override;
+		void precompute(size_t const& num_threads) override;
+		void begin(pmSph_accumulator& acc, int const& i, size_t const& level) const override;
+		void contribute(pmSph_accumulator& acc, int const& j, pmTensor const& rel_pos, double const& d_ji, pmTensor const& guide) const override;
+		void join_sweep(pmSph_sweep& sweep) override;
+		void set_precomputed(std::vector<pmTensor>& result) override;
+		int compile(pmBytecode& code, size_t const& level=0) const override;
 		std::shared_ptr<pmSph_operator> clone() const;
 	};
 
@@ -72,6 +82,9 @@ namespace Nauticle {
 		size_t type = (int)this->operand[NOPS==6?4:3]->evaluate(0)[0];
 		this->kernel = std::make_shared<pmKernel>();
 		this->kernel->set_kernel_type(type, !(OP_TYPE==INERTIA || OP_TYPE==SAMPLE || OP_TYPE==XSAMPLE));
+		if(OP_TYPE==TENSILE) {
+			weight.set_kernel_type(type, false);
+		}
 		this->op_name = std::string{"sph_"};
 		switch(OP_TYPE) {
 			case SAMPLE: this->op_name+=std::string{"S"}; break;
@@ -95,6 +108,7 @@ namespace Nauticle {
 	pmSph_operator<OP_TYPE,VAR,K,NOPS>::pmSph_operator(pmSph_operator const& other) {
 		this->assigned = false;
 		this->kernel = std::shared_ptr<pmKernel>(other.kernel);
+		this->weight = other.weight;
 		for(int i=0; i<this->operand.size(); i++) {
 			this->operand[i] = other.operand[i]->clone();
 		}
@@ -108,6 +122,7 @@ namespace Nauticle {
 	pmSph_operator<OP_TYPE,VAR,K,NOPS>::pmSph_operator(pmSph_operator&& other) {
 		this->psys = std::move(other.psys);
 		this->kernel = std::move(other.kernel);
+		this->weight = other.weight;
 		this->assigned = std::move(other.assigned);
 		this->operand = std::move(other.operand);
 		this->op_name = std::move(other.op_name);
@@ -121,6 +136,7 @@ namespace Nauticle {
 		if(this!=&other) {
 			this->assigned = false;
 			this->kernel = std::shared_ptr<pmKernel>(other.kernel);
+			this->weight = other.weight;
 			for(int i=0; i<this->operand.size(); i++) {
 				this->operand[i] = other.operand[i]->clone();
 			}
@@ -137,6 +153,7 @@ namespace Nauticle {
 		if(this!=&other) {
 			this->psys = std::move(other.psys);
 			this->kernel = std::move(other.kernel);
+			this->weight = other.weight;
 			this->assigned = std::move(other.assigned);
 			this->operand = std::move(other.operand);
 			this->op_name = std::move(other.op_name);
@@ -170,71 +187,221 @@ namespace Nauticle {
 	}
 	
 	/////////////////////////////////////////////////////////////////////////////////////////
-	/// Evaluates the operator for the ith node.
+	/// Evaluates the operands at the ith node and resets the accumulator.
 	/////////////////////////////////////////////////////////////////////////////////////////
 	template <OPERATOR_TYPE OP_TYPE, size_t VAR, size_t K, size_t NOPS>
-	pmTensor pmSph_operator<OP_TYPE,VAR,K,NOPS>::evaluate(int const& i, size_t const& level/*=0*/) const {
-		if(!this->assigned) { ProLog::pLogger::error_msgf("\"%s\" is not assigned to any particle system.\n", this->op_name.c_str()); }
+	void pmSph_operator<OP_TYPE,VAR,K,NOPS>::begin(pmSph_accumulator& acc, int const& i, size_t const& level) const {
 		size_t sh = 0;
-		pmTensor B_i{1,1,1};
+		acc.level = level;
+		acc.B_i = pmTensor{1,1,1};
 		if(NOPS==6) {
-			B_i = this->operand[0]->evaluate(i, level);
+			acc.B_i = this->operand[0]->evaluate(i, level);
 			sh++;
 		}
-		pmTensor A_i = this->operand[0+sh]->evaluate(i,level);
-		double m_i = this->operand[1+sh]->evaluate(i,level)[0];
-		double rho_i = this->operand[2+sh]->evaluate(i,level)[0];
-		double h_i = this->operand[4+sh]->evaluate(i,level)[0];
-		auto contribute = [&](pmTensor const& rel_pos, int const& i, int const& j, pmTensor const& cell_size, pmTensor const& guide)->pmTensor{
-			pmTensor contribution;
+		acc.A_i = this->operand[0+sh]->evaluate(i,level);
+		acc.m_i = this->operand[1+sh]->evaluate(i,level)[0];
+		acc.rho_i = this->operand[2+sh]->evaluate(i,level)[0];
+		acc.h_i = this->operand[4+sh]->evaluate(i,level)[0];
+		acc.h_last = -1.0;
+		acc.result = pmTensor{};
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Adds the contribution of the jth neighbour to the accumulator. The normalization of
+	/// the kernel is evaluated only if the smoothing radius changes.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <OPERATOR_TYPE OP_TYPE, size_t VAR, size_t K, size_t NOPS>
+	void pmSph_operator<OP_TYPE,VAR,K,NOPS>::contribute(pmSph_accumulator& acc, int const& j, pmTensor const& rel_pos, double const& d_ji, pmTensor const& guide) const {
+		if(d_ji <= NAUTICLE_EPS && OP_TYPE!=SAMPLE) { return; }
+		size_t sh = NOPS==6 ? 1 : 0;
+		size_t const& level = acc.level;
+		double h_j = this->operand[4+sh]->evaluate(j,level)[0];
+		double h_ij = (acc.h_i+h_j)/2.0;
+		if(d_ji >= h_ij) { return; }
+		pmTensor const& A_i = acc.A_i;
+		pmTensor const& B_i = acc.B_i;
+		pmTensor B_ij{1,1,1};
+		if(NOPS==6 && OP_TYPE==LAPLACE) {
+			pmTensor B_j = this->operand[0]->evaluate(j, level);
+			B_ij = (B_i+B_j)/2.0f;
+		}
+		pmTensor A_j;
+		if(this->operand[0+sh]->is_position()) {
+			A_j = rel_pos+A_i;
+		} else {
+			A_j = this->operand[0+sh]->evaluate(j,level).reflect_perpendicular(guide);
+		}
+		// TODO: optimise
+		if(!this->operand[0+sh]->is_symmetric()) {
+			int flip = 1;
+			for(int i=0; i<guide.numel(); i++) {
+				if(guide[i]!=0) {
+					flip *= -1;
+				}
+			}
+			A_j *= (double)flip;
+		}
+		double m_j = this->operand[1+sh]->evaluate(j,level)[0];
+		double rho_j = this->operand[2+sh]->evaluate(j,level)[0];
+		if(h_ij!=acc.h_last) {
+			double h = this->kernel->smoothing_radius(h_ij);
+			acc.h_last = h_ij;
+			acc.h_inv = 1.0/h;
+			acc.coefficient = this->kernel->coefficient(h);
+		}
+		double W_ij = acc.coefficient*this->kernel->shape(d_ji*acc.h_inv);
+		if(OP_TYPE==TENSILE) {
+			double f = weight.shape(d_ji*acc.h_inv)/weight.shape(B_ij[0]*acc.h_inv);
+			f*=f; f*=f;
+			acc.result += f*this->process(A_i, A_j, acc.rho_i, rho_j, acc.m_i, m_j, rel_pos, d_ji, W_ij);
+		} else if(OP_TYPE==AVISC && NOPS==6) {
+			double B_hat_i = std::max(0.0,std::min(1.0,(A_j[0]-A_i[0])/rel_pos[0]/B_i[0]))*B_i[0];
+			pmTensor A_R = A_j-B_hat_i*rel_pos/2;
+			pmTensor A_L = A_i+B_hat_i*rel_pos/2;
+			acc.result += this->process(A_L, A_R, acc.rho_i, rho_j, acc.m_i, m_j, rel_pos, d_ji, W_ij);
+		} else {
+			acc.result += B_ij*this->process(A_i, A_j, acc.rho_i, rho_j, acc.m_i, m_j, rel_pos, d_ji, W_ij);
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Evaluates the operator for the ith node.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <OPERATOR_TYPE OP_TYPE, size_t VAR, size_t K, size_t NOPS>
+	pmTensor pmSph_operator<OP_TYPE,VAR,K,NOPS>::evaluate(int const& i, size_t const& level/*=0*/) const {
+		if(!this->assigned) { ProLog::pLogger::error_msgf("\"%s\" is not assigned to any particle system.\n", this->op_name.c_str()); }
+		if(this->precomputed && level==0) {
+			return this->pairwise_result[i];
+		}
+		pmSph_accumulator acc;
+		this->begin(acc, i, level);
+		this->psys->for_each_neighbor(i, [&](int const& j, pmTensor const& rel_pos, pmTensor const& guide) {
+			this->contribute(acc, j, rel_pos, rel_pos.norm(), guide);
+		});
+		return acc.result;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns true if the operator is evaluated pairwise over the half stencil.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <OPERATOR_TYPE OP_TYPE, size_t VAR, size_t K, size_t NOPS>
+	bool pmSph_operator<OP_TYPE,VAR,K,NOPS>::is_pairwise() const {
+		bool symmetric_form = ((OP_TYPE==GRADIENT || OP_TYPE==DIVERGENCE) && VAR==1 && K==1) || (OP_TYPE==LAPLACE && VAR!=2);
+		return symmetric_form && this->assigned && this->psys->is_half_stencil();
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Joins the given sweep unless the operator is evaluated pairwise, its operands contain
+	/// interactions or they are overwritten before the operator is evaluated.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <OPERATOR_TYPE OP_TYPE, size_t VAR, size_t K, size_t NOPS>
+	void pmSph_operator<OP_TYPE,VAR,K,NOPS>::join_sweep(pmSph_sweep& sweep) {
+		if(this->precomputed || !this->assigned || this->is_pairwise() || sweep.is_affected(this)) { return; }
+		for(auto const& it:this->operand) {
+			if(it->is_interaction()) {
+				pmFilter<NOPS>::join_sweep(sweep);
+				return;
+			}
+		}
+		sweep.add(this, this->psys);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Stores the results evaluated by a sweep until release_precomputed is called.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <OPERATOR_TYPE OP_TYPE, size_t VAR, size_t K, size_t NOPS>
+	void pmSph_operator<OP_TYPE,VAR,K,NOPS>::set_precomputed(std::vector<pmTensor>& result) {
+		this->pairwise_result.swap(result);
+		this->precomputed = true;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Emits the operator into the given bytecode. Unless it is evaluated pairwise, it is
+	/// emitted as a neighbour sum specialised for the operator type and the template
+	/// parameters. Otherwise, or if the operands do not allow it, the results of the
+	/// operator are read by the bytecode.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <OPERATOR_TYPE OP_TYPE, size_t VAR, size_t K, size_t NOPS>
+	int pmSph_operator<OP_TYPE,VAR,K,NOPS>::compile(pmBytecode& code, size_t const& level/*=0*/) const {
+		if(!this->assigned || !code.is_lowering_interactions()) { return -1; }
+		if(!this->is_pairwise() && OP_TYPE!=TENSILE) {
+			size_t sh = NOPS==6 ? 1 : 0;
+			pmBytecode::pmNeighbor_sum sum;
+			sum.type = OP_TYPE;
+			sum.variant = VAR;
+			sum.k = K;
+			sum.num_operands = NOPS;
+			sum.position = this->operand[0+sh]->is_position();
+			sum.symmetric = this->operand[0+sh]->is_symmetric();
+			sum.operand[0] = NOPS==6 ? this->operand[0].get() : nullptr;
+			sum.operand[1] = this->operand[0+sh].get();
+			sum.operand[2] = this->operand[1+sh].get();
+			sum.operand[3] = this->operand[2+sh].get();
+			sum.operand[4] = this->operand[4+sh].get();
+			sum.smoothing_radius = this->kernel->get_smoothing_radius_function();
+			sum.coefficient = this->kernel->get_coefficient_function();
+			sum.shape = this->kernel->get_shape_function();
+			sum.psys = this->psys.get();
+			int r = code.load_neighbor_sum(this, sum, level);
+			if(r>=0) { return r; }
+		}
+		return pmFilter<NOPS>::compile(code, level);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Evaluates the symmetric forms (GRADIENT and DIVERGENCE with VAR=1 and K=1, and
+	/// LAPLACE) for all nodes pairwise if the half stencil is turned on. The kernel and the
+	/// operands are evaluated only once for each pair.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <OPERATOR_TYPE OP_TYPE, size_t VAR, size_t K, size_t NOPS>
+	void pmSph_operator<OP_TYPE,VAR,K,NOPS>::precompute(size_t const& num_threads) {
+		if(this->precomputed) { return; }
+		pmFilter<NOPS>::precompute(num_threads);
+		if(!this->is_pairwise()) { return; }
+		size_t sh = NOPS==6 ? 1 : 0;
+		bool position = this->operand[0+sh]->is_position();
+		auto contribute = [&](pmTensor const& rel_pos, int const& i, int const& j, pmTensor const& cell_size, pmTensor const& guide, bool const& mutual, pmTensor& contribution_i, pmTensor& contribution_j) {
 			double d_ji = rel_pos.norm();
-			if(d_ji > NAUTICLE_EPS || OP_TYPE==SAMPLE) {
-				double h_j = this->operand[4+sh]->evaluate(j,level)[0];
-				double h_ij = (h_i+h_j)/2.0;
-				if(d_ji < h_ij) {
-					pmTensor B_ij{1,1,1};
-					if(NOPS==6 && OP_TYPE==LAPLACE) {
-						pmTensor B_j = this->operand[0]->evaluate(j, level);
-						B_ij = (B_i+B_j)/2.0f;
-					}
-					pmTensor A_j;
-					if(this->operand[0+sh]->is_position()) {
-						A_j = rel_pos+A_i;
-					} else {
-						A_j = this->operand[0+sh]->evaluate(j,level).reflect_perpendicular(guide);
-					}
-					// TODO: optimise
-					if(!this->operand[0+sh]->is_symmetric()) {
-						int flip = 1;
-						for(int i=0; i<guide.numel(); i++) {
-							if(guide[i]!=0) {
-								flip *= -1;
-							}
-						}
-						A_j *= (double)flip;
-					}
-					double m_j = this->operand[1+sh]->evaluate(j,level)[0];
-					double rho_j = this->operand[2+sh]->evaluate(j,level)[0];
-					double W_ij = this->kernel->evaluate(d_ji, h_ij);
-					if(OP_TYPE==TENSILE) {
-						pmKernel W;
-						W.set_kernel_type((int)this->operand[3+sh]->evaluate(0)[0], false);
-						double f = W.evaluate(d_ji, h_ij)/W.evaluate(B_ij[0], h_ij);
-						f*=f; f*=f;
-						contribution += f*this->process(A_i, A_j, rho_i, rho_j, m_i, m_j, rel_pos, d_ji, W_ij);
-					} else if(OP_TYPE==AVISC && NOPS==6) {
-						double B_hat_i = std::max(0.0,std::min(1.0,(A_j[0]-A_i[0])/rel_pos[0]/B_i[0]))*B_i[0];
-						pmTensor A_R = A_j-B_hat_i*rel_pos/2;
-						pmTensor A_L = A_i+B_hat_i*rel_pos/2;
-						contribution += this->process(A_L, A_R, rho_i, rho_j, m_i, m_j, rel_pos, d_ji, W_ij);
-					} else {
-						contribution += B_ij*this->process(A_i, A_j, rho_i, rho_j, m_i, m_j, rel_pos, d_ji, W_ij);
+			if(d_ji <= NAUTICLE_EPS) { return; }
+			double h_i = this->operand[4+sh]->evaluate(i,0)[0];
+			double h_j = this->operand[4+sh]->evaluate(j,0)[0];
+			double h_ij = (h_i+h_j)/2.0;
+			if(d_ji >= h_ij) { return; }
+			pmTensor B_ij{1,1,1};
+			if(NOPS==6 && OP_TYPE==LAPLACE) {
+				B_ij = (this->operand[0]->evaluate(i,0)+this->operand[0]->evaluate(j,0))/2.0f;
+			}
+			pmTensor A_i = this->operand[0+sh]->evaluate(i,0);
+			pmTensor A_j;
+			if(position) {
+				A_j = rel_pos+A_i;
+			} else {
+				A_j = this->operand[0+sh]->evaluate(j,0).reflect_perpendicular(guide);
+			}
+			if(!this->operand[0+sh]->is_symmetric()) {
+				int flip = 1;
+				for(int i=0; i<guide.numel(); i++) {
+					if(guide[i]!=0) {
+						flip *= -1;
 					}
 				}
+				A_j *= (double)flip;
+			}
+			double m_i = this->operand[1+sh]->evaluate(i,0)[0];
+			double m_j = this->operand[1+sh]->evaluate(j,0)[0];
+			double rho_i = this->operand[2+sh]->evaluate(i,0)[0];
+			double rho_j = this->operand[2+sh]->evaluate(j,0)[0];
+			double W_ij = this->kernel->evaluate(d_ji, h_ij);
+			contribution_i = B_ij*this->process(A_i, A_j, rho_i, rho_j, m_i, m_j, rel_pos, d_ji, W_ij);
+			if(mutual) {
+				if(position) {
+					A_j = this->operand[0+sh]->evaluate(j,0);
+					A_i = A_j-rel_pos;
+				}
+				contribution_j = B_ij*this->process(A_j, A_i, rho_j, rho_i, m_j, m_i, -rel_pos, d_ji, W_ij);
 			}
-			return contribution;
 		};
-		return this->interact(i, contribute);
+		this->interact_pairwise(contribute, num_threads);
 	}
 	
 	/////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,81 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+
+#ifndef _PM_SPH_SWEEP_H_
+#define _PM_SPH_SWEEP_H_
+
+#include <memory>
+#include <vector>
+#include <string>
+#include "pmTensor.h"
+#include "pmExpression.h"
+#include "pmParticle_system.h"
+
+namespace Nauticle {
+	/** This structure holds the data of the central particle of an SPH operator
+	//  during the traversal of its neighbours and accumulates the contributions.
+	*/
+	struct pmSph_accumulator {
+		size_t level=0;
+		pmTensor A_i;
+		pmTensor B_i{1,1,1};
+		double m_i=0.0;
+		double rho_i=0.0;
+		double h_i=0.0;
+		double h_last=-1.0;
+		double coefficient=0.0;
+		double h_inv=0.0;
+		pmTensor result;
+	};
+
+	/** This interface is implemented by the operators which can be evaluated in a
+	//  common neighbour sweep (see pmSph_sweep).
+	*/
+	class pmSph_fusable {
+	public:
+		virtual ~pmSph_fusable() {}
+		virtual void begin(pmSph_accumulator& acc, int const& i, size_t const& level) const=0;
+		virtual void contribute(pmSph_accumulator& acc, int const& j, pmTensor const& rel_pos, double const& d_ji, pmTensor const& guide) const=0;
+		virtual void set_precomputed(std::vector<pmTensor>& result)=0;
+	};
+
+	/** This class evaluates several SPH operators for the whole particle system in a
+	//  single traversal of the neighbours. The operators join the sweep through the
+	//  join_sweep function of the expression trees in the order of the equations. The
+	//  lhs of each equation is registered by add_written, and an operator joins only if
+	//  none of its operands (including the positions) refers to the symbols written by
+	//  the preceding equations, hence the results are identical to the ones evaluated
+	//  separately. The results are kept by the operators until they are released.
+	*/
+	class pmSph_sweep {
+		std::shared_ptr<pmParticle_system> psys;
+		std::vector<pmSph_fusable*> member;
+		std::vector<std::string> written;
+	public:
+		void add_written(std::string const& symbol_name);
+		bool is_affected(pmExpression const* expression) const;
+		bool add(pmSph_fusable* op, std::shared_ptr<pmParticle_system> const& ps);
+		size_t get_number_of_members() const;
+		void execute(size_t const& num_threads);
+	};
+}
+
+#endif //_PM_SPH_SWEEP_H_
@@ -31,9 +31,15 @@ namespace Nauticle {
 	//  through interactions between particles. 
 	*/
 	class pmSpring : public pmLong_range<1,pmSpring> {
+		static constexpr int block_size = 128;
 		mutable std::vector<pmTensor> force;
+		std::vector<double> node_position;
+		std::vector<double> node_velocity;
+		std::vector<double> spring_force;
 	private:
 		std::shared_ptr<pmExpression> clone_impl() const override;
+		double const* gather_nodes(size_t const& level, size_t const& num_threads);
+		void compute_springs(int const& begin, int const& end, double const* velocity, size_t const& level);
 	public:
 		pmSpring(std::array<std::shared_ptr<pmExpression>,1> op);
 		pmSpring(pmSpring const& other);
@@ -44,7 +50,7 @@ namespace Nauticle {
 		std::shared_ptr<pmSpring> clone() const;
 		pmTensor evaluate(int const& i, size_t const& level=0) const override;
 		void print() const override;
-		virtual void update(size_t const& level=0) override;
+		virtual void update(size_t const& level=0, size_t const& num_threads=1) override;
 		virtual void set_storage_depth(size_t const& d) override;
 	};
 }
@@ -19,7 +19,9 @@
 */
 
 #include "pmCollision_handler.h"
+#include "pmParallel.h"
 #include "Color_define.h"
+#include <algorithm>
 
 using namespace Nauticle;
 
@@ -54,9 +56,11 @@ pmCollision_handler::pmCollision_handler(pmCollision_handler const& other) {
 	this->assigned = false;
 	for(int i=0; i<this->operand.size(); i++) {
 		this->operand[i] = other.operand[i]->clone();
-		this->count = other.count;
 	}
 	this->op_name = other.op_name;
+	this->pairs = other.pairs;
+	this->num_threads = other.num_threads;
+	this->count = other.count;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -67,6 +71,8 @@ pmCollision_handler::pmCollision_handler(pmCollision_handler&& other) {
 	this->assigned = std::move(other.assigned);
 	this->operand = std::move(other.operand);
 	this->op_name = std::move(other.op_name);
+	this->pairs = std::move(other.pairs);
+	this->num_threads = other.num_threads;
 	this->count = std::move(other.count);
 }
 
@@ -78,9 +84,11 @@ pmCollision_handler& pmCollision_handler::operator=(pmCollision_handler const& o
 		this->assigned = false;
 		for(int i=0; i<this->operand.size(); i++) {
 			this->operand[i] = other.operand[i]->clone();
-			this->count = other.count;
 		}
 		this->op_name = other.op_name;
+		this->pairs = other.pairs;
+		this->num_threads = other.num_threads;
+		this->count = other.count;
 	}
 	return *this;
 }
@@ -94,6 +102,8 @@ pmCollision_handler& pmCollision_handler::operator=(pmCollision_handler&& other)
 		this->assigned = std::move(other.assigned);
 		this->operand = std::move(other.operand);
 		this->op_name = std::move(other.op_name);
+		this->pairs = std::move(other.pairs);
+		this->num_threads = other.num_threads;
 		this->count = std::move(other.count);
 	}
 	return *this;
@@ -147,101 +157,165 @@ void pmCollision_handler::remove_unnecessary_pairs(size_t const& level/*=0*/) {
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Generate pairs if the pairing condition is met.
+/// Generate pairs if the pairing condition is met. The partners of each particle are
+/// sorted, hence the existing pairs are found by binary search. The candidates are
+/// collected by the threads over contiguous ranges of particles into separate buffers,
+/// which are appended to the pairs at once in the order of the particles.
 /////////////////////////////////////////////////////////////////////////////////////////
-void pmCollision_handler::create_pairs(int const& i, size_t const& level/*=0*/) {
+void pmCollision_handler::create_pairs(size_t const& level/*=0*/) {
 	if(!this->assigned) { ProLog::pLogger::error_msgf("Collision counter is not assigned to any particle system.\n"); }
-	double Ri = this->operand[0]->evaluate(i,level)[0];
-	double condition_i = this->operand[2]->evaluate(i,level)[0];
-	std::vector<size_t> const& pair_index_i = pmConnectivity<pmCollision_handler>::pairs[level].get_pair_index(i);
-	auto contribute = [&](pmTensor const& rel_pos, int const& i, int const& j, pmTensor const& cell_size, pmTensor const& guide)->pmTensor{
-		for(auto const& it:pair_index_i) {
-			if(pmConnectivity<pmCollision_handler>::pairs[level].get_first()[it]==j || pmConnectivity<pmCollision_handler>::pairs[level].get_second()[it]==j) {
-				return pmTensor{1,1,0};
+	pmPairs& collisions = pmConnectivity<pmCollision_handler>::pairs[level];
+	std::vector<int> const& first = collisions.get_first();
+	std::vector<int> const& second = collisions.get_second();
+	std::vector<int> const& adjacency_start = collisions.get_adjacency_start();
+	std::vector<int> const& adjacency = collisions.get_adjacency();
+	int n = this->psys->get_field_size();
+	std::vector<int> partner(adjacency.size());
+	pmParallel::parallel_for(0, n, num_threads, [&](int const& start, int const& end){
+		for(int i=start; i<end; i++) {
+			for(int k=adjacency_start[i]; k<adjacency_start[i+1]; k++) {
+				int pi = adjacency[k];
+				partner[k] = first[pi]==i ? second[pi] : first[pi];
 			}
+			std::sort(partner.begin()+adjacency_start[i], partner.begin()+adjacency_start[i+1]);
 		}
-		double d_ji = rel_pos.norm();
-		if(d_ji > NAUTICLE_EPS && i<j) {
-			double Rj = this->operand[0]->evaluate(j,level)[0];
-			double condition_j = this->operand[2]->evaluate(j,level)[0];
-			double min_dist = Ri + Rj;
-			if(d_ji < min_dist && condition_i && condition_j) {
-				std::vector<double> data = {d_ji, 0.0, min_dist/100.0, 0.0, 0.0};
-				pmConnectivity<pmCollision_handler>::pairs[level].add_pair(i,j,data);
+	});
+	struct pmCandidate {
+		int i;
+		int j;
+		double distance;
+		double min_dist;
+	};
+	int nt = std::max(1, std::min((int)num_threads, n));
+	int ppt = (n+nt-1)/nt; // particles per thread
+	std::vector<std::vector<pmCandidate>> candidates(nt);
+	pmParallel::parallel_for(0, nt, nt, [&](int const& t_begin, int const& t_end){
+		for(int t=t_begin; t<t_end; t++) {
+			std::vector<pmCandidate>& buffer = candidates[t];
+			int p_end = std::min(n, (t+1)*ppt);
+			for(int i=t*ppt; i<p_end; i++) {
+				double Ri = this->operand[0]->evaluate(i,level)[0];
+				double condition_i = this->operand[2]->evaluate(i,level)[0];
+				if(!condition_i) { continue; }
+				auto partner_begin = partner.begin()+adjacency_start[i];
+				auto partner_end = partner.begin()+adjacency_start[i+1];
+				size_t buffer_start = buffer.size();
+				this->psys->for_each_neighbor(i, [&](int const& j, pmTensor const& rel_pos, pmTensor const& guide) {
+					if(j<=i) { return; }
+					double d_ji = rel_pos.norm();
+					if(d_ji <= NAUTICLE_EPS) { return; }
+					double Rj = this->operand[0]->evaluate(j,level)[0];
+					double condition_j = this->operand[2]->evaluate(j,level)[0];
+					double min_dist = Ri + Rj;
+					if(d_ji < min_dist && condition_j && !std::binary_search(partner_begin, partner_end, j)) {
+						buffer.push_back(pmCandidate{i, j, d_ji, min_dist});
+					}
+				});
+				// a neighbour can be found through several periodic images
+				std::sort(buffer.begin()+buffer_start, buffer.end(), [](pmCandidate const& a, pmCandidate const& b){ return a.j<b.j; });
+				buffer.erase(std::unique(buffer.begin()+buffer_start, buffer.end(), [](pmCandidate const& a, pmCandidate const& b){ return a.j==b.j; }), buffer.end());
 			}
 		}
-	};
-	this->interact(i, contribute);
+	});
+	size_t num_candidates = 0;
+	for(auto const& it:candidates) {
+		num_candidates += it.size();
+	}
+	collisions.reserve(collisions.get_number_of_pairs()+num_candidates);
+	for(auto const& it:candidates) {
+		for(auto const& c:it) {
+			collisions.add_pair(c.i, c.j, std::vector<double>{c.distance, 0.0, c.min_dist/100.0, 0.0, 0.0});
+		}
+	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Evaluate the pairs.
+/// Evaluate the pairs. The hysteresis of the pairs is evaluated in parallel using the radii
+/// at the beginning of the evaluation, then the radii of the colliding particles are
+/// updated in the order of the pairs.
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmCollision_handler::evaluate_pairs(size_t const& level/*=0*/) {
 	if(!this->assigned) { ProLog::pLogger::error_msgf("Collision counter is not assigned to any particle system.\n"); }
-	auto first = pmConnectivity<pmCollision_handler>::pairs[level].get_first();
-	auto second = pmConnectivity<pmCollision_handler>::pairs[level].get_second();
-	std::vector<double> const& alpha = pmConnectivity<pmCollision_handler>::pairs[level].get_data("alpha");
-	std::vector<double> const& beta = pmConnectivity<pmCollision_handler>::pairs[level].get_data("beta");
-	std::vector<double>& event = pmConnectivity<pmCollision_handler>::pairs[level].get_data("event");
-	std::vector<double>& state = pmConnectivity<pmCollision_handler>::pairs[level].get_data("state");
-	for(int pi=0; pi<pairs[level].get_number_of_pairs(); pi++) {
-		int i = first[pi];
-		int j = second[pi];
-		double Ri = this->operand[0]->evaluate(i,level)[0];
-		double Rj = this->operand[0]->evaluate(j,level)[0];
-		pmTensor pos_i = this->psys->get_value(i);
-		pmTensor pos_j = this->psys->get_value(j);
-		pmTensor rel_pos = pos_j-pos_i;
-		double d_ji = rel_pos.norm();
-		double min_dist = Ri + Rj;
-		{
+	pmPairs& collisions = pmConnectivity<pmCollision_handler>::pairs[level];
+	std::vector<int> const& first = collisions.get_first();
+	std::vector<int> const& second = collisions.get_second();
+	std::vector<double> const& alpha = collisions.get_data("alpha");
+	std::vector<double> const& beta = collisions.get_data("beta");
+	std::vector<double>& event = collisions.get_data("event");
+	std::vector<double>& state = collisions.get_data("state");
+	int num_pairs = collisions.get_number_of_pairs();
+	pmParallel::parallel_for(0, num_pairs, num_threads, [&](int const& start, int const& end){
+		for(int pi=start; pi<end; pi++) {
+			int i = first[pi];
+			int j = second[pi];
+			double Ri = this->operand[0]->evaluate(i,level)[0];
+			double Rj = this->operand[0]->evaluate(j,level)[0];
+			pmTensor pos_i = this->psys->get_value(i);
+			pmTensor pos_j = this->psys->get_value(j);
+			pmTensor rel_pos = pos_j-pos_i;
+			double d_ji = rel_pos.norm();
+			double min_dist = Ri + Rj;
 			double x = min_dist-d_ji;
 			if(x<alpha[pi] && (bool)state[pi]) {
-		        state[pi] = 0.0;
-		        event[pi] = -1.0;
-		    } else if(x>beta[pi] && !(bool)state[pi]) {
-		        state[pi] = 1.0;
-		        event[pi] = 1.0;
-		    } else {
-		        event[pi] = 0.0;
-		    }
+				state[pi] = 0.0;
+				event[pi] = -1.0;
+			} else if(x>beta[pi] && !(bool)state[pi]) {
+				state[pi] = 1.0;
+				event[pi] = 1.0;
+			} else {
+				event[pi] = 0.0;
+			}
 		}
+	});
+	std::shared_ptr<pmSymbol> radius;
+	for(int pi=0; pi<num_pairs; pi++) {
 		if(event[pi]>0.0+NAUTICLE_EPS) {
+			if(!radius) {
+				radius = std::dynamic_pointer_cast<pmSymbol>(this->operand[0]);
+			}
+			int i = first[pi];
+			int j = second[pi];
+			double Ri = this->operand[0]->evaluate(i,level)[0];
+			double Rj = this->operand[0]->evaluate(j,level)[0];
 			double r = this->operand[3]->evaluate(0,level)[0];
 			double c = this->operand[4]->evaluate(0,level)[0];
 			double Ri_new = Ri-c*(std::pow(Ri,1.0+r)*std::pow(Rj,1.0-r))/(Ri+Rj);
 			double Rj_new = Rj-c*(std::pow(Ri,1.0-r)*std::pow(Rj,1.0+r))/(Ri+Rj);
-			std::dynamic_pointer_cast<pmSymbol>(this->operand[0])->set_value(Ri_new,i);
-			std::dynamic_pointer_cast<pmSymbol>(this->operand[0])->set_value(Rj_new,j);
+			radius->set_value(Ri_new,i);
+			radius->set_value(Rj_new,j);
 		}
 	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Count the collisions per particles.
+/// Count the collisions per particles. The events of the pairs are summed up for each
+/// particle in parallel using the adjacency list.
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmCollision_handler::count_collisions(size_t const& level/*=0*/) const {
+	pmPairs const& collisions = pmConnectivity<pmCollision_handler>::pairs[level];
+	std::vector<int> const& adjacency_start = collisions.get_adjacency_start();
+	std::vector<int> const& adjacency = collisions.get_adjacency();
+	std::vector<double> const& event = collisions.get_data("event");
 	count.resize(this->psys->get_field_size());
-	std::fill(count.begin(), count.end(), 0);
-	auto first = pmConnectivity<pmCollision_handler>::pairs[level].get_first();
-	auto second = pmConnectivity<pmCollision_handler>::pairs[level].get_second();
-	std::vector<double> const& event = pmConnectivity<pmCollision_handler>::pairs[level].get_data("event");
-	for(int i=0; i<first.size(); i++) {
-		count[first[i]] += event[i];
-		count[second[i]] += event[i];
-	}
+	pmParallel::parallel_for(0, count.size(), num_threads, [&](int const& start, int const& end){
+		for(int i=start; i<end; i++) {
+			double sum = 0.0;
+			for(int k=adjacency_start[i]; k<adjacency_start[i+1]; k++) {
+				sum += event[adjacency[k]];
+			}
+			count[i] = sum;
+		}
+	});
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Update the long range interaction.
 /////////////////////////////////////////////////////////////////////////////////////////
-void pmCollision_handler::update(size_t const& level/*=0*/) {
-	pmLong_range<5,pmCollision_handler>::update(level);
+void pmCollision_handler::update(size_t const& level/*=0*/, size_t const& num_threads/*=1*/) {
+	pmLong_range<5,pmCollision_handler>::update(level, num_threads);
 	remove_unnecessary_pairs(level);
-	for(int i=0; i<psys->get_field_size(); i++) {
-		create_pairs(i, level);
-	}
+	create_pairs(level);
+	pmConnectivity<pmCollision_handler>::pairs[level].build_adjacency(num_threads);
 	evaluate_pairs(level);
 	count_collisions(level);
 }
@@ -0,0 +1,321 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+
+#include "pmDem_contacts.h"
+#include "pmParallel.h"
+#include "pmSort.h"
+#include "nauticle_constants.h"
+#include <algorithm>
+
+using namespace Nauticle;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the integer code of the given image guide.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmDem_contacts::image_code(pmTensor const& guide) {
+	int code = 0;
+	for(int k=guide.numel()-1; k>=0; k--) {
+		code = code*3 + (int)guide[k]+1;
+	}
+	return code;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Rearranges the contacts such that the cth contact becomes the permutation[c]th one of
+/// the former order. Contacts not listed are dropped.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmDem_contacts::permute(std::vector<int> const& permutation) {
+	auto gather = [&](auto& data, int const& stride) {
+		typename std::remove_reference<decltype(data)>::type copy(permutation.size()*stride);
+		for(int c=0; c<permutation.size(); c++) {
+			std::copy_n(data.begin()+(size_t)permutation[c]*stride, stride, copy.begin()+(size_t)c*stride);
+		}
+		data.swap(copy);
+	};
+	gather(contact.first, 1);
+	gather(contact.second, 1);
+	gather(contact.image, 1);
+	gather(contact.mutual, 1);
+	gather(contact.rel_pos, 3);
+	gather(contact.coefficient, num_coefficients);
+	gather(contact.history, 3);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Builds the index of the contacts for the first and second particles. The contacts
+/// must be ordered by their first particle.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmDem_contacts::build_index(int const& num_nodes) {
+	int nc = contact.first.size();
+	start.assign(num_nodes+1, 0);
+	second_start.assign(num_nodes+1, 0);
+	for(int c=0; c<nc; c++) {
+		start[contact.first[c]+1]++;
+		if(contact.mutual[c]) {
+			second_start[contact.second[c]+1]++;
+		}
+	}
+	for(int i=0; i<num_nodes; i++) {
+		start[i+1] += start[i];
+		second_start[i+1] += second_start[i];
+	}
+	second_index.resize(second_start[num_nodes]);
+	std::vector<int> position(second_start.begin(), second_start.end()-1);
+	for(int c=0; c<nc; c++) {
+		if(contact.mutual[c]) {
+			second_index[position[contact.second[c]]++] = c;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Updates the contacts of the given particle system. Each thread visits the candidates
+/// of a contiguous range of particles and collects the overlapping pairs. Contacts which
+/// already existed keep their coefficients and tangential history (a mutual contact may
+/// be found from its other side, in which case the history is reversed), while the
+/// coefficients of the new contacts are evaluated by the given function. Contacts
+/// which are not overlapping anymore are removed.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmDem_contacts::update(pmParticle_system const& psys, Func_radius radius, Func_coefficients coefficients, size_t const& num_threads) {
+	int n = psys.get_field_size();
+	dimensions = psys.get_dimensions();
+	int previous_nodes = (int)start.size()-1;
+	int nt = std::max(1, std::min((int)num_threads, n));
+	int ppt = (n+nt-1)/nt; // particles per thread
+	std::vector<pmContact_buffer> buffer(nt);
+	auto find = [&](int const& i, int const& j, int const& code)->int {
+		if(i>=previous_nodes) { return -1; }
+		for(int c=start[i]; c<start[i+1]; c++) {
+			if(contact.second[c]==j && contact.image[c]==code) {
+				return c;
+			}
+		}
+		return -1;
+	};
+	auto detect = [&](int const& t_begin, int const& t_end) {
+		for(int t=t_begin; t<t_end; t++) {
+			pmContact_buffer& b = buffer[t];
+			int p_end = std::min(n, (t+1)*ppt);
+			for(int i=t*ppt; i<p_end; i++) {
+				double Ri = radius(i);
+				psys.for_each_half_neighbor(i, [&](int const& j, pmTensor const& rel_pos, pmTensor const& guide, bool const& mutual) {
+					double d_ji = rel_pos.norm();
+					if(d_ji <= NAUTICLE_EPS || d_ji >= Ri+radius(j)) { return; }
+					int code = image_code(guide);
+					b.first.push_back(i);
+					b.second.push_back(j);
+					b.image.push_back(code);
+					b.mutual.push_back(mutual);
+					for(int k=0; k<3; k++) {
+						b.rel_pos.push_back(k<dimensions ? rel_pos[k] : 0.0);
+					}
+					int previous = find(i, j, code);
+					double sign = 1.0;
+					if(previous<0 && mutual) {
+						previous = find(j, i, code);
+						sign = -1.0;
+					}
+					if(previous<0) {
+						size_t offset = b.coefficient.size();
+						b.coefficient.resize(offset+num_coefficients);
+						coefficients(i, j, &b.coefficient[offset]);
+						b.history.insert(b.history.end(), 3, 0.0);
+					} else {
+						auto coef = contact.coefficient.begin()+(size_t)previous*num_coefficients;
+						b.coefficient.insert(b.coefficient.end(), coef, coef+num_coefficients);
+						for(int k=0; k<3; k++) {
+							b.history.push_back(sign*contact.history[(size_t)previous*3+k]);
+						}
+					}
+				});
+			}
+		}
+	};
+	pmParallel::parallel_for(0, nt, nt, detect);
+	std::vector<size_t> offset(nt+1, 0);
+	for(int t=0; t<nt; t++) {
+		offset[t+1] = offset[t]+buffer[t].first.size();
+	}
+	size_t nc = offset[nt];
+	pmContact_buffer merged;
+	merged.first.resize(nc);
+	merged.second.resize(nc);
+	merged.image.resize(nc);
+	merged.mutual.resize(nc);
+	merged.rel_pos.resize(nc*3);
+	merged.coefficient.resize(nc*num_coefficients);
+	merged.history.resize(nc*3);
+	auto concatenate = [&](int const& t_begin, int const& t_end) {
+		for(int t=t_begin; t<t_end; t++) {
+			pmContact_buffer const& b = buffer[t];
+			std::copy(b.first.begin(), b.first.end(), merged.first.begin()+offset[t]);
+			std::copy(b.second.begin(), b.second.end(), merged.second.begin()+offset[t]);
+			std::copy(b.image.begin(), b.image.end(), merged.image.begin()+offset[t]);
+			std::copy(b.mutual.begin(), b.mutual.end(), merged.mutual.begin()+offset[t]);
+			std::copy(b.rel_pos.begin(), b.rel_pos.end(), merged.rel_pos.begin()+offset[t]*3);
+			std::copy(b.coefficient.begin(), b.coefficient.end(), merged.coefficient.begin()+offset[t]*num_coefficients);
+			std::copy(b.history.begin(), b.history.end(), merged.history.begin()+offset[t]*3);
+		}
+	};
+	pmParallel::parallel_for(0, nt, nt, concatenate);
+	contact = std::move(merged);
+	build_index(n);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Removes all contacts.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmDem_contacts::clear() {
+	contact = pmContact_buffer{};
+	start.clear();
+	second_start.clear();
+	second_index.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Renumbers the particles of the contacts. The ith particle becomes the new_index[i]th
+/// one, the contacts of the particles with negative new index are removed.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmDem_contacts::remap(std::vector<int> const& new_index, int const& num_nodes) {
+	std::vector<int> kept;
+	kept.reserve(contact.first.size());
+	for(int c=0; c<contact.first.size(); c++) {
+		if(new_index[contact.first[c]]>=0 && new_index[contact.second[c]]>=0) {
+			kept.push_back(c);
+		}
+	}
+	if(kept.size()<contact.first.size()) {
+		permute(kept);
+	}
+	int nc = contact.first.size();
+	for(int c=0; c<nc; c++) {
+		contact.first[c] = new_index[contact.first[c]];
+		contact.second[c] = new_index[contact.second[c]];
+	}
+	// counting sort by the first particle
+	std::vector<int> position(num_nodes+1, 0);
+	for(int c=0; c<nc; c++) {
+		position[contact.first[c]+1]++;
+	}
+	for(int i=0; i<num_nodes; i++) {
+		position[i+1] += position[i];
+	}
+	std::vector<int> permutation(nc);
+	for(int c=0; c<nc; c++) {
+		permutation[position[contact.first[c]]++] = c;
+	}
+	permute(permutation);
+	build_index(num_nodes);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Renumbers the contacts after the particles are reordered. The ith particle of the new
+/// order is the order[i]th particle of the old one.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmDem_contacts::reorder(std::vector<int> const& order) {
+	remap(pmSort::inverse(order), order.size());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the number of contacts.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmDem_contacts::get_number_of_contacts() const {
+	return contact.first.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the first particle of the cth contact.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmDem_contacts::get_first(int const& c) const {
+	return contact.first[c];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the second particle of the cth contact.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmDem_contacts::get_second(int const& c) const {
+	return contact.second[c];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns true if the cth contact acts on both particles.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmDem_contacts::is_mutual(int const& c) const {
+	return contact.mutual[c];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the position of the (image of the) second particle relative to the first one
+/// at the last update.
+/////////////////////////////////////////////////////////////////////////////////////////
+pmTensor pmDem_contacts::get_relative_position(int const& c) const {
+	pmTensor rel_pos{dimensions,1,0.0};
+	for(int k=0; k<dimensions; k++) {
+		rel_pos[k] = contact.rel_pos[(size_t)c*3+k];
+	}
+	return rel_pos;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the guide of the image of the second particle.
+/////////////////////////////////////////////////////////////////////////////////////////
+pmTensor pmDem_contacts::get_guide(int const& c) const {
+	pmTensor guide{dimensions,1,0.0};
+	int code = contact.image[c];
+	for(int k=0; k<dimensions; k++) {
+		guide[k] = code%3-1;
+		code /= 3;
+	}
+	return guide;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the cached coefficients of the cth contact.
+/////////////////////////////////////////////////////////////////////////////////////////
+double* pmDem_contacts::get_coefficients(int const& c) {
+	return &contact.coefficient[(size_t)c*num_coefficients];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the tangential history (three components) of the cth contact.
+/////////////////////////////////////////////////////////////////////////////////////////
+double* pmDem_contacts::get_history(int const& c) {
+	return &contact.history[(size_t)c*3];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Adds the contributions of the contacts to the result of their particles. The ith
+/// particle receives on_first of its own contacts and on_second of the mutual contacts
+/// in which it is the second particle.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmDem_contacts::gather(std::vector<pmTensor> const& on_first, std::vector<pmTensor> const& on_second, std::vector<pmTensor>& result, size_t const& num_threads) const {
+	int n = std::min((int)start.size()-1, (int)result.size());
+	pmParallel::parallel_for(0, n, num_threads, [&](int const& p_begin, int const& p_end) {
+		for(int i=p_begin; i<p_end; i++) {
+			for(int c=start[i]; c<start[i+1]; c++) {
+				result[i] += on_first[c];
+			}
+			for(int k=second_start[i]; k<second_start[i+1]; k++) {
+				result[i] += on_second[second_index[k]];
+			}
+		}
+	});
+}
@@ -88,20 +88,14 @@ void pmFmax::print() const {
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// This function performs the maximum search called by the member function evaluate(...)
-/// inherited from pmFsearch.
+/// Keeps the larger of the two values.
 /////////////////////////////////////////////////////////////////////////////////////////
-void pmFmax::process(pmTensor& value, size_t const& level/*=0*/) const {
-	pmTensor tensor = operand[0]->evaluate(0, level);
-	if(!tensor.is_scalar()) {
+void pmFmax::combine(pmTensor& value, pmTensor const& other) const {
+	if(!other.is_scalar()) {
 		ProLog::pLogger::error_msgf("Fmax can be evaluated only on scalar fields!\n");
 	}
-	value = operand[0]->evaluate(0, level);
-	for(int j=1; j<operand[0]->get_field_size(); j++) {
-		pmTensor tj = operand[0]->evaluate(j, level);
-		if(value(0,0)<tj(0,0)) {
-			value = tj;
-		}
+	if(value(0,0)<other(0,0)) {
+		value = other;
 	}
 }
 
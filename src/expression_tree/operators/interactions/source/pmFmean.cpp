@@ -88,16 +88,17 @@ void pmFmean::print() const {
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// This function performs the mean calculation called by the member function evaluate(...)
-/// inherited from pmFsearch.
-/////////////////////////////////////////////////////////////////////////////////////////
-void pmFmean::process(pmTensor& value, size_t const& level/*=0*/) const {
-	value = operand[0]->evaluate(0, level);
-	int num_points = operand[0]->get_field_size();
-	for(int j=1; j<num_points; j++) {
-		value += operand[0]->evaluate(j, level);
-	}
-	value/=pmTensor{1,1,(double)num_points};
+/// Accumulates the values. The mean is formed by finish.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmFmean::combine(pmTensor& value, pmTensor const& other) const {
+	value += other;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Divides the sum by the number of nodes.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmFmean::finish(pmTensor& value, int const& num_nodes) const {
+	value/=pmTensor{1,1,(double)num_nodes};
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
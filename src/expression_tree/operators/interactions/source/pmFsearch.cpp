@@ -23,14 +23,51 @@
 using namespace Nauticle;
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// This function performs the type-specific process (pmFmax, pmFmin, pmFmean).
+/// Performs the type-specific reduction (pmFmax, pmFmin, pmFsum, pmFmean) of the operand
+/// using the given number of threads.
+/////////////////////////////////////////////////////////////////////////////////////////
+pmTensor pmFsearch::reduce(size_t const& num_threads, size_t const& level/*=0*/) const {
+	int n = operand[0]->get_field_size();
+	if(n<1) { return pmTensor{1,1,0}; }
+	int ppt = (n+std::max(1,(int)num_threads)-1)/std::max(1,(int)num_threads); // nodes per partition
+	int nt = (n+ppt-1)/ppt;
+	std::vector<pmTensor> partial(nt);
+	pmParallel::parallel_for(0, nt, nt, [&](int const& t_begin, int const& t_end){
+		for(int t=t_begin; t<t_end; t++) {
+			int end = std::min(n, (t+1)*ppt);
+			partial[t] = operand[0]->evaluate(t*ppt, level);
+			for(int j=t*ppt+1; j<end; j++) {
+				combine(partial[t], operand[0]->evaluate(j, level));
+			}
+		}
+	});
+	for(int stride=1; stride<nt; stride*=2) {
+		for(int t=0; t+stride<nt; t+=2*stride) {
+			combine(partial[t], partial[t+stride]);
+		}
+	}
+	finish(partial[0], n);
+	return partial[0];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Computes and caches the reduction of the current values before the evaluation of
+/// the nodes.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmFsearch::precompute(size_t const& num_threads) {
+	pmInteraction<1>::precompute(num_threads);
+	result = reduce(num_threads);
+	precomputed = true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the cached result if precomputed, otherwise performs the reduction.
 /////////////////////////////////////////////////////////////////////////////////////////
 pmTensor pmFsearch::evaluate(int const& i, size_t const& level/*=0*/) const {
-	static pmTensor tensor{1,1};
-	if(i==0) {
-		process(tensor, level);
+	if(precomputed && level==0) {
+		return result;
 	}
-	return tensor;
+	return reduce(pmThread_pool::instance().get_number_of_threads(), level);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
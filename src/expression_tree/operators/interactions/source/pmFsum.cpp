@@ -88,16 +88,10 @@ void pmFsum::print() const {
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// This function performs the maximum search called by the member function evaluate(...)
-/// inherited from pmFsearch.
-/////////////////////////////////////////////////////////////////////////////////////////
-void pmFsum::process(pmTensor& value, size_t const& level/*=0*/) const {
-	pmTensor tensor = operand[0]->evaluate(0, level);
-	value = operand[0]->evaluate(0, level);
-	for(int j=1; j<operand[0]->get_field_size(); j++) {
-		pmTensor tj = operand[0]->evaluate(j, level);
-		value += tj;
-	}
+/// Accumulates the values.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmFsum::combine(pmTensor& value, pmTensor const& other) const {
+	value += other;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -114,6 +114,9 @@ void pmMd_operator::print() const {
 /////////////////////////////////////////////////////////////////////////////////////////
 pmTensor pmMd_operator::evaluate(int const& i, size_t const& level/*=0*/) const {
 	if(!this->assigned) { ProLog::pLogger::error_msgf("\"%s\" is not assigned to any particle system.\n", op_name.c_str()); }
+	if(this->precomputed && level==0) {
+		return this->pairwise_result[i];
+	}
 	size_t dimension = this->psys->get_dimensions();
 	double eps = this->operand[0]->evaluate(i,level)[0];
 	double sigma = this->operand[1]->evaluate(i,level)[0];
@@ -154,3 +157,39 @@ pmTensor pmMd_operator::evaluate(int const& i, size_t const& level/*=0*/) const
 
 
 
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Evaluates the operator for all nodes pairwise if the half stencil is turned on.
+/// The Lennard-Jones parameters are evaluated for both particles of the pair, hence the
+/// result is identical to the one of the evaluate function.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmMd_operator::precompute(size_t const& num_threads) {
+	pmInteraction<3>::precompute(num_threads);
+	if(!this->assigned || !this->psys->is_half_stencil()) { return; }
+	size_t dimension = this->psys->get_dimensions();
+	auto contribute = [&](pmTensor const& rel_pos, int const& i, int const& j, pmTensor const& cell_size, pmTensor const& guide, bool const& mutual, pmTensor& contribution_i, pmTensor& contribution_j) {
+		contribution_i = pmTensor{(int)dimension,1,0.0};
+		contribution_j = pmTensor{(int)dimension,1,0.0};
+		double d_ji = rel_pos.norm();
+		if(d_ji <= NAUTICLE_EPS) { return; }
+		double eps_i = this->operand[0]->evaluate(i,0)[0];
+		double sigma_i = this->operand[1]->evaluate(i,0)[0];
+		double R_i = this->operand[2]->evaluate(i,0)[0];
+		double sd6 = std::pow(sigma_i/d_ji,6);
+		if(d_ji < R_i) {
+			contribution_i -= 48.0*eps_i/d_ji/d_ji*(sd6*sd6-0.5*sd6)*rel_pos;
+		}
+		if(mutual) {
+			double eps_j = this->operand[0]->evaluate(j,0)[0];
+			double sigma_j = this->operand[1]->evaluate(j,0)[0];
+			double R_j = this->operand[2]->evaluate(j,0)[0];
+			if(d_ji < R_j) {
+				if(sigma_j!=sigma_i) {
+					sd6 = std::pow(sigma_j/d_ji,6);
+				}
+				contribution_j += 48.0*eps_j/d_ji/d_ji*(sd6*sd6-0.5*sd6)*rel_pos;
+			}
+		}
+	};
+	this->interact_pairwise(contribute, num_threads);
+}
@@ -20,26 +20,54 @@
 
 #include "pmPairs.h"
 #include "pmSort.h"
-#include "commonutils/Common.h"
+#include "pmParallel.h"
+#include <algorithm>
+#include <atomic>
 #include <numeric>
 
 using namespace Nauticle;
 
-void pmPairs::update_pair_idx() {
-	for(int i=0; i<first.size(); i++) {
-		pair_index[first[i]].push_back(i);
-		pair_index[second[i]].push_back(i);
-	}
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Sets the number of particles and rebuilds the adjacency list.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmPairs::set_number_of_nodes(int const& num_particles, size_t const& num_threads/*=1*/) {
+	num_nodes = num_particles;
+	build_adjacency(num_threads);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Fills the list of particles with the corresponding pair indices.
+/// Rebuilds the compressed adjacency list of the particles. The pairs are counted and
+/// scattered concurrently on num_threads threads, then the pair indices of each particle are sorted to keep the
+/// list independent of the scheduling.
 /////////////////////////////////////////////////////////////////////////////////////////
-void pmPairs::set_number_of_nodes(int const& num_particles) {
-	pair_index.resize(num_particles);
-	for(int i=0; i<first.size(); i++) {
-		pair_index[first[i]].push_back(i);
-		pair_index[second[i]].push_back(i);
+void pmPairs::build_adjacency(size_t const& num_threads/*=1*/) {
+	int num_pairs = first.size();
+	std::vector<std::atomic<int>> counter(num_nodes);
+	pmParallel::parallel_for(0, num_pairs, num_threads, [&](int const& start, int const& end){
+		for(int p=start; p<end; p++) {
+			counter[first[p]].fetch_add(1, std::memory_order_relaxed);
+			counter[second[p]].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+	adjacency_start.resize(num_nodes+1);
+	adjacency_start[0] = 0;
+	for(int i=0; i<num_nodes; i++) {
+		adjacency_start[i+1] = adjacency_start[i] + counter[i].load(std::memory_order_relaxed);
+		counter[i].store(0, std::memory_order_relaxed);
+	}
+	adjacency.resize(adjacency_start[num_nodes]);
+	pmParallel::parallel_for(0, num_pairs, num_threads, [&](int const& start, int const& end){
+		for(int p=start; p<end; p++) {
+			adjacency[adjacency_start[first[p]]+counter[first[p]].fetch_add(1, std::memory_order_relaxed)] = p;
+			adjacency[adjacency_start[second[p]]+counter[second[p]].fetch_add(1, std::memory_order_relaxed)] = p;
+		}
+	});
+	if(num_threads>1) {
+		pmParallel::parallel_for(0, num_nodes, num_threads, [&](int const& start, int const& end){
+			for(int i=start; i<end; i++) {
+				std::sort(adjacency.begin()+adjacency_start[i], adjacency.begin()+adjacency_start[i+1]);
+			}
+		});
 	}
 }
 
@@ -48,32 +76,86 @@ void pmPairs::set_number_of_nodes(int const& num_particles) {
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmPairs::add_pair(int const& i1, int const& i2, std::vector<double> const& new_values_ordered) {
 	if(i1==i2) { return; }
-	int const& p1 = i1<i2?i1:i2;
-	int const& p2 = i1>i2?i1:i2;
-	first.push_back(p1);
-	second.push_back(p2);
+	first.push_back(i1<i2?i1:i2);
+	second.push_back(i1<i2?i2:i1);
 	for(int i=0; i<pair_data.size(); i++) {
 		pair_data[i].second.push_back(new_values_ordered[i]);
 	}
-	pair_index[p1].push_back(first.size()-1); 
-	pair_index[p2].push_back(second.size()-1);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Returns the ith pair.
+/// Reserves storage for the given number of pairs.
 /////////////////////////////////////////////////////////////////////////////////////////
-void pmPairs::delete_marked_pairs() {
-	if(delete_marker.empty()) {
-		return;
+void pmPairs::reserve(size_t const& num_pairs) {
+	first.reserve(num_pairs);
+	second.reserve(num_pairs);
+	for(auto& it:pair_data) {
+		it.second.reserve(num_pairs);
 	}
-	Common::delete_indices(first, delete_marker);
-	Common::delete_indices(second, delete_marker);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Removes the marked pairs by replacing each of them with the last pair, hence the cost
+/// is proportional to the number of deleted pairs. The adjacency list is not updated.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmPairs::remove_marked() {
+	std::sort(delete_marker.begin(), delete_marker.end(), std::greater<size_t>());
+	delete_marker.erase(std::unique(delete_marker.begin(), delete_marker.end()), delete_marker.end());
+	auto swap_remove = [&](auto& data) {
+		for(auto const& it:delete_marker) {
+			data[it] = data.back();
+			data.pop_back();
+		}
+	};
+	swap_remove(first);
+	swap_remove(second);
 	for(auto& it:pair_data) {
-		Common::delete_indices(it.second, delete_marker);
+		swap_remove(it.second);
 	}
 	delete_marker.clear();
-	std::fill(pair_index.begin(), pair_index.end(), std::vector<size_t>{});
-	update_pair_idx();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Deletes the marked pairs.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmPairs::delete_marked_pairs(size_t const& num_threads/*=1*/) {
+	if(delete_marker.empty()) {
+		return;
+	}
+	remove_marked();
+	build_adjacency(num_threads);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Renumbers the particles of the pairs. The ith particle becomes the new_index[i]th one,
+/// the pairs of the particles with negative new index are deleted. The pairs are checked
+/// and renumbered in parallel in a single pass each.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmPairs::remap(std::vector<int> const& new_index, int const& num_particles, size_t const& num_threads/*=1*/) {
+	std::vector<char> deleted(first.size());
+	pmParallel::parallel_for(0, first.size(), num_threads, [&](int const& start, int const& end){
+		for(int i=start; i<end; i++) {
+			deleted[i] = new_index[first[i]]<0 || new_index[second[i]]<0;
+		}
+	});
+	for(int i=0; i<deleted.size(); i++) {
+		if(deleted[i]) {
+			delete_marker.push_back(i);
+		}
+	}
+	if(!delete_marker.empty()) {
+		remove_marked();
+	}
+	pmParallel::parallel_for(0, first.size(), num_threads, [&](int const& start, int const& end){
+		for(int i=start; i<end; i++) {
+			int p1 = new_index[first[i]];
+			int p2 = new_index[second[i]];
+			first[i] = p1<p2?p1:p2;
+			second[i] = p1<p2?p2:p1;
+		}
+	});
+	num_nodes = num_particles;
+	build_adjacency(num_threads);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -83,8 +165,10 @@ void pmPairs::reset() {
 	first.clear();
 	second.clear();
 	pair_data.clear();
-	pair_index.clear();
+	adjacency_start.clear();
+	adjacency.clear();
 	delete_marker.clear();
+	num_nodes = 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -142,17 +226,18 @@ std::vector<double> const& pmPairs::get_data(std::string const& name) const {
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Return the list of pair indices relating to the ith particle.
+/// Returns the offsets of the particles in the adjacency list. The pairs of the ith
+/// particle are stored between get_adjacency_start()[i] and get_adjacency_start()[i+1].
 /////////////////////////////////////////////////////////////////////////////////////////
-std::vector<size_t> const& pmPairs::get_pair_index(size_t const& i) const {
-	return pair_index[i];
+std::vector<int> const& pmPairs::get_adjacency_start() const {
+	return adjacency_start;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Return the list of pair indices of all particles.
+/// Returns the pair indices of all particles.
 /////////////////////////////////////////////////////////////////////////////////////////
-std::vector<std::vector<size_t>> const& pmPairs::get_pair_index() const {
-	return pair_index;
+std::vector<int> const& pmPairs::get_adjacency() const {
+	return adjacency;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -160,4 +245,12 @@ std::vector<std::vector<size_t>> const& pmPairs::get_pair_index() const {
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmPairs::mark_to_delete(size_t const& i) {
 	delete_marker.push_back(i);
-}
\ No newline at end of file
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Renumbers the particle indices of the pairs after the particles are reordered. The ith
+/// particle of the new order is the order[i]th particle of the old one.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmPairs::reorder(std::vector<int> const& order, size_t const& num_threads/*=1*/) {
+	remap(pmSort::inverse(order), order.size(), num_threads);
+}
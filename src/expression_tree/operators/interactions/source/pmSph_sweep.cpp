@@ -0,0 +1,100 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+
+#include "pmSph_sweep.h"
+#include "pmParallel.h"
+
+using namespace Nauticle;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Registers a symbol overwritten before the remaining operators are evaluated.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmSph_sweep::add_written(std::string const& symbol_name) {
+	for(auto const& it:written) {
+		if(it==symbol_name) { return; }
+	}
+	written.push_back(symbol_name);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns true if the given expression reads any of the written symbols.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmSph_sweep::is_affected(pmExpression const* expression) const {
+	for(auto const& it:written) {
+		if(expression->is_reading_neighbors(it)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Adds the given operator to the sweep. Only operators assigned to the same particle
+/// system can be evaluated together. Returns true if the operator is added.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmSph_sweep::add(pmSph_fusable* op, std::shared_ptr<pmParticle_system> const& ps) {
+	if(psys.use_count()==0) {
+		psys = ps;
+	} else if(psys!=ps) {
+		return false;
+	}
+	member.push_back(op);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the number of operators in the sweep.
+/////////////////////////////////////////////////////////////////////////////////////////
+size_t pmSph_sweep::get_number_of_members() const {
+	return member.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Evaluates all the operators of the sweep. The neighbours of each particle are visited
+/// once and passed to every operator. The distance is calculated only once per pair.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmSph_sweep::execute(size_t const& num_threads) {
+	if(member.empty()) { return; }
+	int n = psys->get_field_size();
+	size_t m = member.size();
+	std::vector<std::vector<pmTensor>> result(m, std::vector<pmTensor>(n));
+	auto process = [&](int const& start, int const& end) {
+		std::vector<pmSph_accumulator> acc(m);
+		for(int i=start; i<end; i++) {
+			for(size_t k=0; k<m; k++) {
+				member[k]->begin(acc[k], i, 0);
+			}
+			psys->for_each_neighbor(i, [&](int const& j, pmTensor const& rel_pos, pmTensor const& guide) {
+				double d_ji = rel_pos.norm();
+				for(size_t k=0; k<m; k++) {
+					member[k]->contribute(acc[k], j, rel_pos, d_ji, guide);
+				}
+			});
+			for(size_t k=0; k<m; k++) {
+				result[k][i] = acc[k].result;
+			}
+		}
+	};
+	pmParallel::parallel_for(0, n, num_threads, process);
+	for(size_t k=0; k<m; k++) {
+		member[k]->set_precomputed(result[k]);
+	}
+}
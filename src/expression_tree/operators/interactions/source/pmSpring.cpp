@@ -19,6 +19,8 @@
 */
 
 #include "pmSpring.h"
+#include "pmParallel.h"
+#include "pmField.h"
 #include "Color_define.h"
 
 using namespace Nauticle;
@@ -53,9 +55,10 @@ pmSpring::pmSpring(pmSpring const& other) {
 	this->assigned = false;
 	for(int i=0; i<this->operand.size(); i++) {
 		this->operand[i] = other.operand[i]->clone();
-		this->pairs[i] = other.pairs[i];
 	}
 	this->op_name = other.op_name;
+	this->pairs = other.pairs;
+	this->num_threads = other.num_threads;
 	this->force = other.force;
 }
 
@@ -68,6 +71,7 @@ pmSpring::pmSpring(pmSpring&& other) {
 	this->operand = std::move(other.operand);
 	this->op_name = std::move(other.op_name);
 	this->pairs = std::move(other.pairs);
+	this->num_threads = other.num_threads;
 	this->force = std::move(other.force);
 }
 
@@ -79,9 +83,10 @@ pmSpring& pmSpring::operator=(pmSpring const& other) {
 		this->assigned = false;
 		for(int i=0; i<this->operand.size(); i++) {
 			this->operand[i] = other.operand[i]->clone();
-			this->pairs[i] = other.pairs[i];
 		}
 		this->op_name = other.op_name;
+		this->pairs = other.pairs;
+		this->num_threads = other.num_threads;
 		this->force = other.force;
 	}
 	return *this;
@@ -97,6 +102,7 @@ pmSpring& pmSpring::operator=(pmSpring&& other) {
 		this->operand = std::move(other.operand);
 		this->op_name = std::move(other.op_name);
 		this->pairs = std::move(other.pairs);
+		this->num_threads = other.num_threads;
 		this->force = std::move(other.force);
 	}
 	return *this;
@@ -138,36 +144,129 @@ pmTensor pmSpring::evaluate(int const& i, size_t const& level/*=0*/) const {
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Computes spring forces.
+/// Gathers the positions (shifted by the periodic jumps) of the particles into a contiguous
+/// array and returns the contiguous velocities. If the velocity operand is a field, its
+/// data is used directly, otherwise it is evaluated once for each particle.
 /////////////////////////////////////////////////////////////////////////////////////////
-void pmSpring::update(size_t const& level/*=0*/) {
-	force.resize(this->psys->get_field_size(), pmTensor{(int)this->psys->get_dimensions(),1,0});
-	std::fill(force.begin(), force.end(), pmTensor{(int)this->psys->get_dimensions(),1,0});
-	this->set_number_of_nodes(this->psys->get_field_size());
-	if(!this->assigned) { ProLog::pLogger::error_msgf("Spring interaction is not assigned to any particle system.\n"); }
-	auto first = this->pairs[level].get_first();
-	auto second = this->pairs[level].get_second();
-	std::vector<double> const& initial_length = this->pairs[level].get_data("initial_length");
-	std::vector<double> const& strength = this->pairs[level].get_data("strength");
-	std::vector<double> const& damping = this->pairs[level].get_data("damping");
-	for(int pi=0; pi<pairs[level].get_number_of_pairs(); pi++) {
-		int i = first[pi];
-		int j = second[pi];
-		pmTensor pos_i = this->psys->get_value(i)+psys->get_periodic_shift(i);
-		pmTensor pos_j = this->psys->get_value(j)+psys->get_periodic_shift(j);
-		pmTensor rel_pos = pos_j-pos_i;
-		double d_ji = rel_pos.norm();
-		pmTensor vel_i = this->operand[0]->evaluate(i,level);
-		pmTensor vel_j = this->operand[0]->evaluate(j,level);
-		pmTensor rel_vel = vel_j-vel_i;
-		pmTensor dir = rel_pos/d_ji;
-		pmTensor fstr = dir*(d_ji-initial_length[pi])*strength[pi];
-		pmTensor fdmp = -dir*(rel_vel.transpose()*dir)*damping[pi];
-		force[i] += fstr-fdmp;
-		force[j] -= fstr-fdmp;
+double const* pmSpring::gather_nodes(size_t const& level, size_t const& num_threads) {
+	int n = this->psys->get_field_size();
+	int dims = this->psys->get_dimensions();
+	node_position.resize((size_t)n*dims);
+	std::shared_ptr<pmField> velocity_field = std::dynamic_pointer_cast<pmField>(this->operand[0]);
+	bool contiguous = velocity_field && velocity_field->get_number_of_components()==dims;
+	if(!contiguous) {
+		node_velocity.resize((size_t)n*dims);
+	}
+	pmParallel::parallel_for(0, n, num_threads, [&](int const& start, int const& end){
+		for(int i=start; i<end; i++) {
+			pmTensor pos_i = this->psys->get_value(i)+psys->get_periodic_shift(i);
+			for(int k=0; k<dims; k++) {
+				node_position[(size_t)i*dims+k] = pos_i[k];
+			}
+			if(!contiguous) {
+				pmTensor vel_i = this->operand[0]->evaluate(i,level);
+				for(int k=0; k<dims; k++) {
+					node_velocity[(size_t)i*dims+k] = vel_i[k];
+				}
+			}
+		}
+	});
+	return contiguous ? velocity_field->get_data(level) : node_velocity.data();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Computes the forces of the springs in the [begin,end) range. The springs are processed
+/// in blocks: the relative positions and velocities are gathered component by component,
+/// then the Hooke and damping terms are evaluated by simple loops over the block, which
+/// are vectorized by the compiler. The forces are stored component by component.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmSpring::compute_springs(int const& begin, int const& end, double const* velocity, size_t const& level) {
+	int dims = this->psys->get_dimensions();
+	pmPairs const& springs = this->pairs[level];
+	size_t num_springs = springs.get_number_of_pairs();
+	int const* first = springs.get_first().data();
+	int const* second = springs.get_second().data();
+	double const* initial_length = springs.get_data("initial_length").data();
+	double const* strength = springs.get_data("strength").data();
+	double const* damping = springs.get_data("damping").data();
+	double const* position = node_position.data();
+	double rel_pos[3][block_size];
+	double rel_vel[3][block_size];
+	double distance[block_size];
+	double projection[block_size];
+	for(int block=begin; block<end; block+=block_size) {
+		int n = std::min(block_size, end-block);
+		for(int k=0; k<dims; k++) {
+			for(int b=0; b<n; b++) {
+				size_t i = (size_t)first[block+b]*dims+k;
+				size_t j = (size_t)second[block+b]*dims+k;
+				rel_pos[k][b] = position[j]-position[i];
+				rel_vel[k][b] = velocity[j]-velocity[i];
+			}
+		}
+		for(int b=0; b<n; b++) {
+			distance[b] = 0.0;
+			projection[b] = 0.0;
+		}
+		for(int k=0; k<dims; k++) {
+			for(int b=0; b<n; b++) {
+				distance[b] += rel_pos[k][b]*rel_pos[k][b];
+				projection[b] += rel_vel[k][b]*rel_pos[k][b];
+			}
+		}
+		// Hooke and damping terms divided by the length (the force is parallel to rel_pos)
+		for(int b=0; b<n; b++) {
+			double d_ji = std::sqrt(distance[b]);
+			distance[b] = ((d_ji-initial_length[block+b])*strength[block+b] + projection[b]/d_ji*damping[block+b])/d_ji;
+		}
+		for(int k=0; k<dims; k++) {
+			double* force_k = spring_force.data()+k*num_springs+block;
+			for(int b=0; b<n; b++) {
+				force_k[b] = distance[b]*rel_pos[k][b];
+			}
+		}
 	}
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Computes spring forces. The force of each spring is computed in parallel, then the
+/// particles sum up the forces of their springs using the adjacency list of the pairs,
+/// hence no synchronization is needed.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmSpring::update(size_t const& level/*=0*/, size_t const& num_threads/*=1*/) {
+	if(!this->assigned) { ProLog::pLogger::error_msgf("Spring interaction is not assigned to any particle system.\n"); }
+	int n = this->psys->get_field_size();
+	int dims = this->psys->get_dimensions();
+	pmLong_range::update(level, num_threads);
+	pmPairs const& springs = this->pairs[level];
+	int num_springs = springs.get_number_of_pairs();
+	double const* velocity = gather_nodes(level, num_threads);
+	spring_force.resize((size_t)num_springs*dims);
+	pmParallel::parallel_for(0, num_springs, num_threads, [&](int const& start, int const& end){
+		compute_springs(start, end, velocity, level);
+	});
+	std::vector<int> const& first = springs.get_first();
+	std::vector<int> const& adjacency_start = springs.get_adjacency_start();
+	std::vector<int> const& adjacency = springs.get_adjacency();
+	force.resize(n);
+	pmParallel::parallel_for(0, n, num_threads, [&](int const& start, int const& end){
+		for(int i=start; i<end; i++) {
+			double sum[3] = {0.0, 0.0, 0.0};
+			for(int k=adjacency_start[i]; k<adjacency_start[i+1]; k++) {
+				int pi = adjacency[k];
+				double sign = first[pi]==i ? 1.0 : -1.0;
+				for(int d=0; d<dims; d++) {
+					sum[d] += sign*spring_force[(size_t)d*num_springs+pi];
+				}
+			}
+			force[i] = pmTensor{dims,1,0.0};
+			for(int d=0; d<dims; d++) {
+				force[i][d] = sum[d];
+			}
+		}
+	});
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Return the list of the first particles' indices.
 /////////////////////////////////////////////////////////////////////////////////////////
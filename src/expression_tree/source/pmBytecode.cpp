@@ -0,0 +1,1118 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+#include "pmBytecode.h"
+#include "pmExpression.h"
+#include "pmField.h"
+#include "pmSingle.h"
+#include "pmParticle_system.h"
+#include "pmSph_operator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <sstream>
+
+using namespace Nauticle;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Constructor. Interactions are lowered only if lower_interactions is true.
+/////////////////////////////////////////////////////////////////////////////////////////
+pmBytecode::pmBytecode(bool const& lower_interactions/*=false*/) {
+	interactions = lower_interactions;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Appends an instruction with a new destination register of the given shape. The
+/// destination is uniform if all the sources are uniform. Returns -1 if any of the
+/// sources is invalid.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::add_instruction(Opcode const& opcode, int const& rows, int const& columns, std::vector<int> const& source) {
+	bool uniform = opcode!=LOAD_FIELD && opcode!=INTERACTION && opcode!=NEIGHBOR_SUM;
+	for(auto const& it:source) {
+		if(it<0) { return -1; }
+		uniform = uniform && registers[it].uniform;
+	}
+	if(rows<1 || columns<1 || rows*columns>9) { return -1; }
+	pmRegister reg;
+	reg.rows = rows;
+	reg.columns = columns;
+	reg.uniform = uniform;
+	reg.offset = memory_size;
+	memory_size += uniform ? rows*columns : rows*columns*block_size;
+	registers.push_back(reg);
+	pmInstruction ins;
+	ins.opcode = opcode;
+	ins.destination = registers.size()-1;
+	for(int k=0; k<3; k++) {
+		ins.source[k] = k<source.size() ? source[k] : -1;
+	}
+	ins.single = nullptr;
+	ins.field = nullptr;
+	ins.interaction = nullptr;
+	ins.sum = -1;
+	ins.level = 0;
+	program.push_back(ins);
+	return ins.destination;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the number of elements of register r.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::numel(int const& r) const {
+	return registers[r].rows*registers[r].columns;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the position of the eth element of the first node of register r.
+/////////////////////////////////////////////////////////////////////////////////////////
+size_t pmBytecode::address(int const& r, int const& e) const {
+	return registers[r].offset + e*(registers[r].uniform ? 1 : block_size);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the distance of the values of consecutive nodes in register r.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::stride(int const& r) const {
+	return registers[r].uniform ? 0 : 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns true if register r holds scalars.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmBytecode::is_scalar(int const& r) const {
+	return r>=0 && numel(r)==1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits the loading of a constant tensor.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::load_constant(pmTensor const& value) {
+	int r = add_instruction(LOAD_CONSTANT, value.get_numrows(), value.get_numcols(), {});
+	if(r>=0) {
+		program.back().constant = value;
+	}
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits the loading of a constant or variable. Its value is read at execution.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::load_single(pmExpression const* single, size_t const& level) {
+	pmTensor value = single->evaluate(0, level);
+	int r = add_instruction(LOAD_SINGLE, value.get_numrows(), value.get_numcols(), {});
+	if(r>=0) {
+		program.back().single = single;
+		program.back().level = level;
+	}
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits the loading of a field.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::load_field(pmField const* field, size_t const& level) {
+	if(field->get_field_size()<1 || level>=field->get_storage_depth()) { return -1; }
+	int r = add_instruction(LOAD_FIELD, field->get_numrows(), field->get_numcols(), {});
+	if(r>=0) {
+		program.back().field = field;
+		program.back().level = level;
+	}
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits an interaction of the given shape. Its values are evaluated by the interaction
+/// itself for the nodes of the block.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::load_interaction(pmExpression const* interaction, int const& rows, int const& columns, size_t const& level) {
+	if(!interactions) { return -1; }
+	int r = add_instruction(INTERACTION, rows, columns, {});
+	if(r>=0) {
+		program.back().interaction = interaction;
+		program.back().level = level;
+	}
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits the neighbour sum of an SPH operator. The operands must be fields or singles and
+/// the shape of A must suit the operator. Returns -1 otherwise, then the operator can still
+/// be loaded by load_interaction.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::load_neighbor_sum(pmExpression const* interaction, pmNeighbor_sum const& sum, size_t const& level) {
+	if(!interactions || sum.psys==nullptr) { return -1; }
+	pmNeighbor_sum s = sum;
+	for(int o=0; o<5; o++) {
+		s.field[o] = nullptr;
+		s.rows[o] = 0;
+		s.columns[o] = 0;
+		if(s.operand[o]==nullptr) { continue; }
+		pmField const* field = dynamic_cast<pmField const*>(s.operand[o]);
+		if(field!=nullptr) {
+			if(field->get_field_size()<1 || level>=field->get_storage_depth()) { return -1; }
+			s.field[o] = field;
+			s.rows[o] = field->get_numrows();
+			s.columns[o] = field->get_numcols();
+		} else if(dynamic_cast<pmSingle const*>(s.operand[o])!=nullptr) {
+			pmTensor value = s.operand[o]->evaluate(0, level);
+			s.rows[o] = value.get_numrows();
+			s.columns[o] = value.get_numcols();
+		} else {
+			return -1;
+		}
+		if(o!=1 && s.rows[o]*s.columns[o]!=1) { return -1; }
+	}
+	int dimensions = s.psys->get_dimensions();
+	int rows = s.rows[1];
+	int columns = s.columns[1];
+	int n = rows*columns;
+	if(n<1 || n>9) { return -1; }
+	if(s.position && (s.field[1]==nullptr || n!=dimensions || columns!=1)) { return -1; }
+	if(!s.position && n>1 && rows!=dimensions) { return -1; }
+	bool column = columns==1;
+	switch(s.type) {
+		case SAMPLE : case XSAMPLE : break;
+		case INERTIA : {
+			if(rows!=1 && columns!=1) { return -1; }
+			rows = n;
+			columns = n;
+			break;
+		}
+		case GRADIENT : {
+			if(!column) { return -1; }
+			rows = n==1 ? dimensions : n;
+			columns = n==1 ? 1 : dimensions;
+			break;
+		}
+		case DIVERGENCE : {
+			if(!column || n!=dimensions) { return -1; }
+			rows = 1;
+			columns = 1;
+			break;
+		}
+		case LAPLACE : break;
+		case AVISC : {
+			if(s.num_operands!=5 || !column || n!=dimensions) { return -1; }
+			rows = dimensions;
+			columns = 1;
+			break;
+		}
+		default : return -1;
+	}
+	if(s.num_operands==6 && s.type!=LAPLACE) { return -1; }
+	int r = add_instruction(NEIGHBOR_SUM, rows, columns, {});
+	if(r>=0) {
+		program.back().interaction = interaction;
+		program.back().sum = sums.size();
+		program.back().level = level;
+		sums.push_back(s);
+	}
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns true if interactions are lowered into the program.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmBytecode::is_lowering_interactions() const {
+	return interactions;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits negation.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::negate(int const& a) {
+	if(a<0) { return -1; }
+	return add_instruction(NEGATE, registers[a].rows, registers[a].columns, {a});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits addition of tensors of identical shapes.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::add(int const& a, int const& b) {
+	if(a<0 || b<0) { return -1; }
+	if(registers[a].rows!=registers[b].rows || registers[a].columns!=registers[b].columns) { return -1; }
+	return add_instruction(ADD, registers[a].rows, registers[a].columns, {a,b});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits subtraction of tensors of identical shapes.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::subtract(int const& a, int const& b) {
+	if(a<0 || b<0) { return -1; }
+	if(registers[a].rows!=registers[b].rows || registers[a].columns!=registers[b].columns) { return -1; }
+	return add_instruction(SUBTRACT, registers[a].rows, registers[a].columns, {a,b});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits multiplication. If any of the operands is scalar, it is a scaling, otherwise
+/// it is a matrix product.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::multiply(int const& a, int const& b) {
+	if(a<0 || b<0) { return -1; }
+	if(is_scalar(b)) {
+		return add_instruction(SCALE, registers[a].rows, registers[a].columns, {a,b});
+	}
+	if(is_scalar(a)) {
+		return add_instruction(SCALE, registers[b].rows, registers[b].columns, {b,a});
+	}
+	if(registers[a].columns!=registers[b].rows) { return -1; }
+	return add_instruction(MATMUL, registers[a].rows, registers[b].columns, {a,b});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits division by a scalar.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::divide(int const& a, int const& b) {
+	if(a<0 || !is_scalar(b)) { return -1; }
+	return add_instruction(DIVIDE, registers[a].rows, registers[a].columns, {a,b});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits the power of scalars. Matrix powers are left to the interpreter.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::power(int const& a, int const& b) {
+	if(!is_scalar(a) || !is_scalar(b)) { return -1; }
+	return add_instruction(POWER, 1, 1, {a,b});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits transposition.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::transpose(int const& a) {
+	if(a<0) { return -1; }
+	return add_instruction(TRANSPOSE, registers[a].columns, registers[a].rows, {a});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits the magnitude of a vector or the absolute value of a scalar. The magnitude
+/// of other tensors is zero.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::magnitude(int const& a) {
+	if(a<0) { return -1; }
+	if(registers[a].rows!=1 && registers[a].columns!=1) {
+		return load_constant(pmTensor{1,1,0});
+	}
+	return add_instruction(MAGNITUDE, 1, 1, {a});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits a function acting on each element of the tensor.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::elementwise(Opcode const& opcode, int const& a) {
+	if(a<0) { return -1; }
+	return add_instruction(opcode, registers[a].rows, registers[a].columns, {a});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits a function acting on the corresponding elements of two tensors of identical shapes.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::elementwise(Opcode const& opcode, int const& a, int const& b) {
+	if(a<0 || b<0) { return -1; }
+	if(registers[a].rows!=registers[b].rows || registers[a].columns!=registers[b].columns) { return -1; }
+	return add_instruction(opcode, registers[a].rows, registers[a].columns, {a,b});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits a comparison or logical operation. Only the first elements are considered
+/// and the result is scalar. Logical "and" requires scalar operands.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::logical(Opcode const& opcode, int const& a, int const& b/*=-1*/) {
+	if(opcode==NOT) {
+		return add_instruction(NOT, 1, 1, {a});
+	}
+	if(opcode==AND && (!is_scalar(a) || !is_scalar(b))) { return -1; }
+	return add_instruction(opcode, 1, 1, {a,b});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits the selection between tensors of identical shapes based on the condition.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::select(int const& condition, int const& a, int const& b) {
+	if(condition<0 || a<0 || b<0) { return -1; }
+	if(registers[a].rows!=registers[b].rows || registers[a].columns!=registers[b].columns) { return -1; }
+	return add_instruction(IF, registers[a].rows, registers[a].columns, {condition,a,b});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits the limitation of the first element between the first elements of minimum and maximum.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::limit(int const& a, int const& minimum, int const& maximum) {
+	return add_instruction(LIMIT, 1, 1, {a,minimum,maximum});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the number of doubles required to execute the program for a block.
+/////////////////////////////////////////////////////////////////////////////////////////
+size_t pmBytecode::get_memory_size() const {
+	return memory_size;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the number of instructions.
+/////////////////////////////////////////////////////////////////////////////////////////
+size_t pmBytecode::get_program_size() const {
+	return program.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Applies func to the elements of the source and stores the result in the destination.
+/////////////////////////////////////////////////////////////////////////////////////////
+template <typename F>
+void pmBytecode::map_unary(pmInstruction const& ins, int const& n, double* memory, F const& func) const {
+	int d = ins.destination;
+	int a = ins.source[0];
+	int np = registers[d].uniform ? 1 : n;
+	int sa = stride(a);
+	for(int e=0; e<numel(d); e++) {
+		double* pd = memory+address(d,e);
+		double const* pa = memory+address(a,e);
+		for(int p=0; p<np; p++) {
+			pd[p] = func(pa[p*sa]);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Applies func to the elements of the sources and stores the result in the destination.
+/// If broadcast is true, the first element of the second source is used for all elements.
+/////////////////////////////////////////////////////////////////////////////////////////
+template <typename F>
+void pmBytecode::map_binary(pmInstruction const& ins, int const& n, double* memory, bool const& broadcast, F const& func) const {
+	int d = ins.destination;
+	int a = ins.source[0];
+	int b = ins.source[1];
+	int np = registers[d].uniform ? 1 : n;
+	int sa = stride(a);
+	int sb = stride(b);
+	for(int e=0; e<numel(d); e++) {
+		double* pd = memory+address(d,e);
+		double const* pa = memory+address(a,e);
+		double const* pb = memory+address(b,broadcast?0:e);
+		for(int p=0; p<np; p++) {
+			pd[p] = func(pa[p*sa], pb[p*sb]);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Applies func to the first element of the first source and the elements of the other
+/// sources and stores the result in the destination.
+/////////////////////////////////////////////////////////////////////////////////////////
+template <typename F>
+void pmBytecode::map_ternary(pmInstruction const& ins, int const& n, double* memory, F const& func) const {
+	int d = ins.destination;
+	int a = ins.source[0];
+	int b = ins.source[1];
+	int c = ins.source[2];
+	int np = registers[d].uniform ? 1 : n;
+	int sa = stride(a);
+	int sb = stride(b);
+	int sc = stride(c);
+	for(int e=0; e<numel(d); e++) {
+		double* pd = memory+address(d,e);
+		double const* pa = memory+address(a,0);
+		double const* pb = memory+address(b,e);
+		double const* pc = memory+address(c,e);
+		for(int p=0; p<np; p++) {
+			pd[p] = func(pa[p*sa], pb[p*sb], pc[p*sc]);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Executes a single instruction for n nodes starting from the node first. The operations
+/// are performed in the same order as in the pmTensor operators.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmBytecode::execute_instruction(pmInstruction const& ins, int const& first, int const& n, double* memory) const {
+	int d = ins.destination;
+	int np = registers[d].uniform ? 1 : n;
+	switch(ins.opcode) {
+		case LOAD_CONSTANT : {
+			for(int e=0; e<numel(d); e++) {
+				memory[address(d,e)] = ins.constant[e];
+			}
+			break;
+		}
+		case LOAD_SINGLE : {
+			pmTensor value = ins.single->evaluate(0, ins.level);
+			for(int e=0; e<numel(d); e++) {
+				memory[address(d,e)] = value[e];
+			}
+			break;
+		}
+		case LOAD_FIELD : {
+			int n = numel(d);
+			double const* data = ins.field->get_data(ins.level)+(size_t)first*n;
+			for(int e=0; e<n; e++) {
+				double* destination = &memory[address(d,e)];
+				for(int p=0; p<np; p++) {
+					destination[p] = data[(size_t)p*n+e];
+				}
+			}
+			break;
+		}
+		case NEGATE : map_unary(ins, n, memory, [](double x){ return -x; }); break;
+		case ADD : map_binary(ins, n, memory, false, [](double x, double y){ return x+y; }); break;
+		case SUBTRACT : map_binary(ins, n, memory, false, [](double x, double y){ return x-y; }); break;
+		case SCALE : map_binary(ins, n, memory, true, [](double x, double y){ return x*y; }); break;
+		case DIVIDE : map_binary(ins, n, memory, true, [](double x, double y){ return x/y; }); break;
+		case TERM_MULTIPLY : map_binary(ins, n, memory, false, [](double x, double y){ return x*y; }); break;
+		case TERM_DIVIDE : map_binary(ins, n, memory, false, [](double x, double y){ return x/y; }); break;
+		case POWER : map_binary(ins, n, memory, false, [](double x, double y){ return std::pow(x,y); }); break;
+		case MATMUL : {
+			int a = ins.source[0];
+			int b = ins.source[1];
+			int sa = stride(a);
+			int sb = stride(b);
+			int inner = registers[a].columns;
+			int jmax = registers[d].columns;
+			for(int i=0; i<registers[d].rows; i++) {
+				for(int j=0; j<jmax; j++) {
+					double* pd = memory+address(d,i*jmax+j);
+					for(int p=0; p<np; p++) {
+						double sum = 0;
+						for(int k=0; k<inner; k++) {
+							sum += memory[address(a,i*inner+k)+p*sa]*memory[address(b,k*jmax+j)+p*sb];
+						}
+						pd[p] = sum;
+					}
+				}
+			}
+			break;
+		}
+		case TRANSPOSE : {
+			int a = ins.source[0];
+			int sa = stride(a);
+			int rows = registers[a].rows;
+			int columns = registers[a].columns;
+			for(int i=0; i<rows; i++) {
+				for(int j=0; j<columns; j++) {
+					double* pd = memory+address(d,j*rows+i);
+					double const* pa = memory+address(a,i*columns+j);
+					for(int p=0; p<np; p++) {
+						pd[p] = pa[p*sa];
+					}
+				}
+			}
+			break;
+		}
+		case MAGNITUDE : {
+			int a = ins.source[0];
+			int sa = stride(a);
+			double* pd = memory+address(d,0);
+			if(numel(a)==1) {
+				double const* pa = memory+address(a,0);
+				for(int p=0; p<np; p++) {
+					pd[p] = std::abs(pa[p*sa]);
+				}
+				break;
+			}
+			for(int p=0; p<np; p++) {
+				double const* pa = memory+address(a,0);
+				double sum = pa[p*sa]*pa[p*sa];
+				for(int e=1; e<numel(a); e++) {
+					pa = memory+address(a,e);
+					sum += pa[p*sa]*pa[p*sa];
+				}
+				pd[p] = std::sqrt(sum);
+			}
+			break;
+		}
+		case ABS : map_unary(ins, n, memory, [](double x){ return std::abs(x); }); break;
+		case ACOS : map_unary(ins, n, memory, [](double x){ return std::acos(x); }); break;
+		case ACOT : map_unary(ins, n, memory, [](double x){ return std::acos(x)/std::asin(x); }); break;
+		case ASIN : map_unary(ins, n, memory, [](double x){ return std::asin(x); }); break;
+		case ATAN : map_unary(ins, n, memory, [](double x){ return std::atan(x); }); break;
+		case COS : map_unary(ins, n, memory, [](double x){ return std::cos(x); }); break;
+		case COSH : map_unary(ins, n, memory, [](double x){ return std::cosh(x); }); break;
+		case COT : map_unary(ins, n, memory, [](double x){ return std::cos(x)/std::sin(x); }); break;
+		case COTH : map_unary(ins, n, memory, [](double x){ return 1/std::tanh(x); }); break;
+		case EXP : map_unary(ins, n, memory, [](double x){ return std::exp(x); }); break;
+		case FLOOR : map_unary(ins, n, memory, [](double x){ return std::floor(x+NAUTICLE_EPS); }); break;
+		case LOG : map_unary(ins, n, memory, [](double x){ return std::log(x); }); break;
+		case SGN : map_unary(ins, n, memory, [](double x){ return (double)((0.0 < x)-(x < 0.0)); }); break;
+		case SIN : map_unary(ins, n, memory, [](double x){ return std::sin(x); }); break;
+		case SINH : map_unary(ins, n, memory, [](double x){ return std::sinh(x); }); break;
+		case SQRT : map_unary(ins, n, memory, [](double x){ return std::sqrt(x); }); break;
+		case TAN : map_unary(ins, n, memory, [](double x){ return std::tan(x); }); break;
+		case TANH : map_unary(ins, n, memory, [](double x){ return std::tanh(x); }); break;
+		case TRUNC : map_unary(ins, n, memory, [](double x){ return std::trunc(x+NAUTICLE_EPS); }); break;
+		case MIN : map_binary(ins, n, memory, false, [](double x, double y){ return std::min(x,y); }); break;
+		case MAX : map_binary(ins, n, memory, false, [](double x, double y){ return std::max(x,y); }); break;
+		case MOD : map_binary(ins, n, memory, false, [](double x, double y){ return x-std::floor(x/y)*y; }); break;
+		case GT : map_binary(ins, n, memory, true, [](double x, double y){ return (double)(x>y); }); break;
+		case GTE : map_binary(ins, n, memory, true, [](double x, double y){ return (double)(x>=y); }); break;
+		case LT : map_binary(ins, n, memory, true, [](double x, double y){ return (double)(x<y); }); break;
+		case LTE : map_binary(ins, n, memory, true, [](double x, double y){ return (double)(x<=y); }); break;
+		case EQUAL : map_binary(ins, n, memory, true, [](double x, double y){ return (double)(x==y); }); break;
+		case NOTEQUAL : map_binary(ins, n, memory, true, [](double x, double y){ return (double)!(x==y); }); break;
+		case AND : map_binary(ins, n, memory, true, [](double x, double y){ return (double)(x && y); }); break;
+		case OR : map_binary(ins, n, memory, true, [](double x, double y){ return (double)(x || y); }); break;
+		case XOR : map_binary(ins, n, memory, true, [](double x, double y){ return (double)(x != y); }); break;
+		case NOT : map_unary(ins, n, memory, [](double x){ return (double)!(bool)x; }); break;
+		case IF : map_ternary(ins, n, memory, [](double c, double x, double y){ return (bool)c ? x : y; }); break;
+		case LIMIT : map_ternary(ins, n, memory, [](double x, double minimum, double maximum){ return x<minimum ? minimum : (x>maximum ? maximum : x); }); break;
+		case INTERACTION :
+		case NEIGHBOR_SUM : {
+			pmTensor value;
+			for(int p=0; p<np; p++) {
+				if(!evaluate_interaction(ins, first+p, value)) { return false; }
+				for(int e=0; e<numel(d); e++) {
+					memory[address(d,e)+p] = value[e];
+				}
+			}
+			break;
+		}
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Evaluates the interaction of the given instruction for the ith node into value. Empty
+/// results are replaced by zeros of the shape of the destination register. Returns false
+/// if the result has a different shape.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmBytecode::evaluate_interaction(pmInstruction const& ins, int const& i, pmTensor& value) const {
+	int d = ins.destination;
+	value = ins.interaction->evaluate(i, ins.level);
+	if(value.numel()==0) {
+		value = pmTensor{registers[d].rows, registers[d].columns, 0.0};
+		return true;
+	}
+	return value.get_numrows()==registers[d].rows && value.get_numcols()==registers[d].columns;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Executes the program for the n (at most block_size) nodes starting from the node first.
+/// Returns false if an interaction does not match its compiled shape.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmBytecode::execute(int const& first, int const& n, std::vector<double>& memory) const {
+	if(memory.size()<memory_size) {
+		memory.resize(memory_size);
+	}
+	for(auto const& it:program) {
+		if(!execute_instruction(it, first, n, memory.data())) { return false; }
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the value of register r for the pth node of the last executed block.
+/////////////////////////////////////////////////////////////////////////////////////////
+pmTensor pmBytecode::get_tensor(std::vector<double> const& memory, int const& r, int const& p) const {
+	pmTensor tensor{registers[r].rows, registers[r].columns};
+	for(int e=0; e<numel(r); e++) {
+		tensor[e] = memory[address(r,e)+p*stride(r)];
+	}
+	return tensor;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the number of elements of register r.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBytecode::get_numel(int const& r) const {
+	return numel(r);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Creates a tensor of the shape of register r from the given contiguous elements.
+/////////////////////////////////////////////////////////////////////////////////////////
+pmTensor pmBytecode::make_tensor(int const& r, double const* values) const {
+	pmTensor tensor{registers[r].rows, registers[r].columns};
+	for(int e=0; e<numel(r); e++) {
+		tensor[e] = values[e];
+	}
+	return tensor;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Collects the current data of the fields and the values of the constants and variables
+/// in the order expected by the generated kernel.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmBytecode::bind(std::vector<double const*>& field, std::vector<double>& single) const {
+	field.clear();
+	single.clear();
+	for(auto const& it:program) {
+		if(it.opcode==LOAD_FIELD) {
+			field.push_back(it.field->get_data(it.level));
+		} else if(it.opcode==LOAD_SINGLE) {
+			pmTensor value = it.single->evaluate(0, it.level);
+			for(int e=0; e<numel(it.destination); e++) {
+				single.push_back(value[e]);
+			}
+		} else if(it.opcode==NEIGHBOR_SUM) {
+			pmNeighbor_sum const& sum = sums[it.sum];
+			for(int o=0; o<5; o++) {
+				if(sum.operand[o]==nullptr) { continue; }
+				if(sum.field[o]!=nullptr) {
+					field.push_back(sum.field[o]->get_data(it.level));
+				} else {
+					pmTensor value = sum.operand[o]->evaluate(0, it.level);
+					for(int e=0; e<sum.rows[o]*sum.columns[o]; e++) {
+						single.push_back(value[e]);
+					}
+				}
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Executes the compiled kernel of the program for the nodes [start,end) and writes the
+/// values of the result register and the condition of each node into the value and
+/// condition arrays of memory. The kernel is called for blocks of nodes. For each block
+/// the interactions are evaluated into contiguous arrays and the neighbours required by
+/// the neighbour sums are collected with their relative positions and mirroring guides.
+/// Returns false if an interaction does not match its compiled shape.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmBytecode::run(Kernel kernel, int const& start, int const& end, int const& result, pmRun_memory& memory) const {
+	int num_nodes = std::max(end-start, 0);
+	memory.value.resize((size_t)num_nodes*numel(result));
+	memory.condition.resize(num_nodes);
+	bind(memory.field, memory.single);
+	memory.function.clear();
+	pmParticle_system const* psys = nullptr;
+	for(auto const& it:sums) {
+		memory.function.push_back(it.smoothing_radius);
+		memory.function.push_back(it.coefficient);
+		memory.function.push_back(it.shape);
+		psys = it.psys;
+	}
+	int num_interactions = 0;
+	for(auto const& it:program) {
+		if(it.opcode==INTERACTION) {
+			num_interactions++;
+		}
+	}
+	memory.interaction_value.resize(num_interactions);
+	memory.interaction.resize(num_interactions);
+	int k = 0;
+	for(auto const& it:program) {
+		if(it.opcode!=INTERACTION) { continue; }
+		memory.interaction_value[k].resize((size_t)block_size*numel(it.destination));
+		memory.interaction[k] = memory.interaction_value[k].data();
+		k++;
+	}
+	int dimensions = psys!=nullptr ? psys->get_dimensions() : 0;
+	memory.neighbor_start.assign(block_size+1, 0);
+	pmTensor value;
+	for(int first=start; first<end; first+=block_size) {
+		int n = std::min(block_size, end-first);
+		k = 0;
+		for(auto const& it:program) {
+			if(it.opcode!=INTERACTION) { continue; }
+			int size = numel(it.destination);
+			for(int p=0; p<n; p++) {
+				if(!evaluate_interaction(it, first+p, value)) { return false; }
+				for(int e=0; e<size; e++) {
+					memory.interaction_value[k][(size_t)p*size+e] = value[e];
+				}
+			}
+			k++;
+		}
+		if(psys!=nullptr) {
+			memory.neighbor_index.clear();
+			memory.neighbor_rel_pos.clear();
+			memory.neighbor_guide.clear();
+			for(int p=0; p<n; p++) {
+				psys->for_each_neighbor(first+p, [&](int const& j, pmTensor const& rel_pos, pmTensor const& guide) {
+					memory.neighbor_index.push_back(j);
+					for(int c=0; c<dimensions; c++) {
+						memory.neighbor_rel_pos.push_back(rel_pos[c]);
+						memory.neighbor_guide.push_back(guide[c]);
+					}
+				});
+				memory.neighbor_start[p+1] = memory.neighbor_index.size();
+			}
+		}
+		kernel(first, first+n, memory.field.data(), memory.single.data(), memory.interaction.data(), memory.neighbor_start.data(), memory.neighbor_index.data(), memory.neighbor_rel_pos.data(), memory.neighbor_guide.data(), memory.function.data(), memory.value.data()+(size_t)(first-start)*numel(result), memory.condition.data()+(first-start));
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the exact C++ literal of the given value.
+/////////////////////////////////////////////////////////////////////////////////////////
+static std::string literal(double const& value) {
+	if(std::isnan(value)) { return "std::numeric_limits<double>::quiet_NaN()"; }
+	if(std::isinf(value)) { return value>0 ? "std::numeric_limits<double>::infinity()" : "-std::numeric_limits<double>::infinity()"; }
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%a", value);
+	return std::string{"("}+buffer+")";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the name of the variable holding the eth element of register r in the generated code.
+/////////////////////////////////////////////////////////////////////////////////////////
+std::string pmBytecode::register_name(int const& r, int const& e) const {
+	return "r"+std::to_string(r)+"_"+std::to_string(e);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the C++ expression of the eth element of the destination of the given
+/// instruction. Loads are handled by generate_code.
+/////////////////////////////////////////////////////////////////////////////////////////
+std::string pmBytecode::generate_instruction(pmInstruction const& ins, int const& e) const {
+	int d = ins.destination;
+	auto src = [&](int const& k, int const& element) {
+		return register_name(ins.source[k], element);
+	};
+	std::string a = ins.source[0]>=0 ? src(0,e) : "";
+	std::string b = ins.source[1]>=0 ? src(1,e) : "";
+	auto call = [&](std::string const& function) {
+		return function+"("+a+")";
+	};
+	switch(ins.opcode) {
+		case LOAD_CONSTANT : return literal(ins.constant[e]);
+		case NEGATE : return "-"+a;
+		case ADD : return a+"+"+b;
+		case SUBTRACT : return a+"-"+b;
+		case SCALE : return a+"*"+src(1,0);
+		case DIVIDE : return a+"/"+src(1,0);
+		case TERM_MULTIPLY : return a+"*"+b;
+		case TERM_DIVIDE : return a+"/"+b;
+		case POWER : return "std::pow("+a+","+b+")";
+		case MATMUL : {
+			int jmax = registers[d].columns;
+			int inner = registers[ins.source[0]].columns;
+			int i = e/jmax;
+			int j = e%jmax;
+			std::string sum = "0.0";
+			for(int k=0; k<inner; k++) {
+				sum += "+"+src(0,i*inner+k)+"*"+src(1,k*jmax+j);
+			}
+			return sum;
+		}
+		case TRANSPOSE : {
+			int rows = registers[ins.source[0]].rows;
+			int columns = registers[ins.source[0]].columns;
+			return src(0,(e%rows)*columns+e/rows);
+		}
+		case MAGNITUDE : {
+			if(numel(ins.source[0])==1) { return "std::abs("+src(0,0)+")"; }
+			std::string sum = src(0,0)+"*"+src(0,0);
+			for(int k=1; k<numel(ins.source[0]); k++) {
+				sum += "+"+src(0,k)+"*"+src(0,k);
+			}
+			return "std::sqrt("+sum+")";
+		}
+		case ABS : return call("std::abs");
+		case ACOS : return call("std::acos");
+		case ACOT : return "std::acos("+a+")/std::asin("+a+")";
+		case ASIN : return call("std::asin");
+		case ATAN : return call("std::atan");
+		case COS : return call("std::cos");
+		case COSH : return call("std::cosh");
+		case COT : return "std::cos("+a+")/std::sin("+a+")";
+		case COTH : return "1/std::tanh("+a+")";
+		case EXP : return call("std::exp");
+		case FLOOR : return "std::floor("+a+"+"+literal(NAUTICLE_EPS)+")";
+		case LOG : return call("std::log");
+		case SGN : return "(double)((0.0<"+a+")-("+a+"<0.0))";
+		case SIN : return call("std::sin");
+		case SINH : return call("std::sinh");
+		case SQRT : return call("std::sqrt");
+		case TAN : return call("std::tan");
+		case TANH : return call("std::tanh");
+		case TRUNC : return "std::trunc("+a+"+"+literal(NAUTICLE_EPS)+")";
+		case MIN : return "std::min("+a+","+b+")";
+		case MAX : return "std::max("+a+","+b+")";
+		case MOD : return a+"-std::floor("+a+"/"+b+")*"+b;
+		case GT : return "(double)("+src(0,0)+">"+src(1,0)+")";
+		case GTE : return "(double)("+src(0,0)+">="+src(1,0)+")";
+		case LT : return "(double)("+src(0,0)+"<"+src(1,0)+")";
+		case LTE : return "(double)("+src(0,0)+"<="+src(1,0)+")";
+		case EQUAL : return "(double)("+src(0,0)+"=="+src(1,0)+")";
+		case NOTEQUAL : return "(double)!("+src(0,0)+"=="+src(1,0)+")";
+		case AND : return "(double)("+src(0,0)+"&&"+src(1,0)+")";
+		case OR : return "(double)("+src(0,0)+"||"+src(1,0)+")";
+		case XOR : return "(double)("+src(0,0)+"!="+src(1,0)+")";
+		case NOT : return "(double)!(bool)"+src(0,0);
+		case IF : return "(bool)"+src(0,0)+" ? "+src(1,e)+" : "+src(2,e);
+		case LIMIT : return src(0,0)+"<"+src(1,0)+" ? "+src(1,0)+" : ("+src(0,0)+">"+src(2,0)+" ? "+src(2,0)+" : "+src(0,0)+")";
+		default : return "0.0";
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the C++ expression of the eth element of the oth operand of a neighbour sum at
+/// the given node.
+/////////////////////////////////////////////////////////////////////////////////////////
+std::string pmBytecode::operand_value(pmInstruction const& ins, int const& o, std::string const& node, int const& e) const {
+	pmNeighbor_sum const& sum = sums[ins.sum];
+	std::string name = "n"+std::to_string(ins.sum)+"_"+std::to_string(o);
+	if(sum.field[o]!=nullptr) {
+		return name+"[(size_t)"+node+"*"+std::to_string(sum.rows[o]*sum.columns[o])+"+"+std::to_string(e)+"]";
+	}
+	return name+"_"+std::to_string(e);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Writes the neighbour sum of an SPH operator. The operand arrays and values are declared
+/// in os, the loop over the neighbours of node i is written into node. The sum reproduces
+/// pmSph_operator::contribute for the given operator type and template parameters, the
+/// operations are performed in the same order as in the pmTensor operators.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmBytecode::generate_neighbor_sum(std::ostream& os, std::ostream& node, pmInstruction const& ins, int& field_index, size_t& single_index) const {
+	pmNeighbor_sum const& sum = sums[ins.sum];
+	int d = ins.destination;
+	int q = ins.sum;
+	int dimensions = sum.psys->get_dimensions();
+	int n = sum.rows[1]*sum.columns[1];
+	int columns = sum.columns[1];
+	std::string D = std::to_string(dimensions);
+	auto at = [](std::string const& name, int const& e) {
+		return name+std::to_string(e);
+	};
+	auto r = [&](int const& k) {
+		return "r["+std::to_string(k)+"]";
+	};
+	for(int o=0; o<5; o++) {
+		if(sum.operand[o]==nullptr) { continue; }
+		std::string name = "n"+std::to_string(q)+"_"+std::to_string(o);
+		if(sum.field[o]!=nullptr) {
+			os << "\tdouble const* " << name << " = field[" << field_index++ << "];\n";
+		} else {
+			for(int e=0; e<sum.rows[o]*sum.columns[o]; e++) {
+				os << "\tdouble const " << name << "_" << e << " = single[" << single_index++ << "];\n";
+			}
+		}
+	}
+	for(int e=0; e<numel(d); e++) {
+		node << "\t\tdouble " << register_name(d,e) << " = 0.0;\n";
+	}
+	node << "\t\t{\n";
+	node << "\t\t\tdouble const hi = " << operand_value(ins,4,"i",0) << ";\n";
+	for(int e=0; e<n; e++) {
+		node << "\t\t\tdouble const " << at("ai",e) << " = " << operand_value(ins,1,"i",e) << ";\n";
+	}
+	if(sum.num_operands==6) {
+		node << "\t\t\tdouble const bi = " << operand_value(ins,0,"i",0) << ";\n";
+	}
+	node << "\t\t\tdouble const rhoi = " << operand_value(ins,3,"i",0) << ";\n";
+	node << "\t\t\tdouble h_last = -1.0;\n";
+	node << "\t\t\tdouble h_inv = 0.0;\n";
+	node << "\t\t\tdouble coefficient = 0.0;\n";
+	node << "\t\t\tfor(int n=neighbor_start[i-first]; n<neighbor_start[i-first+1]; n++) {\n";
+	std::string indent = "\t\t\t\t";
+	node << indent << "int const j = neighbor_index[n];\n";
+	node << indent << "double const* r = neighbor_rel_pos+(size_t)n*" << D << ";\n";
+	node << indent << "double const* g = neighbor_guide+(size_t)n*" << D << ";\n";
+	if(dimensions==1) {
+		node << indent << "double const d = std::abs(r[0]);\n";
+	} else {
+		node << indent << "double const d = std::sqrt(r[0]*r[0]";
+		for(int k=1; k<dimensions; k++) {
+			node << "+" << r(k) << "*" << r(k);
+		}
+		node << ");\n";
+	}
+	if(sum.type!=SAMPLE) {
+		node << indent << "if(d<=" << literal(NAUTICLE_EPS) << ") { continue; }\n";
+	}
+	node << indent << "double const hij = (hi+" << operand_value(ins,4,"j",0) << ")/2.0;\n";
+	node << indent << "if(d>=hij) { continue; }\n";
+	if(sum.num_operands==6) {
+		node << indent << "double const bij = (bi+" << operand_value(ins,0,"j",0) << ")/2.0;\n";
+	}
+	// the neighbour value reflected in the mirrored directions
+	for(int e=0; e<n; e++) {
+		node << indent << "double " << at("aj",e) << " = ";
+		if(sum.position) {
+			node << r(e) << "+" << at("ai",e) << ";\n";
+		} else if(n==1) {
+			node << operand_value(ins,1,"j",0) << ";\n";
+		} else if(dimensions==1) {
+			node << operand_value(ins,1,"j",e) << "*(g[0]!=0 ? -1.0 : 1.0);\n";
+		} else {
+			node << "0.0+(g[" << e/columns << "]!=0 ? -1.0 : 1.0)*" << operand_value(ins,1,"j",e) << ";\n";
+		}
+	}
+	if(!sum.symmetric) {
+		node << indent << "int flip = 1;\n";
+		node << indent << "for(int k=0; k<" << D << "; k++) { if(g[k]!=0) { flip *= -1; } }\n";
+		for(int e=0; e<n; e++) {
+			node << indent << at("aj",e) << " = " << (n==1 ? "0.0+" : "") << at("aj",e) << "*(double)flip;\n";
+		}
+	}
+	node << indent << "double const mj = " << operand_value(ins,2,"j",0) << ";\n";
+	node << indent << "double const rhoj = " << operand_value(ins,3,"j",0) << ";\n";
+	node << indent << "if(hij!=h_last) {\n";
+	node << indent << "\tdouble const h = function[" << 3*q << "](hij);\n";
+	node << indent << "\th_last = hij;\n";
+	node << indent << "\th_inv = 1.0/h;\n";
+	node << indent << "\tcoefficient = function[" << 3*q+1 << "](h);\n";
+	node << indent << "}\n";
+	node << indent << "double const W = coefficient*function[" << 3*q+2 << "](d*h_inv);\n";
+	auto x = [&](int const& e) {
+		std::string ai = at("ai",e);
+		std::string aj = at("aj",e);
+		if(sum.variant==1 && sum.k==1) { return "("+ai+"/(rhoi*rhoi)+"+aj+"/(rhoj*rhoj))"; }
+		if(sum.variant==1) { return "("+aj+"+"+ai+")"; }
+		if(sum.variant==2) { return aj; }
+		return "("+aj+"-"+ai+")";
+	};
+	auto add = [&](int const& e, std::string const& value) {
+		node << indent << register_name(d,e) << " += " << value << ";\n";
+	};
+	switch(sum.type) {
+		case SAMPLE : {
+			node << indent << "double const s = mj/rhoj*W;\n";
+			for(int e=0; e<n; e++) {
+				add(e, at("aj",e)+"*s");
+			}
+			break;
+		}
+		case XSAMPLE : {
+			node << indent << "double const s = mj/rhoj*W;\n";
+			for(int e=0; e<n; e++) {
+				add(e, "("+at("aj",e)+"-"+at("ai",e)+")*s");
+			}
+			break;
+		}
+		case INERTIA : {
+			node << indent << "double const s = mj/rhoj*W;\n";
+			for(int a=0; a<n; a++) {
+				for(int b=0; b<n; b++) {
+					add(a*n+b, "(0.0+"+x(a)+"*"+x(b)+")*s");
+				}
+			}
+			break;
+		}
+		case GRADIENT :
+		case DIVERGENCE : {
+			if(sum.k==0) {
+				node << indent << "double const s = mj/rhoj*W/d;\n";
+			} else if(sum.variant==0) {
+				node << indent << "double const s = mj/rhoi*W/d;\n";
+			} else {
+				node << indent << "double const s = mj*rhoi*W/d;\n";
+			}
+			if(sum.type==DIVERGENCE) {
+				std::string product = "0.0";
+				for(int k=0; k<dimensions; k++) {
+					product += "+(-"+x(k)+")*"+r(k);
+				}
+				add(0, "("+product+")*s");
+				break;
+			}
+			for(int a=0; a<n; a++) {
+				for(int k=0; k<dimensions; k++) {
+					std::string product;
+					if(n==1 && dimensions>1) {
+						product = r(k)+"*"+x(0);
+					} else if(n>1 && dimensions==1) {
+						product = x(a)+"*"+r(0);
+					} else {
+						product = "0.0+"+x(a)+"*"+r(k);
+					}
+					add(a*dimensions+k, "(-("+product+"))*s");
+				}
+			}
+			break;
+		}
+		case LAPLACE : {
+			node << indent << "double const ee = 0.0";
+			for(int k=0; k<dimensions; k++) {
+				node << "+((-" << r(k) << ")/d)*((-" << r(k) << ")/d)";
+			}
+			node << ";\n";
+			if(sum.variant==0 && sum.num_operands==5) {
+				node << indent << "double const s = 2.0*mj/rhoj/d*W;\n";
+			} else {
+				node << indent << "double const s = 2.0*mj/rhoj*W/d;\n";
+			}
+			for(int e=0; e<n; e++) {
+				std::string y = sum.variant==2 ? at("aj",e) : "("+at("ai",e)+"-"+at("aj",e)+")";
+				std::string value = n==1 ? "(0.0+ee*"+y+")*s" : y+"*ee*s";
+				if(sum.num_operands==6) {
+					value = n==1 ? "0.0+bij*("+value+")" : "("+value+")*bij";
+				}
+				add(e, value);
+			}
+			break;
+		}
+		case AVISC : {
+			node << indent << "double const xr = 0.0";
+			for(int k=0; k<dimensions; k++) {
+				node << "+" << x(k) << "*" << r(k);
+			}
+			node << ";\n";
+			node << indent << "double const s = xr*mj/rhoj/d/d/d*W;\n";
+			for(int k=0; k<dimensions; k++) {
+				std::string product = dimensions==1 ? "0.0+(-r[0])*s" : "(-"+r(k)+")*s";
+				add(k, "xr<0 ? "+product+" : "+r(k)+"*0.0");
+			}
+			break;
+		}
+		default : break;
+	}
+	node << "\t\t\t}\n";
+	node << "\t\t}\n";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Writes the program as a C++ function with the given name. Uniform registers are computed
+/// before the loop over the nodes, fields are accessed directly in their raw arrays.
+/// Interactions are read from the arrays evaluated for the block, neighbour sums are
+/// generated by generate_neighbor_sum.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmBytecode::generate_code(std::ostream& os, std::string const& function_name, int const& result, int const& condition) const {
+	std::ostringstream node;
+	int field_index = 0;
+	size_t single_index = 0;
+	int interaction_index = 0;
+	os << "extern \"C\" void " << function_name << "(int first, int end, double const* const* field, double const* single, double const* const* interaction, int const* neighbor_start, int const* neighbor_index, double const* neighbor_rel_pos, double const* neighbor_guide, double (* const* function)(double const&), double* result, double* condition) {\n";
+	for(auto const& it:program) {
+		int d = it.destination;
+		std::ostream& out = registers[d].uniform ? os : node;
+		std::string indent = registers[d].uniform ? "\t" : "\t\t";
+		if(it.opcode==LOAD_FIELD) {
+			out << indent << "double const* f" << field_index << " = field[" << field_index << "]+(size_t)i*" << numel(d) << ";\n";
+			for(int e=0; e<numel(d); e++) {
+				out << indent << "double const " << register_name(d,e) << " = f" << field_index << "[" << e << "];\n";
+			}
+			field_index++;
+		} else if(it.opcode==LOAD_SINGLE) {
+			for(int e=0; e<numel(d); e++) {
+				out << indent << "double const " << register_name(d,e) << " = single[" << single_index++ << "];\n";
+			}
+		} else if(it.opcode==INTERACTION) {
+			for(int e=0; e<numel(d); e++) {
+				out << indent << "double const " << register_name(d,e) << " = interaction[" << interaction_index << "][(size_t)(i-first)*" << numel(d) << "+" << e << "];\n";
+			}
+			interaction_index++;
+		} else if(it.opcode==NEIGHBOR_SUM) {
+			generate_neighbor_sum(os, node, it, field_index, single_index);
+		} else {
+			for(int e=0; e<numel(d); e++) {
+				out << indent << "double const " << register_name(d,e) << " = " << generate_instruction(it,e) << ";\n";
+			}
+		}
+	}
+	os << "\tfor(int i=first; i<end; i++) {\n";
+	os << node.str();
+	os << "\t\tcondition[i-first] = " << register_name(condition,0) << ";\n";
+	for(int e=0; e<numel(result); e++) {
+		os << "\t\tresult[(size_t)(i-first)*" << numel(result) << "+" << e << "] = " << register_name(result,e) << ";\n";
+	}
+	os << "\t}\n}\n\n";
+}
@@ -51,6 +51,21 @@ bool pmExpression::is_interaction() const {
     return false;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns true if the expression contains the symbol with the given name.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmExpression::is_referencing(std::string const& symbol_name) const {
+    return name!="" && name==symbol_name;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns true if the evaluation of the ith node reads the symbol with the given name
+/// at other nodes.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmExpression::is_reading_neighbors(std::string const& symbol_name) const {
+    return false;
+}
+
 size_t pmExpression::get_storage_depth() const {
     return 1;
 }
\ No newline at end of file
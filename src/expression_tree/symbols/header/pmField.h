@@ -30,17 +30,28 @@ namespace Nauticle {
 	//  cloud. No assignment to any particle system is required but sorting is always performed when
 	//  the particle system sorting in the same workspace is triggered. The field optionally stores
 	//  a copy of the field data in the previous step. Current and previous data is managed automatically
-	//  when the two_step option is on.
+	//  when the two_step option is on. The shape of the nodes is fixed at declaration and the data
+	//  of each level is stored as a contiguous array of doubles holding the components of the nodes
+	//  one after the other. The tensor interface (evaluate, set_value) is a view of this storage.
+	//  The levels form a ring of arrays: writes go to the current level only and advance_levels
+	//  turns the ring at the step boundaries, hence former values are not copied node by node.
 	*/
 	class pmField : public pmSymbol {
 	private:
 		bool printable = true;
 	protected:
-		std::vector<std::vector<pmTensor>> value;
+		int rows = 0;
+		int columns = 0;
+		size_t number_of_nodes = 0;
+		size_t head = 0;
+		std::vector<std::vector<double>> value;
 		std::vector<bool> locked;
 		bool symmetric = true;
 	protected:
 		virtual std::shared_ptr<pmExpression> clone_impl() const override;
+		void assign(std::vector<pmTensor> const& v);
+		void store(double* destination, pmTensor const& v);
+		size_t slot(size_t const& level) const;
 	public:
 		pmField()=delete;
 		pmField(std::string const& n, int const& size, pmTensor const& value=pmTensor{0}, bool const& sym=true, bool const& pr=true, std::string const& fname="");
@@ -54,12 +65,20 @@ namespace Nauticle {
 		virtual ~pmField() override {}
 		void printv() const override;
 		pmTensor evaluate(int const& i, size_t const& level=0) const override;
+		int get_numrows() const;
+		int get_numcols() const;
+		int get_number_of_components() const;
+		double const* get_data(size_t const& level=0) const;
+		double* get_data(size_t const& level=0);
+		double get_scalar(int const& i, size_t const& level=0) const;
+		int compile(pmBytecode& code, size_t const& level=0) const override;
 		virtual void set_value(pmTensor const& value, int const& i=0, bool const& forced=false) override;
-		pmTensor const& get_value(int const& i) const override;
+		pmTensor get_value(int const& i) const override;
 		int get_field_size() const override;
 		std::string get_type() const override;
 		void set_storage_depth(size_t const& d) override;
 		virtual size_t get_storage_depth() const override;
+		void advance_levels();
 		void push_back(pmTensor const& obj);
 		bool is_double_steps() const;
 		std::shared_ptr<pmField> clone() const;
@@ -71,6 +90,8 @@ namespace Nauticle {
 		virtual void delete_set(std::vector<size_t> const& indices) override;
 		virtual void add_member(pmTensor const& v=pmTensor{});
 		virtual void duplicate_member(size_t const& i);
+		virtual void append_members(std::vector<size_t> const& parents, size_t const& num_threads=1);
+		virtual void reorder(std::vector<int> const& order) override;
 		void set_printable(bool const& p);
 		bool is_printable() const;
 		void set_lock(size_t const& idx, bool const& lck=true) override;
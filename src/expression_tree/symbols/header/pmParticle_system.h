@@ -34,17 +34,40 @@ namespace Nauticle {
 	//  Neighbour search and cloud/grid generation is integrated inside.
 	*/
 	class pmParticle_system final : public pmField, public pmDomain {
-		std::vector<int> pidx;
+		std::vector<int> sorted_idx;
+		std::vector<int> particle_cell;
 		std::shared_ptr<pmField> periodic_jump;
 		bool up_to_date=false;
+		size_t sort_interval=0;
+		size_t sort_counter=0;
+		double skin=0;
+		bool verlet_valid=false;
+		std::vector<pmTensor> verlet_iterator;
+		std::vector<double> verlet_position;
+		std::vector<int> verlet_start;
+		std::vector<int> verlet_idx;
+		std::vector<int> verlet_image;
+		bool half_stencil=false;
+		size_t pair_cache_budget=0;
+		bool pair_cache_valid=false;
+		bool pair_cache_exceeded=false;
+		std::vector<int> pair_start;
+		std::vector<int> pair_idx;
+		std::vector<int> pair_image;
+		std::vector<double> pair_rel_pos;
 	protected:
 		virtual std::shared_ptr<pmExpression> clone_impl() const override;
+		bool build_dense_cells(size_t const& num_threads);
+		bool build_sparse_cells(size_t const& num_threads);
+		void build_verlet_list();
+		bool verlet_list_expired() const;
+		template <typename F> void traverse_neighbors(int const& i, F const& func) const;
 	public:
 		pmParticle_system(std::vector<pmTensor> const& value, pmDomain const& dm);
 		bool operator==(pmParticle_system const& rhs) const;
 		bool operator!=(pmParticle_system const& rhs) const;
 		virtual ~pmParticle_system() {}
-		std::vector<int> const& get_cell_content(pmTensor const& grid_crd, int& index) const;
+		std::vector<int> const& get_cell_content(pmTensor const& grid_crd, int& begin, int& end) const;
 		void set_expired();
 		virtual void set_value(pmTensor const& value, int const& i=0, bool const& forced=false) override;
 		void print() const override;
@@ -56,13 +79,213 @@ namespace Nauticle {
 		virtual void delete_set(std::vector<size_t> const& indices) override;
 		virtual void add_member(pmTensor const& v=pmTensor{}) override;
 		virtual void duplicate_member(size_t const& i) override;
+		virtual void append_members(std::vector<size_t> const& parents, size_t const& num_threads=1) override;
+		virtual void reorder(std::vector<int> const& order) override;
 		void restrict_particles(std::vector<size_t>& del);
 		bool is_up_to_date() const;
-		bool update_neighbor_list();
+		bool update_neighbor_list(size_t const& num_threads=1);
 		std::shared_ptr<pmField> get_periodic_jump() const;
 		pmTensor get_periodic_shift(size_t const& i) const;
+		void set_sort_interval(size_t const& si);
+		size_t get_sort_interval() const;
+		bool is_sorting_due();
+		std::vector<int> get_spatial_order() const;
+		void set_skin(double const& sk);
+		double get_skin() const;
+		bool has_verlet_list() const;
+		void cell_range(int64_t const& key, int& begin, int& end) const;
+		void set_half_stencil(bool const& hs);
+		bool is_half_stencil() const;
+		void set_pair_cache_budget(size_t const& mb);
+		size_t get_pair_cache_budget() const;
+		bool build_pair_cache(size_t const& num_threads=1);
+		bool has_pair_cache() const;
+		template <typename F> void for_each_neighbor(int const& i, F const& func) const;
+		template <typename F> void for_each_half_neighbor(int const& i, F const& func) const;
 	};
 
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Calls func(j, rel_pos, image) for all the neighbours of the ith particle, where rel_pos
+	/// is the relative position of the (mirrored or shifted) neighbour and image is the code
+	/// of its image. Uses the Verlet list if it is turned on, otherwise the cell structure
+	/// is traversed by the precomputed integer stencil.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <typename F>
+	void pmParticle_system::traverse_neighbors(int const& i, F const& func) const {
+		pmTensor const pos_i = this->evaluate(i);
+		int dimensions = this->get_dimensions();
+		if(this->has_verlet_list()) {
+			for(int n=verlet_start[i]; n<verlet_start[i+1]; n++) {
+				int j = verlet_idx[n];
+				pmTensor pos_j = this->evaluate(j);
+				int image = verlet_image[n];
+				for(int k=dimensions-1; k>=0; k--) {
+					if(boundary[k]==0) {
+						double length = image_shift[k][0];
+						pos_j[k] -= std::round((pos_j[k]-pos_i[k])/length)*length;
+					} else {
+						pos_j[k] = image_scale[k][image%3]*pos_j[k] + image_shift[k][image%3];
+					}
+					image /= 3;
+				}
+				func(j, pos_j-pos_i, verlet_image[n]);
+			}
+			return;
+		}
+		int grid_i[3];
+		for(int k=0; k<dimensions; k++) {
+			grid_i[k] = this->grid_index(pos_i[k], k);
+		}
+		int num_stencil = cell_iterator.size();
+		for(int s=0; s<num_stencil; s++) {
+			int64_t key = 0;
+			int image = 0;
+			int image_k[3];
+			bool cutoff = false;
+			for(int k=0; k<dimensions; k++) {
+				int idx = 3*grid_i[k]+stencil_offset[s*dimensions+k]+1;
+				int g_j = neighbor_index[k][idx];
+				if(g_j<0) {
+					cutoff = true;
+					break;
+				}
+				key += g_j*cell_stride[k];
+				image_k[k] = neighbor_image[k][idx];
+				image = image*3 + image_k[k];
+			}
+			if(cutoff) {
+				continue;
+			}
+			int begin = 0;
+			int end = 0;
+			this->cell_range(key, begin, end);
+			for(int c=begin; c<end; c++) {
+				int j = sorted_idx[c];
+				pmTensor pos_j = this->evaluate(j);
+				for(int k=0; k<dimensions; k++) {
+					pos_j[k] = image_scale[k][image_k[k]]*pos_j[k] + image_shift[k][image_k[k]];
+				}
+				func(j, pos_j-pos_i, image);
+			}
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Calls func(j, rel_pos, guide) for all the neighbours of the ith particle, where rel_pos
+	/// is the relative position of the (mirrored or shifted) neighbour and guide is the
+	/// mirroring guide. The pair cache is used if it is built for the current positions.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <typename F>
+	void pmParticle_system::for_each_neighbor(int const& i, F const& func) const {
+		if(this->has_pair_cache()) {
+			int dimensions = this->get_dimensions();
+			pmTensor rel_pos{dimensions,1,0.0};
+			for(int n=pair_start[i]; n<pair_start[i+1]; n++) {
+				for(int k=0; k<dimensions; k++) {
+					rel_pos[k] = pair_rel_pos[n*dimensions+k];
+				}
+				func(pair_idx[n], rel_pos, image_guide[pair_image[n]]);
+			}
+			return;
+		}
+		this->traverse_neighbors(i, [&](int const& j, pmTensor const& rel_pos, int const& image) {
+			func(j, rel_pos, image_guide[image]);
+		});
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Calls func(j, rel_pos, guide, mutual) for the half of the neighbours of the ith
+	/// particle such that every unordered pair of particles is visited only once. Mutual
+	/// is true if the contribution of the pair must be applied to both particles. Pairs
+	/// with mirrored images are not reciprocal, hence they are visited from both sides
+	/// with mutual set to false. The cell structure is traversed by the forward half of the
+	/// stencil, while the pair cache and the Verlet list are filtered by the particle indices.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <typename F>
+	void pmParticle_system::for_each_half_neighbor(int const& i, F const& func) const {
+		pmTensor const pos_i = this->evaluate(i);
+		int dimensions = this->get_dimensions();
+		if(this->has_pair_cache()) {
+			pmTensor rel_pos{dimensions,1,0.0};
+			for(int n=pair_start[i]; n<pair_start[i+1]; n++) {
+				int j = pair_idx[n];
+				bool mirrored = image_mirrored[pair_image[n]];
+				if(j<i && !mirrored) {
+					continue;
+				}
+				for(int k=0; k<dimensions; k++) {
+					rel_pos[k] = pair_rel_pos[n*dimensions+k];
+				}
+				func(j, rel_pos, image_guide[pair_image[n]], j!=i && !mirrored);
+			}
+			return;
+		}
+		if(this->has_verlet_list()) {
+			for(int n=verlet_start[i]; n<verlet_start[i+1]; n++) {
+				int j = verlet_idx[n];
+				bool mirrored = image_mirrored[verlet_image[n]];
+				if(j<i && !mirrored) {
+					continue;
+				}
+				pmTensor pos_j = this->evaluate(j);
+				int image = verlet_image[n];
+				for(int k=dimensions-1; k>=0; k--) {
+					if(boundary[k]==0) {
+						double length = image_shift[k][0];
+						pos_j[k] -= std::round((pos_j[k]-pos_i[k])/length)*length;
+					} else {
+						pos_j[k] = image_scale[k][image%3]*pos_j[k] + image_shift[k][image%3];
+					}
+					image /= 3;
+				}
+				func(j, pos_j-pos_i, image_guide[verlet_image[n]], j!=i && !mirrored);
+			}
+			return;
+		}
+		int grid_i[3];
+		for(int k=0; k<dimensions; k++) {
+			grid_i[k] = this->grid_index(pos_i[k], k);
+		}
+		int num_stencil = cell_iterator.size();
+		int center = (num_stencil-1)/2;
+		for(int s=0; s<num_stencil; s++) {
+			int64_t key = 0;
+			int image = 0;
+			int image_k[3];
+			bool cutoff = false;
+			for(int k=0; k<dimensions; k++) {
+				int idx = 3*grid_i[k]+stencil_offset[s*dimensions+k]+1;
+				int g_j = neighbor_index[k][idx];
+				if(g_j<0) {
+					cutoff = true;
+					break;
+				}
+				key += g_j*cell_stride[k];
+				image_k[k] = neighbor_image[k][idx];
+				image = image*3 + image_k[k];
+			}
+			bool mirrored = !cutoff && image_mirrored[image];
+			if(cutoff || (s<center && !mirrored)) {
+				continue;
+			}
+			int begin = 0;
+			int end = 0;
+			this->cell_range(key, begin, end);
+			pmTensor const& guide = image_guide[image];
+			for(int c=begin; c<end; c++) {
+				int j = sorted_idx[c];
+				if(s==center && j<i) {
+					continue;
+				}
+				pmTensor pos_j = this->evaluate(j);
+				for(int k=0; k<dimensions; k++) {
+					pos_j[k] = image_scale[k][image_k[k]]*pos_j[k] + image_shift[k][image_k[k]];
+				}
+				func(j, pos_j-pos_i, guide, !mirrored && (s!=center || j!=i));
+			}
+		}
+	}
+
 	/////////////////////////////////////////////////////////////////////////////////////////
 	/// Implementation of << operator.
 	/////////////////////////////////////////////////////////////////////////////////////////
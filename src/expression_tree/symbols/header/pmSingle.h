@@ -33,8 +33,9 @@ namespace Nauticle {
     	pmHistory<pmTensor> value;
     public:
     	virtual ~pmSingle() override {}
-    	pmTensor const& get_value(int const& i=0) const override;
+    	pmTensor get_value(int const& i=0) const override;
     	virtual pmTensor evaluate(int const&, size_t const& level=0) const override;
+    	int compile(pmBytecode& code, size_t const& level=0) const override;
     	void printv() const override;
     	std::shared_ptr<pmSingle> clone() const;
     	std::string get_type() const override;
@@ -32,7 +32,7 @@ namespace Nauticle {
 	public:
 		virtual ~pmSymbol() {}
 		virtual std::string const& get_name() const override;
-		virtual pmTensor const& get_value(int const& i=0) const=0;
+		virtual pmTensor get_value(int const& i=0) const=0;
 		virtual void print() const override;
 		virtual void printv() const=0;
 		virtual void set_storage_depth(size_t const& d) override {}
@@ -19,7 +19,9 @@
 */
 
 #include "pmField.h"
-#include "commonutils/Common.h"
+#include "pmBytecode.h"
+#include <algorithm>
+#include "pmParallel.h"
 #include "pmData_reader.h"
 #include <vtkSmartPointer.h>
 #include <vtkSimplePointsReader.h>
@@ -43,10 +45,16 @@ pmField::pmField(std::string const& n, int const& size, pmTensor const& v/*=pmTe
 		pmData_reader data_reader;
 		data_reader.set_file_name(fname);
 		data_reader.read_file(v.numel());
-		value.push_back(data_reader.get_data());
+		assign(data_reader.get_data());
 	} else {
-		value.push_back(std::vector<pmTensor>());
-		value[0].resize(size, v);
+		rows = v.get_numrows();
+		columns = v.get_numcols();
+		number_of_nodes = size;
+		value.push_back(std::vector<double>());
+		value[0].resize(number_of_nodes*get_number_of_components());
+		for(size_t i=0; i<number_of_nodes; i++) {
+			store(value[0].data()+i*get_number_of_components(), v);
+		}
 	}
 	locked.resize(this->get_field_size(),false);
 }
@@ -59,8 +67,7 @@ pmField::pmField(std::string const& n, std::vector<pmTensor> const& v, bool cons
 		ProLog::pLogger::error_msgf("Field name %s is limited to 20 characters.",n.c_str());
 	}
 	name = n;
-	value.push_back(std::vector<pmTensor>());
-	value[0] = v;
+	assign(v);
 	symmetric = sym;
 	printable = pr;
 	locked.resize(this->get_field_size());
@@ -71,6 +78,10 @@ pmField::pmField(std::string const& n, std::vector<pmTensor> const& v, bool cons
 /////////////////////////////////////////////////////////////////////////////////////////
 pmField::pmField(pmField const& other) {
 	this->name = other.name;
+	this->rows = other.rows;
+	this->columns = other.columns;
+	this->number_of_nodes = other.number_of_nodes;
+	this->head = other.head;
 	this->value = other.value;
 	this->symmetric = other.symmetric;
 	this->printable = other.printable;
@@ -82,6 +93,10 @@ pmField::pmField(pmField const& other) {
 /////////////////////////////////////////////////////////////////////////////////////////
 pmField::pmField(pmField&& other) {
 	this->name = std::move(other.name);
+	this->rows = std::move(other.rows);
+	this->columns = std::move(other.columns);
+	this->number_of_nodes = std::move(other.number_of_nodes);
+	this->head = std::move(other.head);
 	this->value = std::move(other.value);
 	this->symmetric = std::move(other.symmetric);
 	this->printable = std::move(other.printable);
@@ -94,6 +109,10 @@ pmField::pmField(pmField&& other) {
 pmField& pmField::operator=(pmField const& other) {
 	if(this!=&other) {
 		this->name = other.name;
+		this->rows = other.rows;
+		this->columns = other.columns;
+		this->number_of_nodes = other.number_of_nodes;
+		this->head = other.head;
 		this->value = other.value;
 		this->symmetric = other.symmetric;
 		this->printable = other.printable;
@@ -108,6 +127,10 @@ pmField& pmField::operator=(pmField const& other) {
 pmField& pmField::operator=(pmField&& other) {
 	if(this!=&other) {
 		this->name = std::move(other.name);
+		this->rows = std::move(other.rows);
+		this->columns = std::move(other.columns);
+		this->number_of_nodes = std::move(other.number_of_nodes);
+		this->head = std::move(other.head);
 		this->value = std::move(other.value);
 		this->symmetric = std::move(other.symmetric);
 		this->printable = std::move(other.printable);
@@ -120,7 +143,7 @@ pmField& pmField::operator=(pmField&& other) {
 /// Implement identity check.
 /////////////////////////////////////////////////////////////////////////////////////////
 bool pmField::operator==(pmField const& rhs) const {
-	if(this->name != rhs.name || this->value != rhs.value || this->symmetric != rhs.symmetric || this->value.size()!=rhs.value.size() || this->printable!=rhs.printable) {
+	if(this->name != rhs.name || this->rows != rhs.rows || this->columns != rhs.columns || this->head != rhs.head || this->value != rhs.value || this->symmetric != rhs.symmetric || this->value.size()!=rhs.value.size() || this->printable!=rhs.printable) {
 		return false;
 	} else {
 		return true;
@@ -134,6 +157,36 @@ bool pmField::operator!=(pmField const& rhs) const {
 	return !this->operator==(rhs);
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Replaces the content of the field by the given tensors. The shape of the field is
+/// taken from the first tensor.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmField::assign(std::vector<pmTensor> const& v) {
+	rows = v.empty() ? 0 : v[0].get_numrows();
+	columns = v.empty() ? 0 : v[0].get_numcols();
+	number_of_nodes = v.size();
+	head = 0;
+	value.clear();
+	value.push_back(std::vector<double>(number_of_nodes*get_number_of_components()));
+	for(size_t i=0; i<number_of_nodes; i++) {
+		store(value[0].data()+i*get_number_of_components(), v[i]);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Copies the components of the given tensor to the destination. The tensor must have
+/// the shape of the field.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmField::store(double* destination, pmTensor const& v) {
+	int n = get_number_of_components();
+	if(v.numel()!=n) {
+		ProLog::pLogger::error_msgf("A tensor of size %i by %i cannot be stored in field \"%s\" of size %i by %i.\n", v.get_numrows(), v.get_numcols(), name.c_str(), rows, columns);
+	}
+	for(int e=0; e<n; e++) {
+		destination[e] = v[e];
+	}
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Prints the whole content of the field.
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -142,8 +195,7 @@ void pmField::printv() const {
 	for(int i=0; i<25-name.size(); i++) {
 		ProLog::pLogger::logf<ProLog::LMA>(" ");
 	}
-	pmTensor tensor = this->evaluate(0);
-	ProLog::pLogger::logf<ProLog::LMA>("[%i by %i]", tensor.get_numrows(), tensor.get_numcols());
+	ProLog::pLogger::logf<ProLog::LMA>("[%i by %i]", rows, columns);
 	if(!this->is_symmetric()) {
 		ProLog::pLogger::logf<ProLog::LMA>(" asym,");
 	}
@@ -156,13 +208,22 @@ void pmField::printv() const {
 /// Returns the size of the field.
 /////////////////////////////////////////////////////////////////////////////////////////
 int pmField::get_field_size() const {
-	return value[0].size();
+	return number_of_nodes;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the index of the array holding the given level.
+/////////////////////////////////////////////////////////////////////////////////////////
+size_t pmField::slot(size_t const& level) const {
+	return (head+level)%value.size();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Sets the depth of data storage.
+/// Sets the depth of data storage. New levels are initialized with the oldest one.
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmField::set_storage_depth(size_t const& d) {
+	std::rotate(value.begin(), value.begin()+head, value.end());
+	head = 0;
 	value.resize(d,value.back());
 }
 
@@ -170,37 +231,103 @@ size_t pmField::get_storage_depth() const {
 	return value.size();
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Turns the ring of levels: the current values become the level 1 values and so on,
+/// while the oldest array is reused for the current level starting from a copy of the
+/// former current values.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmField::advance_levels() {
+	if(value.size()<2) { return; }
+	head = (head+value.size()-1)%value.size();
+	value[slot(0)] = value[slot(1)];
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Evaluates the field.
 /////////////////////////////////////////////////////////////////////////////////////////
 pmTensor pmField::evaluate(int const& i, size_t const& level/*=0*/) const {
-	return value[level][i];
+	pmTensor tensor{rows, columns};
+	double const* data = value[slot(level)].data()+(size_t)i*get_number_of_components();
+	for(int e=0; e<tensor.numel(); e++) {
+		tensor[e] = data[e];
+	}
+	return tensor;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Sets the value of the ith node.
+/// Returns the number of rows of the nodes.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmField::get_numrows() const {
+	return rows;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the number of columns of the nodes.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmField::get_numcols() const {
+	return columns;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the number of components of the nodes.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmField::get_number_of_components() const {
+	return rows*columns;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the raw data of the given level. The components of the ith node start at
+/// i*get_number_of_components().
+/////////////////////////////////////////////////////////////////////////////////////////
+double const* pmField::get_data(size_t const& level/*=0*/) const {
+	return value[slot(level)].data();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the raw data of the given level for modification. Locks are not checked and
+/// former levels are not updated.
+/////////////////////////////////////////////////////////////////////////////////////////
+double* pmField::get_data(size_t const& level/*=0*/) {
+	return value[slot(level)].data();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the first component of the ith node.
+/////////////////////////////////////////////////////////////////////////////////////////
+double pmField::get_scalar(int const& i, size_t const& level/*=0*/) const {
+	return value[slot(level)][(size_t)i*get_number_of_components()];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits the loading of the field into the given bytecode.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmField::compile(pmBytecode& code, size_t const& level/*=0*/) const {
+	return code.load_field(this, level);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Sets the current value of the ith node. Former levels are kept until the next call
+/// of advance_levels.
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmField::set_value(pmTensor const& v, int const& i/*=0*/, bool const& forced/*=false*/) {
 	if(locked[i] && !forced) { return; }
-	for(int level=0; level<this->value.size()-1; level++) {
-		value[level+1][i] = value[level][i];
-	}
-	value[0][i] = v;
+	store(value[slot(0)].data()+(size_t)i*get_number_of_components(), v);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Returns the value of the ith node.
 /////////////////////////////////////////////////////////////////////////////////////////
-pmTensor const& pmField::get_value(int const& i) const {
-	return value[0][i];
+pmTensor pmField::get_value(int const& i) const {
+	return evaluate(i);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Returns the field type.
 /////////////////////////////////////////////////////////////////////////////////////////
 std::string pmField::get_type() const {
-	if(value[0][0].is_scalar()) { return "SCALAR"; }
-	if(value[0][0].is_vector()) { return "VECTOR"; }
+	pmTensor shape{rows, columns};
+	if(shape.is_scalar()) { return "SCALAR"; }
+	if(shape.is_vector()) { return "VECTOR"; }
 	return "TENSOR";
 }
 
@@ -223,11 +350,15 @@ std::shared_ptr<pmField> pmField::clone() const {
 /// If N<current size, the elements above N are destroyed.
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmField::set_field_size(size_t const& N) {
-	if(N!=value[0].size()) {
+	if(N!=number_of_nodes) {
+		int n = get_number_of_components();
 		for(auto& it:value) {
-			pmTensor ctensor = it.back();
-			it.resize(N, ctensor);	
+			it.resize(N*n);
+			for(size_t i=number_of_nodes; i<N && number_of_nodes>0; i++) {
+				std::copy_n(it.begin()+(number_of_nodes-1)*n, n, it.begin()+i*n);
+			}
 		}
+		number_of_nodes = N;
 	}
 	locked.resize(N,false);
 }
@@ -257,21 +388,44 @@ void pmField::set_symmetry(bool const& sym) {
 /// Deletes the member of the field with the given index.
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmField::delete_member(size_t const& i) {
+	int n = get_number_of_components();
 	for(auto& level_it:value) {
-		level_it[i] = level_it.back();
-		level_it.pop_back();
+		if(i+1<number_of_nodes) {
+			std::copy_n(level_it.begin()+(number_of_nodes-1)*n, n, level_it.begin()+i*n);
+		}
+		level_it.resize((number_of_nodes-1)*n);
 	}
-	locked.erase(locked.begin()+i);
+	number_of_nodes--;
+	locked[i] = locked.back();
+	locked.pop_back();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Deletes the set of members of the fiels listed in the given delete_indices vector.
+/// The order of the remaining members is kept.
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmField::delete_set(std::vector<size_t> const& delete_indices) {
+	std::vector<bool> marked(number_of_nodes, false);
+	for(auto const& it:delete_indices) {
+		marked[it] = true;
+	}
+	int n = get_number_of_components();
+	size_t remaining = 0;
+	for(size_t i=0; i<number_of_nodes; i++) {
+		if(marked[i]) { continue; }
+		if(remaining<i) {
+			for(auto& level_it:value) {
+				std::copy_n(level_it.begin()+i*n, n, level_it.begin()+remaining*n);
+			}
+		}
+		locked[remaining] = locked[i];
+		remaining++;
+	}
 	for(auto& level_it:value) {
-		Common::delete_indices(level_it, delete_indices);
+		level_it.resize(remaining*n);
 	}
-	Common::delete_indices(locked, delete_indices);
+	locked.resize(remaining);
+	number_of_nodes = remaining;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -280,11 +434,14 @@ void pmField::delete_set(std::vector<size_t> const& delete_indices) {
 void pmField::add_member(pmTensor const& v/*=pmTensor{}*/) {
 	pmTensor tensor = v;
 	if(tensor.numel()==0) {
-		tensor = value[0].back();
+		tensor = this->evaluate(number_of_nodes-1);
 	}
+	int n = get_number_of_components();
 	for(auto& level_it:value) {
-		level_it.push_back(tensor);
+		level_it.resize((number_of_nodes+1)*n);
+		store(level_it.data()+number_of_nodes*n, tensor);
 	}
+	number_of_nodes++;
 	locked.push_back(false);
 }
 
@@ -292,12 +449,45 @@ void pmField::add_member(pmTensor const& v/*=pmTensor{}*/) {
 /// Duplicates the member with the given index.
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmField::duplicate_member(size_t const& i) {
+	int n = get_number_of_components();
 	for(auto& it:value) {
-		it.push_back(it[i]);
+		it.resize((number_of_nodes+1)*n);
+		std::copy_n(it.begin()+i*n, n, it.begin()+number_of_nodes*n);
 	}
+	number_of_nodes++;
 	locked.push_back(false);
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Appends a member for each of the given parents at once. The kth new member takes the
+/// values of the parents[k]th member on all levels.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmField::append_members(std::vector<size_t> const& parents, size_t const& num_threads/*=1*/) {
+	int n = get_number_of_components();
+	size_t first = number_of_nodes;
+	for(auto& it:value) {
+		it.resize((first+parents.size())*n);
+		pmParallel::parallel_for(0, parents.size(), num_threads, [&](int const& start, int const& end){
+			for(int k=start; k<end; k++) {
+				std::copy_n(it.begin()+parents[k]*n, n, it.begin()+(first+k)*n);
+			}
+		});
+	}
+	number_of_nodes += parents.size();
+	locked.resize(number_of_nodes, false);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Reorders the members of the field on all levels. The ith member takes the value of the
+/// order[i]th member.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmField::reorder(std::vector<int> const& order) {
+	for(auto& level_it:value) {
+		pmSort::reorder(level_it, order, get_number_of_components());
+	}
+	pmSort::reorder(locked, order);
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Sets the printable variable.
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -314,4 +504,4 @@ bool pmField::is_printable() const {
 
 void pmField::set_lock(size_t const& idx, bool const& lck/*=true*/) {
 	locked[idx] = lck;
-}
\ No newline at end of file
+}
@@ -19,8 +19,10 @@
 */
     
 #include "pmParticle_system.h"
+#include "pmParallel.h"
 #include "commonutils/Common.h"
 #include <numeric>
+#include <atomic>
 #include "Color_define.h"
 
 using namespace Nauticle;
@@ -29,7 +31,6 @@ using namespace Nauticle;
 /// Constructor.
 /////////////////////////////////////////////////////////////////////////////////////////
 pmParticle_system::pmParticle_system(std::vector<pmTensor> const& value, pmDomain const& dm) : pmField{"r",value}, pmDomain{dm} {
-	pidx.resize(value.size());
 	periodic_jump = std::make_shared<pmField>("periodic_jump", value.size(), pmTensor{(int)dm.get_dimensions(),1,0});
 	periodic_jump->set_field_size(value.size());
 }
@@ -74,6 +75,21 @@ void pmParticle_system::printv() const {
 	pmField::printv();
 	ProLog::pLogger::line_feed(1);
 	pmDomain::printv();
+	if(sort_interval>0) {
+		ProLog::pLogger::logf<NAUTICLE_COLOR>("\n               sort interval: %i", (int)sort_interval);
+	}
+	if(skin>0) {
+		ProLog::pLogger::logf<NAUTICLE_COLOR>("\n               skin: %g", skin);
+	}
+	if(sparse_grid) {
+		ProLog::pLogger::logf<NAUTICLE_COLOR>("\n               sparse grid");
+	}
+	if(half_stencil) {
+		ProLog::pLogger::logf<NAUTICLE_COLOR>("\n               half stencil");
+	}
+	if(pair_cache_budget>0) {
+		ProLog::pLogger::logf<NAUTICLE_COLOR>("\n               pair cache: %i MB", (int)pair_cache_budget);
+	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -94,11 +110,11 @@ std::shared_ptr<pmParticle_system> pmParticle_system::clone() const {
 /// Sets the number of particles in tha particle system.
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmParticle_system::set_field_size(size_t const& N) {
-	if(N!=value[0].size()) {
+	if(N!=number_of_nodes) {
 		pmField::set_field_size(N);
-		pidx.resize(N);
 		periodic_jump->set_field_size(N);
 		this->up_to_date = false;
+		this->verlet_valid = false;
 	}
 }
 
@@ -106,14 +122,15 @@ void pmParticle_system::restrict_particles(std::vector<size_t>& del) {
 	if(this->up_to_date) { return; }
 	this->build_cell_iterator();
 	pmTensor cell_number = maximum-minimum;
-	for(int i=0; i<value[0].size(); i++) {
-		pmTensor g = grid_coordinates(value[0][i]);
+	int n = get_number_of_components();
+	for(int i=0; i<number_of_nodes; i++) {
+		pmTensor g = grid_coordinates(this->evaluate(i));
 		pmTensor shift = (g-mod(g,cell_number)).multiply_term_by_term(cell_size);
 		periodic_jump->set_value(periodic_jump->get_value(i)+shift.divide_term_by_term(this->get_physical_size()),i);
 		for(auto& it:value) {
 			size_t deletable = 0;
-			for(int j=0; j<it[i].numel(); j++) {
-				it[i][j] = it[i][j] - shift[j]*(boundary[j]!=2);
+			for(int j=0; j<n; j++) {
+				it[i*n+j] = it[i*n+j] - shift[j]*(boundary[j]!=2);
 				deletable += (shift[j]!=0 && boundary[j]==2);
 			}
 			if(deletable>0) {
@@ -138,27 +155,260 @@ bool pmParticle_system::is_up_to_date() const {
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Updates the whole neighbour list.
+/// Updates the whole neighbour list. The content of each cell forms a contiguous and
+/// ascending [cell_start,cell_start+cell_count) range in sorted_idx.
 /////////////////////////////////////////////////////////////////////////////////////////
-bool pmParticle_system::update_neighbor_list() {
-	std::fill(pidx.begin(), pidx.end(), -1);
-	cidx.resize(std::round((maximum-minimum).productum()));
-	std::fill(cidx.begin(), cidx.end(), -1);
-	for(int i=0; i<this->get_field_size(); i++) {
-        pmTensor grid_crd = grid_coordinates(this->get_value(i));
-        int hkey = hash_key(grid_crd);
-        if(hkey>cidx.size() || hkey<0) {
-        	return false;
-        }
-        if(cidx[hkey]!=-1) {
-        	pidx[i] = cidx[hkey];
-        }
-        cidx[hkey] = i;
+bool pmParticle_system::update_neighbor_list(size_t const& num_threads/*=1*/) {
+	pair_cache_valid = false;
+	if(this->has_verlet_list() && verlet_valid && !this->verlet_list_expired()) {
+		this->up_to_date = true;
+		return true;
+	}
+	this->build_stencil();
+	bool success = sparse_grid ? this->build_sparse_cells(num_threads) : this->build_dense_cells(num_threads);
+	if(!success) {
+		return false;
+	}
+	if(this->has_verlet_list()) {
+		this->build_verlet_list();
 	}
 	this->up_to_date = true;
 	return true;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Builds the cell structure for all cells of the domain. Particle indices are
+/// counting-sorted by their cells on num_threads threads: cell keys are computed and
+/// histogrammed, then the particles are scattered using the exclusive prefix sum of the
+/// histogram.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmParticle_system::build_dense_cells(size_t const& num_threads) {
+	cell_keys.clear();
+	int num_cells = this->get_num_cells();
+	int num_particles = this->get_field_size();
+	std::vector<std::atomic<int>> counter(num_cells);
+	std::atomic<bool> inside{true};
+	particle_cell.resize(num_particles);
+	pmParallel::parallel_for(0, num_particles, num_threads, [&](int const& start, int const& end){
+		for(int i=start; i<end; i++) {
+			int key = (int)this->cell_key(this->evaluate(i));
+			particle_cell[i] = key;
+			if(key<0) {
+				inside = false;
+				continue;
+			}
+			counter[key].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+	if(!inside) {
+		return false;
+	}
+	cell_start.resize(num_cells);
+	cell_count.resize(num_cells);
+	int num_blocks = std::max(1, std::min((int)num_threads, num_cells));
+	int cells_per_block = (num_cells+num_blocks-1)/num_blocks;
+	std::vector<int> block_offset(num_blocks+1, 0);
+	pmParallel::parallel_for(0, num_blocks, num_threads, [&](int const& start, int const& end){
+		for(int b=start; b<end; b++) {
+			for(int c=b*cells_per_block; c<std::min((b+1)*cells_per_block, num_cells); c++) {
+				cell_count[c] = counter[c].load(std::memory_order_relaxed);
+				counter[c].store(0, std::memory_order_relaxed);
+				block_offset[b+1] += cell_count[c];
+			}
+		}
+	});
+	std::partial_sum(block_offset.begin(), block_offset.end(), block_offset.begin());
+	pmParallel::parallel_for(0, num_blocks, num_threads, [&](int const& start, int const& end){
+		for(int b=start; b<end; b++) {
+			int offset = block_offset[b];
+			for(int c=b*cells_per_block; c<std::min((b+1)*cells_per_block, num_cells); c++) {
+				cell_start[c] = offset;
+				offset += cell_count[c];
+			}
+		}
+	});
+	sorted_idx.resize(num_particles);
+	pmParallel::parallel_for(0, num_particles, num_threads, [&](int const& start, int const& end){
+		for(int i=start; i<end; i++) {
+			int key = particle_cell[i];
+			sorted_idx[cell_start[key]+counter[key].fetch_add(1, std::memory_order_relaxed)] = i;
+		}
+	});
+	if(num_threads>1) {
+		// concurrent scattering does not preserve the particle order inside the cells
+		pmParallel::parallel_for(0, num_cells, num_threads, [&](int const& start, int const& end){
+			for(int c=start; c<end; c++) {
+				if(cell_count[c]>1) {
+					std::sort(sorted_idx.begin()+cell_start[c], sorted_idx.begin()+cell_start[c]+cell_count[c]);
+				}
+			}
+		});
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Builds the cell structure for the occupied cells only. The (cell key, particle index)
+/// pairs are sorted on num_threads threads and the ordered keys of the occupied cells are
+/// stored in cell_keys, thus memory scales with the number of particles.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmParticle_system::build_sparse_cells(size_t const& num_threads) {
+	int num_particles = this->get_field_size();
+	std::vector<std::pair<int64_t,int>> keys(num_particles);
+	std::atomic<bool> inside{true};
+	pmParallel::parallel_for(0, num_particles, num_threads, [&](int const& start, int const& end){
+		for(int i=start; i<end; i++) {
+			keys[i] = std::make_pair(this->cell_key(this->evaluate(i)), i);
+			if(keys[i].first<0) {
+				inside = false;
+			}
+		}
+	});
+	if(!inside) {
+		return false;
+	}
+	int num_chunks = std::max(1, std::min((int)num_threads, num_particles));
+	int chunk_size = (num_particles+num_chunks-1)/num_chunks;
+	pmParallel::parallel_for(0, num_chunks, num_threads, [&](int const& start, int const& end){
+		for(int b=start; b<end; b++) {
+			std::sort(keys.begin()+std::min(b*chunk_size, num_particles), keys.begin()+std::min((b+1)*chunk_size, num_particles));
+		}
+	});
+	for(int width=chunk_size; width<num_particles; width*=2) {
+		int num_merges = (num_particles+2*width-1)/(2*width);
+		pmParallel::parallel_for(0, num_merges, num_threads, [&](int const& start, int const& end){
+			for(int m=start; m<end; m++) {
+				auto first = keys.begin()+m*2*width;
+				auto middle = keys.begin()+std::min((m*2+1)*width, num_particles);
+				auto last = keys.begin()+std::min((m*2+2)*width, num_particles);
+				std::inplace_merge(first, middle, last);
+			}
+		});
+	}
+	sorted_idx.resize(num_particles);
+	cell_keys.clear();
+	cell_start.clear();
+	cell_count.clear();
+	for(int i=0; i<num_particles; i++) {
+		sorted_idx[i] = keys[i].second;
+		if(cell_keys.empty() || cell_keys.back()!=keys[i].first) {
+			cell_keys.push_back(keys[i].first);
+			cell_start.push_back(i);
+			cell_count.push_back(0);
+		}
+		cell_count.back()++;
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Builds the Verlet list of every particle based on the cell structure. Neighbours are
+/// collected within cell_size*(1+skin) together with the code of the cell image they are
+/// found in (index in the cell iterator).
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_system::build_verlet_list() {
+	this->build_cell_iterator();
+	int reach = std::ceil(1.0+skin);
+	if(verlet_iterator.empty()) {
+		std::vector<int> elements;
+		for(int e=-reach; e<=reach; e++) {
+			elements.push_back(e);
+		}
+		combinations(elements, this->get_dimensions(), verlet_iterator);
+	}
+	int num_particles = this->get_field_size();
+	size_t dimensions = this->get_dimensions();
+	pmTensor domain_cells = maximum-minimum;
+	pmTensor physical_minimum = this->get_physical_minimum();
+	pmTensor physical_maximum = this->get_physical_maximum();
+	pmTensor physical_size = this->get_physical_size();
+	pmTensor list_range = cell_size*(1.0+skin);
+	for(int k=0; k<dimensions; k++) {
+		if(boundary[k]==0 && domain_cells[k]<2*reach+1) {
+			ProLog::pLogger::warning_msgf("Verlet list requires at least %i cells in periodic directions.\n", 2*reach+1);
+			break;
+		}
+	}
+	verlet_position = value[slot(0)];
+	verlet_start.resize(num_particles+1);
+	verlet_idx.clear();
+	verlet_image.clear();
+	for(int i=0; i<num_particles; i++) {
+		verlet_start[i] = verlet_idx.size();
+		pmTensor pos_i = this->evaluate(i);
+		pmTensor grid_pos_i = grid_coordinates(pos_i);
+		for(auto const& it:verlet_iterator) {
+			pmTensor grid_pos_j = grid_pos_i+it;
+			pmTensor delta = -floor(grid_pos_j.divide_term_by_term(domain_cells));
+			bool skip_cell = false;
+			int image = 0;
+			for(int k=0; k<dimensions; k++) {
+				if(std::abs(delta[k])>1 || (boundary[k]==2 && delta[k]!=0)) {
+					skip_cell = true;
+					break;
+				}
+				if(boundary[k]==1 && delta[k]!=0) {
+					grid_pos_j[k] = delta[k]>0 ? -1-grid_pos_j[k] : 2*domain_cells[k]-1-grid_pos_j[k];
+				} else {
+					grid_pos_j[k] += delta[k]*domain_cells[k];
+				}
+				image = image*3 + (int)delta[k]+1;
+			}
+			if(skip_cell) {
+				continue;
+			}
+			int begin = 0;
+			int end = 0;
+			this->get_cell_content(grid_pos_j,begin,end);
+			for(int c=begin; c<end; c++) {
+				int j = sorted_idx[c];
+				pmTensor pos_j = this->evaluate(j);
+				bool in_range = true;
+				for(int k=0; k<dimensions; k++) {
+					if(boundary[k]==1) {
+						pos_j[k] += delta[k]*(delta[k]-1)*(physical_maximum[k]-pos_j[k]) + delta[k]*(delta[k]+1)*(physical_minimum[k]-pos_j[k]);
+					} else {
+						pos_j[k] -= delta[k]*physical_size[k];
+					}
+					if(std::abs(pos_j[k]-pos_i[k])>=list_range[k]) {
+						in_range = false;
+						break;
+					}
+				}
+				if(in_range) {
+					verlet_idx.push_back(j);
+					verlet_image.push_back(image);
+				}
+			}
+		}
+	}
+	verlet_start[num_particles] = verlet_idx.size();
+	verlet_valid = true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns true if any particle moved more than the half of the skin since the last build
+/// of the Verlet list.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmParticle_system::verlet_list_expired() const {
+	if(verlet_position.size()!=value[slot(0)].size()) { return true; }
+	int n = get_number_of_components();
+	size_t dimensions = this->get_dimensions();
+	pmTensor physical_size = this->get_physical_size();
+	for(int i=0; i<number_of_nodes; i++) {
+		for(int k=0; k<dimensions; k++) {
+			double displacement = value[slot(0)][i*n+k]-verlet_position[i*n+k];
+			if(boundary[k]==0) {
+				displacement -= std::round(displacement/physical_size[k])*physical_size[k];
+			}
+			if(std::abs(displacement)>0.5*skin*cell_size[k]) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Returns if the object is the position.
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -171,8 +421,8 @@ bool pmParticle_system::is_position() const {
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmParticle_system::delete_member(size_t const& i) {
 	pmField::delete_member(i);
-	pidx.resize(this->get_field_size());
 	this->up_to_date = false;
+	this->verlet_valid = false;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -180,8 +430,8 @@ void pmParticle_system::delete_member(size_t const& i) {
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmParticle_system::delete_set(std::vector<size_t> const& indices) {
 	pmField::delete_set(indices);
-	pidx.resize(this->get_field_size());
 	this->up_to_date = false;
+	this->verlet_valid = false;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -190,9 +440,9 @@ void pmParticle_system::delete_set(std::vector<size_t> const& indices) {
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmParticle_system::add_member(pmTensor const& v/*=pmTensor{}*/) {
 	pmField::add_member(v);
-	pidx.resize(this->get_field_size());
 	periodic_jump->add_member(pmTensor{(int)this->get_dimensions(),1,0});
 	this->up_to_date = false;
+	this->verlet_valid = false;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -200,14 +450,57 @@ void pmParticle_system::add_member(pmTensor const& v/*=pmTensor{}*/) {
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmParticle_system::duplicate_member(size_t const& i) {
 	pmField::duplicate_member(i);
-	pidx.resize(this->get_field_size());
 	periodic_jump->add_member(pmTensor{(int)this->get_dimensions(),1,0});
 	this->up_to_date = false;
+	this->verlet_valid = false;
 }
 
-std::vector<int> const& pmParticle_system::get_cell_content(pmTensor const& grid_crd, int& index) const {
-	index = cidx[this->hash_key(grid_crd)];
-    return pidx;
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Appends a copy of each of the given parents. Neighbour list is expired once.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_system::append_members(std::vector<size_t> const& parents, size_t const& num_threads/*=1*/) {
+	pmField::append_members(parents, num_threads);
+	pmTensor zero{(int)this->get_dimensions(),1,0};
+	for(size_t k=0; k<parents.size(); k++) {
+		periodic_jump->add_member(zero);
+	}
+	this->up_to_date = false;
+	this->verlet_valid = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Reorders the particles. Neighbour list is expired.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_system::reorder(std::vector<int> const& order) {
+	pmField::reorder(order);
+	this->up_to_date = false;
+	this->verlet_valid = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the particle indices and the [begin,end) range of the given cell in it.
+/////////////////////////////////////////////////////////////////////////////////////////
+std::vector<int> const& pmParticle_system::get_cell_content(pmTensor const& grid_crd, int& begin, int& end) const {
+	this->cell_range(this->hash_key(grid_crd), begin, end);
+	return sorted_idx;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the [begin,end) range of the cell with the given key in the particle indices.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_system::cell_range(int64_t const& key, int& begin, int& end) const {
+	int64_t idx = key;
+	if(sparse_grid) {
+		auto it = std::lower_bound(cell_keys.begin(), cell_keys.end(), key);
+		if(it==cell_keys.end() || *it!=key) {
+			begin = 0;
+			end = 0;
+			return;
+		}
+		idx = it-cell_keys.begin();
+	}
+	begin = cell_start[idx];
+	end = cell_start[idx]+cell_count[idx];
 }
 
 std::shared_ptr<pmField> pmParticle_system::get_periodic_jump() const {
@@ -218,4 +511,182 @@ pmTensor pmParticle_system::get_periodic_shift(size_t const& i) const {
 	return periodic_jump->evaluate(i).multiply_term_by_term(this->get_physical_size());
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Sets the number of steps between spatial sorting of the particles. Zero turns it off.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_system::set_sort_interval(size_t const& si) {
+	sort_interval = si;
+	sort_counter = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the number of steps between spatial sorting of the particles.
+/////////////////////////////////////////////////////////////////////////////////////////
+size_t pmParticle_system::get_sort_interval() const {
+	return sort_interval;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Counts the steps and returns true if the particles are to be sorted in the current step.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmParticle_system::is_sorting_due() {
+	if(sort_interval==0) { return false; }
+	bool due = sort_counter%sort_interval==0;
+	sort_counter++;
+	return due;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the particle order along the Morton curve of the grid cells. The ith particle
+/// of the sorted system is the order[i]th particle of the current one.
+/////////////////////////////////////////////////////////////////////////////////////////
+std::vector<int> pmParticle_system::get_spatial_order() const {
+	int num_particles = this->get_field_size();
+	std::vector<std::pair<uint64_t,int>> keys(num_particles);
+	for(int i=0; i<num_particles; i++) {
+		keys[i] = std::make_pair(morton_key(grid_coordinates(this->evaluate(i))), i);
+	}
+	std::stable_sort(keys.begin(), keys.end(), [](std::pair<uint64_t,int> const& a, std::pair<uint64_t,int> const& b) { return a.first<b.first; });
+	std::vector<int> order(num_particles);
+	for(int i=0; i<num_particles; i++) {
+		order[i] = keys[i].second;
+	}
+	return order;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Sets the skin of the Verlet list relative to the cell size. Zero turns it off.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_system::set_skin(double const& sk) {
+	if(sk<0 || sk>1) {
+		ProLog::pLogger::warning_msgf("Skin must be between 0 and 1. Verlet list is turned off.\n");
+		skin = 0;
+	} else {
+		skin = sk;
+	}
+	verlet_iterator.clear();
+	verlet_valid = false;
+	up_to_date = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the skin of the Verlet list relative to the cell size.
+/////////////////////////////////////////////////////////////////////////////////////////
+double pmParticle_system::get_skin() const {
+	return skin;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns true if the interactions use the Verlet list instead of the cell structure.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmParticle_system::has_verlet_list() const {
+	return skin>0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Turns on/off the pairwise evaluation of the symmetric interactions over the half
+/// stencil (Newton's third law).
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_system::set_half_stencil(bool const& hs) {
+	half_stencil = hs;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns true if the symmetric interactions are evaluated pairwise.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmParticle_system::is_half_stencil() const {
+	return half_stencil;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Sets the memory budget of the pair cache in megabytes. Zero turns the cache off.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_system::set_pair_cache_budget(size_t const& mb) {
+	pair_cache_budget = mb;
+	pair_cache_valid = false;
+	pair_cache_exceeded = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the memory budget of the pair cache in megabytes.
+/////////////////////////////////////////////////////////////////////////////////////////
+size_t pmParticle_system::get_pair_cache_budget() const {
+	return pair_cache_budget;
+}
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Collects the neighbours of all particles into a compressed sparse row list together
+/// with their relative positions and image codes on num_threads threads. The list is
+/// shared by all the interactions until the particles move. Returns false if the cache
+/// is turned off or it would exceed the memory budget, in which case the neighbours are
+/// searched on the fly.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmParticle_system::build_pair_cache(size_t const& num_threads/*=1*/) {
+	pair_cache_valid = false;
+	if(pair_cache_budget==0 || !up_to_date) { return false; }
+	int num_particles = this->get_field_size();
+	int dimensions = this->get_dimensions();
+	size_t pair_bytes = 2*sizeof(int)+dimensions*sizeof(double);
+	size_t max_pairs = pair_cache_budget*1024*1024/pair_bytes;
+	int nt = std::max(1, std::min((int)num_threads, num_particles));
+	int ppt = (num_particles+nt-1)/nt; // particles per thread
+	std::vector<std::vector<int>> local_idx(nt);
+	std::vector<std::vector<int>> local_image(nt);
+	std::vector<std::vector<double>> local_rel_pos(nt);
+	std::atomic<size_t> num_pairs{0};
+	pair_start.resize(num_particles+1);
+	pair_start[0] = 0;
+	pmParallel::parallel_for(0, nt, nt, [&](int const& t_begin, int const& t_end){
+		for(int t=t_begin; t<t_end; t++) {
+			int p_end = std::min(num_particles, (t+1)*ppt);
+			for(int i=t*ppt; i<p_end; i++) {
+				if(num_pairs>max_pairs) { return; }
+				int count = 0;
+				this->traverse_neighbors(i, [&](int const& j, pmTensor const& rel_pos, int const& image) {
+					local_idx[t].push_back(j);
+					local_image[t].push_back(image);
+					for(int k=0; k<dimensions; k++) {
+						local_rel_pos[t].push_back(rel_pos[k]);
+					}
+					count++;
+				});
+				pair_start[i+1] = count;
+				num_pairs += count;
+			}
+		}
+	});
+	if(num_pairs>max_pairs) {
+		if(!pair_cache_exceeded) {
+			ProLog::pLogger::warning_msgf("Pair cache exceeds the memory budget of %i MB. Neighbours are searched on the fly.\n", (int)pair_cache_budget);
+			pair_cache_exceeded = true;
+		}
+		pair_start.clear();
+		pair_idx.clear();
+		pair_image.clear();
+		pair_rel_pos.clear();
+		return false;
+	}
+	for(int i=0; i<num_particles; i++) {
+		pair_start[i+1] += pair_start[i];
+	}
+	pair_idx.resize(num_pairs);
+	pair_image.resize(num_pairs);
+	pair_rel_pos.resize(num_pairs*dimensions);
+	pmParallel::parallel_for(0, nt, nt, [&](int const& t_begin, int const& t_end){
+		for(int t=t_begin; t<t_end; t++) {
+			int offset = pair_start[std::min(num_particles, t*ppt)];
+			std::copy(local_idx[t].begin(), local_idx[t].end(), pair_idx.begin()+offset);
+			std::copy(local_image[t].begin(), local_image[t].end(), pair_image.begin()+offset);
+			std::copy(local_rel_pos[t].begin(), local_rel_pos[t].end(), pair_rel_pos.begin()+offset*dimensions);
+		}
+	});
+	pair_cache_valid = true;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns true if the pair cache is built for the current positions.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmParticle_system::has_pair_cache() const {
+	return pair_cache_valid && up_to_date;
+}
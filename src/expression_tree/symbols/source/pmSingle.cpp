@@ -19,6 +19,7 @@
 */
 
 #include "pmSingle.h"
+#include "pmBytecode.h"
 #include "Color_define.h"
 
 using namespace Nauticle;
@@ -26,7 +27,7 @@ using namespace Nauticle;
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Returns the value stored for constant or variable.
 /////////////////////////////////////////////////////////////////////////////////////////
-pmTensor const& pmSingle::get_value(int const& i/*=0*/) const {
+pmTensor pmSingle::get_value(int const& i/*=0*/) const {
 	return value[0];
 }
 
@@ -46,6 +47,13 @@ pmTensor pmSingle::evaluate(int const& i, size_t const& level/*=0*/) const {
 	return value[0];
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Emits the loading of the constant or variable into the given bytecode.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmSingle::compile(pmBytecode& code, size_t const& level/*=0*/) const {
+	return code.load_single(this, level);
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Returns the copy of the object.
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -66,7 +66,7 @@ void pmVTK_writer::push_pairs_to_polydata() {
 		{
 			auto connectivity = std::dynamic_pointer_cast<pmConnectivity<pmCollision_handler>>(it);
 			if(connectivity) {
-				auto pairs = connectivity->get_pairs();
+				auto const& pairs = connectivity->get_pairs();
 				std::vector<int> const& first = pairs.get_first();
 				std::vector<int> const& second = pairs.get_second();
 				if(first.empty()) { continue; }
@@ -99,9 +99,15 @@ void pmVTK_writer::push_nodes_to_polydata() {
 	vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
 	points->SetNumberOfPoints(n);
 	vtkSmartPointer<vtkCellArray> vertices =vtkSmartPointer<vtkCellArray>::New();
+	std::shared_ptr<pmParticle_system> psys = workspace->get_particle_system();
+	int components = psys->get_number_of_components();
+	double const* position = psys->get_data();
 	for(int i=0; i<n; i++) {
-		pmTensor position = workspace->get_value("r", i);
-		points->SetPoint(i, position(0), position(1), position(2));
+		double point[3] = {0,0,0};
+		for(int k=0; k<std::min(components,3); k++) {
+			point[k] = position[(size_t)i*components+k];
+		}
+		points->SetPoint(i, point);
 		vtkSmartPointer<vtkVertex> vertex = vtkSmartPointer<vtkVertex>::New();
 		vertex->GetPointIds()->SetId(0,i);
 		vertices->InsertNextCell(vertex);
@@ -167,15 +173,14 @@ void pmVTK_writer::push_point_fields_to_polydata() {
 		vtkSmartPointer<vtkDoubleArray> field = vtkSmartPointer<vtkDoubleArray>::New();
 		if(it->is_printable()) {
 			field->SetName(it->get_name().c_str());
+			int components = it->get_number_of_components();
+			double const* data = it->get_data();
 			if(it->get_type()=="SCALAR") {
 				field->SetNumberOfComponents(1);
 				field->SetNumberOfTuples(n);
+				double* tuple = field->GetPointer(0);
 				for(int i=0; i<n; i++) {
-					pmTensor t = it->evaluate(i);
-					if(t.numel()==0){
-						t = pmTensor{1,1,0.0};
-					}
-					field->SetTuple(i, &t[0]);
+					tuple[i] = components==0 ? 0.0 : data[(size_t)i*components];
 				}
 				if(!scalar_set) {
 					polydata->GetPointData()->SetScalars(field);
@@ -184,37 +189,26 @@ void pmVTK_writer::push_point_fields_to_polydata() {
 					polydata->GetPointData()->AddArray(field);
 				}
 			}
-			bool vector_set = false;
 			if(it->get_type()=="VECTOR") {
 				field->SetNumberOfComponents(3);
 				field->SetNumberOfTuples(n);
+				double* tuple = field->GetPointer(0);
 				for(int i=0; i<n; i++) {
-					pmTensor t = it->evaluate(i);
-					double data[3] = {0,0,0};
-					for(int j=0; j<t.numel(); j++) {
-						if(std::abs(t[j])<NAUTICLE_EPS) {
-							data[j] = 0.0;
-						} else {
-							data[j] = t[j];
-						}
+					for(int j=0; j<3; j++) {
+						double component = j<components ? data[(size_t)i*components+j] : 0.0;
+						tuple[i*3+j] = std::abs(component)<NAUTICLE_EPS ? 0.0 : component;
 					}
-					field->SetTuple(i, data);
 				}
 				polydata->GetPointData()->AddArray(field);
 			}
-			bool tensor_set = false;
 			if(it->get_type()=="TENSOR") {
 				field->SetNumberOfComponents(9);
 				field->SetNumberOfTuples(n);
+				double* tuple = field->GetPointer(0);
 				for(int i=0; i<n; i++) {
-					pmTensor t = it->evaluate(i);
-					pmTensor data{9,1,0};
-					for(int j=0; j<t.get_numcols(); j++) {
-						for(int k=0; k<t.get_numrows(); k++) {
-							data[k*t.get_numcols()+j] = t(k,j);
-						}
+					for(int j=0; j<9; j++) {
+						tuple[i*9+j] = j<components ? data[(size_t)i*components+j] : 0.0;
 					}
-					field->SetTuple(i, &data[0]);
 				}
 				polydata->GetPointData()->AddArray(field);
 			}
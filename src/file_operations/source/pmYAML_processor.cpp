@@ -101,11 +101,26 @@ std::shared_ptr<pmWorkspace> pmYAML_processor::get_workspace() const {
 	pmTensor maximum = tensor_parser.string_to_tensor(dm["maximum"].as<std::string>(), workspace);
 	pmTensor boundary = tensor_parser.string_to_tensor(dm["boundary"].as<std::string>(), workspace);
 	pmDomain domain = pmDomain{minimum, maximum, cell_size, boundary};
+	if(dm["sparse"]) {
+		domain.set_sparse_grid(tensor_parser.string_to_tensor(dm["sparse"].as<std::string>(), workspace)[0]);
+	}
 	// Read grids
 	std::shared_ptr<pmGrid_space> grid_space = get_grid_space(psys.begin(), psys.end(), workspace, domain.get_dimensions());
 	std::shared_ptr<pmGrid> tmp = grid_space->get_merged_grid();
 	std::vector<pmTensor> particle_grid = tmp->get_grid();
 	workspace->add_particle_system(particle_grid, domain);
+	if(dm["sort_interval"]) {
+		workspace->get_particle_system()->set_sort_interval(tensor_parser.string_to_tensor(dm["sort_interval"].as<std::string>(), workspace)[0]);
+	}
+	if(dm["skin"]) {
+		workspace->get_particle_system()->set_skin(tensor_parser.string_to_tensor(dm["skin"].as<std::string>(), workspace)[0]);
+	}
+	if(dm["half_stencil"]) {
+		workspace->get_particle_system()->set_half_stencil(tensor_parser.string_to_tensor(dm["half_stencil"].as<std::string>(), workspace)[0]);
+	}
+	if(dm["pair_cache"]) {
+		workspace->get_particle_system()->set_pair_cache_budget(tensor_parser.string_to_tensor(dm["pair_cache"].as<std::string>(), workspace)[0]);
+	}
 	workspace->delete_instance("gid");
 	workspace->add_field("gid", grid_space->get_grid_id_field());
 	// Read fields
@@ -288,7 +303,10 @@ std::shared_ptr<pmParameter_space> pmYAML_processor::get_parameter_space(std::sh
 	std::string output_format = "ASCII";
 	std::string file_start = "0";
 	std::string compile_case = "false";
+	std::string bytecode = "false";
 	std::string file_name_digits = "4";
+	std::string random_seed = "0";
+	std::string fuse_interactions = "true";
 	for(YAML::const_iterator sim_nodes=sim.begin();sim_nodes!=sim.end();sim_nodes++) {
 		if(sim_nodes->first.as<std::string>()=="parameter_space") {
 			auto expr_parser = std::make_shared<pmExpression_parser>();
@@ -315,9 +333,18 @@ std::shared_ptr<pmParameter_space> pmYAML_processor::get_parameter_space(std::sh
 				if(parameter_nodes->first.as<std::string>()=="compile_case") {
 					compile_case = parameter_nodes->second.as<std::string>();
 				}
+				if(parameter_nodes->first.as<std::string>()=="bytecode") {
+					bytecode = parameter_nodes->second.as<std::string>();
+				}
 				if(parameter_nodes->first.as<std::string>()=="file_name_digits") {
 					file_name_digits = parameter_nodes->second.as<std::string>();
 				}
+				if(parameter_nodes->first.as<std::string>()=="random_seed") {
+					random_seed = parameter_nodes->second.as<std::string>();
+				}
+				if(parameter_nodes->first.as<std::string>()=="fuse_interactions") {
+					fuse_interactions = parameter_nodes->second.as<std::string>();
+				}
 			}
 			auto expr_simulated_time = expr_parser->analyse_expression<pmExpression>(simulated_time,workspace);
 			auto expr_run_simulation = expr_parser->analyse_expression<pmExpression>(run_simulation,workspace);
@@ -326,7 +353,10 @@ std::shared_ptr<pmParameter_space> pmYAML_processor::get_parameter_space(std::sh
 			auto expr_output_format = expr_parser->analyse_expression<pmExpression>(output_format,workspace);
 			auto expr_file_start = expr_parser->analyse_expression<pmExpression>(file_start,workspace);
 			auto expr_compile_case = expr_parser->analyse_expression<pmExpression>(compile_case,workspace);
+			auto expr_bytecode = expr_parser->analyse_expression<pmExpression>(bytecode,workspace);
 			auto expr_file_digits = expr_parser->analyse_expression<pmExpression>(file_name_digits,workspace);
+			auto expr_random_seed = expr_parser->analyse_expression<pmExpression>(random_seed,workspace);
+			auto expr_fuse_interactions = expr_parser->analyse_expression<pmExpression>(fuse_interactions,workspace);
 			parameter_space->add_parameter("simulated_time", expr_simulated_time);
 			parameter_space->add_parameter("run_simulation", expr_run_simulation);
 			parameter_space->add_parameter("print_interval", expr_log_time);
@@ -334,7 +364,10 @@ std::shared_ptr<pmParameter_space> pmYAML_processor::get_parameter_space(std::sh
 			parameter_space->add_parameter("output_format", expr_output_format);
 			parameter_space->add_parameter("file_start", expr_file_start);
 			parameter_space->add_parameter("compile_case", expr_compile_case);
+			parameter_space->add_parameter("bytecode", expr_bytecode);
 			parameter_space->add_parameter("file_name_digits", expr_file_digits);
+			parameter_space->add_parameter("random_seed", expr_random_seed);
+			parameter_space->add_parameter("fuse_interactions", expr_fuse_interactions);
 		}
 	}
 	return parameter_space;
@@ -21,36 +21,35 @@
 #ifndef _PM_FIFTH_ORDER_KERNEL_H_
 #define _PM_FIFTH_ORDER_KERNEL_H_
 
-#include "pmKernel_function.h"
 #include "nauticle_constants.h"
 #include <cmath>
-#include <string>
+#include <cstddef>
 
 namespace Nauticle {
 	/** This class contains the quintic (Wendland) smoothing kernel implementations for 1, 2 and 3 dimensions.
 	*/
 	template<size_t dimension, bool derivative>
-	class pmFifth_order_kernel : public pmKernel_function {
-		double coefficient(double const& h) const override;
-		double kernel_at(double const& q) const;
+	class pmFifth_order_kernel {
 	public:
-		pmFifth_order_kernel();
-		double evaluate(double const& r, double const& influence_radius) const override;
+		static double smoothing_radius(double const& influence_radius);
+		static double coefficient(double const& h);
+		static double kernel_at(double const& q);
+		static double evaluate(double const& r, double const& influence_radius);
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////////////
-	/// Constructor.
+	/// Returns the smoothing radius h belonging to the given influence radius.
 	/////////////////////////////////////////////////////////////////////////////////////////
 	template<size_t dimension, bool derivative>
-	pmFifth_order_kernel<dimension,derivative>::pmFifth_order_kernel() {
-		this->name = derivative?std::string("d"):std::string("")+std::string("Wp522")+std::to_string(dimension)+std::string("0");
+	double pmFifth_order_kernel<dimension,derivative>::smoothing_radius(double const& influence_radius) {
+		return influence_radius/2.0;
 	}
 
 	/////////////////////////////////////////////////////////////////////////////////////////
 	/// Returns the normalization coefficient of the kernel function or its derivative.
 	/////////////////////////////////////////////////////////////////////////////////////////
 	template<size_t dimension, bool derivative>
-	double pmFifth_order_kernel<dimension,derivative>::coefficient(double const& h) const {
+	double pmFifth_order_kernel<dimension,derivative>::coefficient(double const& h) {
 		switch(dimension) {
 			default:
 			case 1 : return derivative ? 30.0/8.0/h/h : 3.0/4.0/h;
@@ -63,7 +62,7 @@ namespace Nauticle {
 	/// Returns the value of the kernel function or its derivative at a given place q=r/h.
 	/////////////////////////////////////////////////////////////////////////////////////////
 	template<size_t dimension, bool derivative>
-	double pmFifth_order_kernel<dimension,derivative>::kernel_at(double const& q) const {
+	double pmFifth_order_kernel<dimension,derivative>::kernel_at(double const& q) {
 		if(!derivative) {
 			double val = (1.0-q/2.0);
 			val*=val; val*=val;
@@ -78,10 +77,9 @@ namespace Nauticle {
 	/// Returns the kernel value or its derivative at a given distance r and radius influence_radius.
 	/////////////////////////////////////////////////////////////////////////////////////////
 	template<size_t dimension, bool derivative>
-	double pmFifth_order_kernel<dimension,derivative>::evaluate(double const& r, double const& influence_radius) const {
-		double h = influence_radius/2.0;
-		double q = r/h;
-		return coefficient(h)*kernel_at(q);
+	double pmFifth_order_kernel<dimension,derivative>::evaluate(double const& r, double const& influence_radius) {
+		double h = smoothing_radius(influence_radius);
+		return coefficient(h)*kernel_at(r/h);
 	}
 }
 
@@ -21,36 +21,35 @@
 #ifndef _PM_FIRST_ORDER_KERNEL_H_
 #define _PM_FIRST_ORDER_KERNEL_H_
 
-#include "pmKernel_function.h"
 #include "nauticle_constants.h"
 #include <cmath>
-#include <string>
+#include <cstddef>
 
 namespace Nauticle {
 	/** This class contains the first order smoothing kernel implementations for 1, 2 and 3 dimensions.
 	*/
     template<size_t dimension, bool derivative>
-    class pmFirst_order_kernel : public pmKernel_function {
-        double coefficient(double const& influence_radius) const override;
-        double kernel_at(double const& q) const;
+    class pmFirst_order_kernel {
     public:
-        pmFirst_order_kernel();
-        double evaluate(double const& r, double const& influence_radius) const override;
+        static double smoothing_radius(double const& influence_radius);
+        static double coefficient(double const& influence_radius);
+        static double kernel_at(double const& q);
+        static double evaluate(double const& r, double const& influence_radius);
     };
 
     /////////////////////////////////////////////////////////////////////////////////////////
-    /// Constructor.
+    /// Returns the smoothing radius h belonging to the given influence radius.
     /////////////////////////////////////////////////////////////////////////////////////////
     template<size_t dimension, bool derivative>
-    pmFirst_order_kernel<dimension,derivative>::pmFirst_order_kernel() {
-        this->name = derivative?std::string("d"):std::string("")+std::string("Wp111")+std::to_string(dimension)+std::string("0");
+    double pmFirst_order_kernel<dimension,derivative>::smoothing_radius(double const& influence_radius) {
+        return influence_radius;
     }
 
     /////////////////////////////////////////////////////////////////////////////////////////
     /// Returns the normalization coefficient of the kernel function or its derivative.
     /////////////////////////////////////////////////////////////////////////////////////////
     template<size_t dimension, bool derivative>
-    double pmFirst_order_kernel<dimension,derivative>::coefficient(double const& influence_radius) const {
+    double pmFirst_order_kernel<dimension,derivative>::coefficient(double const& influence_radius) {
         switch(dimension) {
             default:
             case 1 : return derivative ? 1.0/influence_radius/influence_radius : 1.0/influence_radius;
@@ -63,7 +62,7 @@ namespace Nauticle {
     /// Returns the value of the kernel function or its derivative at a given place q=r/h.
     /////////////////////////////////////////////////////////////////////////////////////////
     template<size_t dimension, bool derivative>
-    double pmFirst_order_kernel<dimension,derivative>::kernel_at(double const& q) const {
+    double pmFirst_order_kernel<dimension,derivative>::kernel_at(double const& q) {
         if(!derivative) {
             return 1.0-q;
         } else {
@@ -75,9 +74,9 @@ namespace Nauticle {
     /// Returns the kernel value or its derivative at a given distance r and radius influence_radius.
     /////////////////////////////////////////////////////////////////////////////////////////
     template<size_t dimension, bool derivative>
-    double pmFirst_order_kernel<dimension,derivative>::evaluate(double const& r, double const& influence_radius) const {
-        double q = r/influence_radius;
-        return coefficient(influence_radius)*kernel_at(q);
+    double pmFirst_order_kernel<dimension,derivative>::evaluate(double const& r, double const& influence_radius) {
+        double h = smoothing_radius(influence_radius);
+        return coefficient(h)*kernel_at(r/h);
     }
 }
 
@@ -21,54 +21,64 @@
 #ifndef _PM_GAUSSIAN_KERNEL_H_
 #define _PM_GAUSSIAN_KERNEL_H_
 
-#include "pmKernel_function.h"
 #include "nauticle_constants.h"
 #include <cmath>
-#include <string>
+#include <cstddef>
 
 namespace Nauticle {
 	/** This class contains the exponential (Gaussian) smoothing kernel implementations for 1, 2 and 3 dimensions.
 	*/
     template<size_t dimension, bool derivative>
-    class pmGaussian_kernel : public pmKernel_function {
-        double coefficient(double const& sigma) const override;
+    class pmGaussian_kernel {
     public:
-        pmGaussian_kernel();
-        double evaluate(double const& r, double const& sigma) const override;
+        static double smoothing_radius(double const& sigma);
+        static double coefficient(double const& sigma);
+        static double kernel_at(double const& q);
+        static double evaluate(double const& r, double const& sigma);
     };
 
     /////////////////////////////////////////////////////////////////////////////////////////
-    /// Constructor.
+    /// Returns the smoothing radius belonging to the given influence radius, which is sigma itself.
     /////////////////////////////////////////////////////////////////////////////////////////
     template<size_t dimension, bool derivative>
-    pmGaussian_kernel<dimension,derivative>::pmGaussian_kernel() {
-        this->name = derivative?std::string("d"):std::string("")+std::string("We210")+std::to_string(dimension)+std::string("0");
+    double pmGaussian_kernel<dimension,derivative>::smoothing_radius(double const& sigma) {
+        return sigma;
     }
 
     /////////////////////////////////////////////////////////////////////////////////////////
     /// Returns the normalization coefficient of the kernel function or its derivative.
     /////////////////////////////////////////////////////////////////////////////////////////
     template<size_t dimension, bool derivative>
-    double pmGaussian_kernel<dimension,derivative>::coefficient(double const& sigma) const {
+    double pmGaussian_kernel<dimension,derivative>::coefficient(double const& sigma) {
+        double coef;
         switch(dimension) {
             default:
-            case 1 : return 1.0/std::sqrt(2.0*NAUTICLE_PI*sigma*sigma);
-            case 2 : return 1.0/NAUTICLE_PI/sigma/sigma;
-            case 3 : return 1.0/std::pow(NAUTICLE_PI,1.5)/sigma/sigma/sigma;
+            case 1 : coef = 1.0/std::sqrt(2.0*NAUTICLE_PI*sigma*sigma); break;
+            case 2 : coef = 1.0/NAUTICLE_PI/sigma/sigma; break;
+            case 3 : coef = 1.0/std::pow(NAUTICLE_PI,1.5)/sigma/sigma/sigma; break;
         }
+        return derivative ? coef/sigma : coef;
     }
 
     /////////////////////////////////////////////////////////////////////////////////////////
-    /// Returns the kernel value or its derivative at a given distance r and radius influence_radius.
+    /// Returns the value of the kernel function or its derivative at a given place q=r/sigma.
     /////////////////////////////////////////////////////////////////////////////////////////
     template<size_t dimension, bool derivative>
-    double pmGaussian_kernel<dimension,derivative>::evaluate(double const& r, double const& sigma) const {
+    double pmGaussian_kernel<dimension,derivative>::kernel_at(double const& q) {
         if(!derivative) {
-            return coefficient(sigma)*std::exp(-r*r/sigma/sigma);
+            return std::exp(-q*q);
         } else {
-            return -r/sigma/sigma*coefficient(sigma)*std::exp(-r*r/sigma/sigma);
+            return -q*std::exp(-q*q);
         }
     }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+    /// Returns the kernel value or its derivative at a given distance r and radius influence_radius.
+    /////////////////////////////////////////////////////////////////////////////////////////
+    template<size_t dimension, bool derivative>
+    double pmGaussian_kernel<dimension,derivative>::evaluate(double const& r, double const& sigma) {
+        return coefficient(sigma)*kernel_at(r/sigma);
+    }
 }
 
 #endif //_PM_GAUSSIAN_KERNEL_H_
\ No newline at end of file
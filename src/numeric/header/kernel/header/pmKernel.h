@@ -22,9 +22,7 @@
 #define _PM_KERNEL_H_
 
 #include "pmKernel_includes.h"
-#include "pmNoncopyable.h"
-#include <memory>
-#include <cstdio>
+#include <cstddef>
 
 namespace Nauticle {
 
@@ -44,17 +42,92 @@ namespace Nauticle {
 	//  5: influence radius/smoothing radius. Zero for infinite influence radius.
 	//	6: Dimensions.
 	//	7: serial number.
+	//
+	//  The kernel functions are bound once by set_kernel_type() into a small table of
+	//  plain function pointers, hence no virtual call or allocation is involved per pair.
+	//  Pairwise loops can evaluate the normalization coefficient once per smoothing radius
+	//  and call only shape() for the individual neighbours.
 	*/
-	class pmKernel : public pmNoncopyable {
+	class pmKernel {
+	public:
+		using Func_kernel = double(*)(double const&);
+	private:
+		Func_kernel smoothing_radius_of;
+		Func_kernel coefficient_of;
+		Func_kernel kernel_at;
 	private:
-		std::shared_ptr<pmKernel_function> kernel;
+		template <typename KERNEL> void bind();
 	public:
 		pmKernel();
-		pmKernel(pmKernel const& other);
-		pmKernel& operator=(pmKernel const& other);
 		void set_kernel_type(size_t const& i, bool const& derivative);
 		double evaluate(double const& distance, double const& cell_size) const;
+		double smoothing_radius(double const& cell_size) const;
+		double coefficient(double const& smoothing_radius) const;
+		double shape(double const& q) const;
+		Func_kernel get_smoothing_radius_function() const;
+		Func_kernel get_coefficient_function() const;
+		Func_kernel get_shape_function() const;
 	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Binds the functions of the given kernel implementation.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	template <typename KERNEL>
+	void pmKernel::bind() {
+		smoothing_radius_of = &KERNEL::smoothing_radius;
+		coefficient_of = &KERNEL::coefficient;
+		kernel_at = &KERNEL::kernel_at;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Evaluates kernel.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	inline double pmKernel::evaluate(double const& distance, double const& cell_size) const {
+		double h = smoothing_radius_of(cell_size);
+		return coefficient_of(h)*kernel_at(distance/h);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the smoothing radius h belonging to the given influence radius.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	inline double pmKernel::smoothing_radius(double const& cell_size) const {
+		return smoothing_radius_of(cell_size);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the normalization coefficient belonging to the given smoothing radius.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	inline double pmKernel::coefficient(double const& smoothing_radius) const {
+		return coefficient_of(smoothing_radius);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the unnormalized kernel value at q=r/h.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	inline double pmKernel::shape(double const& q) const {
+		return kernel_at(q);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the bound function of the smoothing radius.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	inline pmKernel::Func_kernel pmKernel::get_smoothing_radius_function() const {
+		return smoothing_radius_of;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the bound function of the normalization coefficient.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	inline pmKernel::Func_kernel pmKernel::get_coefficient_function() const {
+		return coefficient_of;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the bound function of the unnormalized kernel.
+	/////////////////////////////////////////////////////////////////////////////////////////
+	inline pmKernel::Func_kernel pmKernel::get_shape_function() const {
+		return kernel_at;
+	}
 }
 
 #endif //_PM_KERNEL_H_
\ No newline at end of file
@@ -21,36 +21,35 @@
 #ifndef _PM_SECOND_ORDER_KERNEL_H_
 #define _PM_SECOND_ORDER_KERNEL_H_
 
-#include "pmKernel_function.h"
 #include "nauticle_constants.h"
 #include <cmath>
-#include <string>
+#include <cstddef>
 
 namespace Nauticle {
     /** This class contains the second order kernel smoothing kernel implementations for 1, 2 and 3 dimensions.
     */
     template<size_t dimension, bool derivative>
-    class pmSecond_order_kernel : public pmKernel_function {
-        double coefficient(double const& h) const override;
-        double kernel_at(double const& q) const;
+    class pmSecond_order_kernel {
     public:
-        pmSecond_order_kernel();
-        double evaluate(double const& r, double const& influence_radius) const override;
+        static double smoothing_radius(double const& influence_radius);
+        static double coefficient(double const& h);
+        static double kernel_at(double const& q);
+        static double evaluate(double const& r, double const& influence_radius);
     };
 
     /////////////////////////////////////////////////////////////////////////////////////////
-    /// Constructor.
+    /// Returns the smoothing radius h belonging to the given influence radius.
     /////////////////////////////////////////////////////////////////////////////////////////
     template<size_t dimension, bool derivative>
-    pmSecond_order_kernel<dimension,derivative>::pmSecond_order_kernel() {
-        this->name = derivative?std::string("d"):std::string("")+std::string("Wp222")+std::to_string(dimension)+std::string("0");
+    double pmSecond_order_kernel<dimension,derivative>::smoothing_radius(double const& influence_radius) {
+        return influence_radius/2.0;
     }
 
     /////////////////////////////////////////////////////////////////////////////////////////
     /// Returns the normalization coefficient of the kernel function or its derivative.
     /////////////////////////////////////////////////////////////////////////////////////////
     template<size_t dimension, bool derivative>
-    double pmSecond_order_kernel<dimension,derivative>::coefficient(double const& h) const {
+    double pmSecond_order_kernel<dimension,derivative>::coefficient(double const& h) {
         switch(dimension) {
             default:
             case 1 : return derivative ? 3.0/4.0/h/h : 1.0/h;
@@ -63,7 +62,7 @@ namespace Nauticle {
     /// Returns the value of the kernel function or its derivative at a given place q=r/h.
     /////////////////////////////////////////////////////////////////////////////////////////
     template<size_t dimension, bool derivative>
-    double pmSecond_order_kernel<dimension,derivative>::kernel_at(double const& q) const {
+    double pmSecond_order_kernel<dimension,derivative>::kernel_at(double const& q) {
         if(!derivative) {
             return 3.0/16.0*q*q-0.75*q+0.75;
         } else {
@@ -75,10 +74,9 @@ namespace Nauticle {
     /// Returns the kernel value or its derivative at a given distance r and radius influence_radius.
     /////////////////////////////////////////////////////////////////////////////////////////
     template<size_t dimension, bool derivative>
-    double pmSecond_order_kernel<dimension,derivative>::evaluate(double const& r, double const& influence_radius) const {
-        double h = influence_radius/2.0;
-        double q = r/h;
-        return coefficient(h)*kernel_at(q);
+    double pmSecond_order_kernel<dimension,derivative>::evaluate(double const& r, double const& influence_radius) {
+        double h = smoothing_radius(influence_radius);
+        return coefficient(h)*kernel_at(r/h);
     }
 }
 
@@ -29,7 +29,7 @@ using namespace Nauticle;
 /// Constructor.
 /////////////////////////////////////////////////////////////////////////////////////////
 pmKernel::pmKernel() {
-	kernel = std::make_shared<pmSecond_order_kernel<1,false>>();
+	bind<pmSecond_order_kernel<1,false>>();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -39,55 +39,48 @@ void pmKernel::set_kernel_type(size_t const& i, bool const& derivative) {
 	if(derivative) {
 		switch(i) {
 			default:
-			case 0: kernel = std::make_shared<pmZeroth_order_kernel<1,true>>(); break;
-			case 1: kernel = std::make_shared<pmZeroth_order_kernel<2,true>>(); break;
-			case 2: kernel = std::make_shared<pmZeroth_order_kernel<3,true>>(); break;
-			case 3: kernel = std::make_shared<pmFirst_order_kernel<1,true>>(); break;
-			case 4: kernel = std::make_shared<pmFirst_order_kernel<2,true>>(); break;
-			case 5: kernel = std::make_shared<pmFirst_order_kernel<3,true>>(); break;
-			case 6: kernel = std::make_shared<pmSecond_order_kernel<1,true>>(); break;
-			case 7: kernel = std::make_shared<pmSecond_order_kernel<2,true>>(); break;
-			case 8: kernel = std::make_shared<pmSecond_order_kernel<3,true>>(); break;
-			case 9: kernel = std::make_shared<pmThird_order_kernel<1,true>>(); break;
-			case 10: kernel = std::make_shared<pmThird_order_kernel<2,true>>(); break;
-			case 11: kernel = std::make_shared<pmThird_order_kernel<3,true>>(); break;
-			case 12: kernel = std::make_shared<pmFifth_order_kernel<1,true>>(); break;
-			case 13: kernel = std::make_shared<pmFifth_order_kernel<2,true>>(); break;
-			case 14: kernel = std::make_shared<pmFifth_order_kernel<3,true>>(); break;
-			case 15: kernel = std::make_shared<pmGaussian_kernel<1,true>>(); break;
-			case 16: kernel = std::make_shared<pmGaussian_kernel<2,true>>(); break;
-			case 17: kernel = std::make_shared<pmGaussian_kernel<3,true>>(); break;
+			case 0: bind<pmZeroth_order_kernel<1,true>>(); break;
+			case 1: bind<pmZeroth_order_kernel<2,true>>(); break;
+			case 2: bind<pmZeroth_order_kernel<3,true>>(); break;
+			case 3: bind<pmFirst_order_kernel<1,true>>(); break;
+			case 4: bind<pmFirst_order_kernel<2,true>>(); break;
+			case 5: bind<pmFirst_order_kernel<3,true>>(); break;
+			case 6: bind<pmSecond_order_kernel<1,true>>(); break;
+			case 7: bind<pmSecond_order_kernel<2,true>>(); break;
+			case 8: bind<pmSecond_order_kernel<3,true>>(); break;
+			case 9: bind<pmThird_order_kernel<1,true>>(); break;
+			case 10: bind<pmThird_order_kernel<2,true>>(); break;
+			case 11: bind<pmThird_order_kernel<3,true>>(); break;
+			case 12: bind<pmFifth_order_kernel<1,true>>(); break;
+			case 13: bind<pmFifth_order_kernel<2,true>>(); break;
+			case 14: bind<pmFifth_order_kernel<3,true>>(); break;
+			case 15: bind<pmGaussian_kernel<1,true>>(); break;
+			case 16: bind<pmGaussian_kernel<2,true>>(); break;
+			case 17: bind<pmGaussian_kernel<3,true>>(); break;
 		}
 	} else {
 		switch(i) {
 			default:
-			case 0: kernel = std::make_shared<pmZeroth_order_kernel<1,false>>(); break;
-			case 1: kernel = std::make_shared<pmZeroth_order_kernel<2,false>>(); break;
-			case 2: kernel = std::make_shared<pmZeroth_order_kernel<3,false>>(); break;
-			case 3: kernel = std::make_shared<pmFirst_order_kernel<1,false>>(); break;
-			case 4: kernel = std::make_shared<pmFirst_order_kernel<2,false>>(); break;
-			case 5: kernel = std::make_shared<pmFirst_order_kernel<3,false>>(); break;
-			case 6: kernel = std::make_shared<pmSecond_order_kernel<1,false>>(); break;
-			case 7: kernel = std::make_shared<pmSecond_order_kernel<2,false>>(); break;
-			case 8: kernel = std::make_shared<pmSecond_order_kernel<3,false>>(); break;
-			case 9: kernel = std::make_shared<pmThird_order_kernel<1,false>>(); break;
-			case 10: kernel = std::make_shared<pmThird_order_kernel<2,false>>(); break;
-			case 11: kernel = std::make_shared<pmThird_order_kernel<3,false>>(); break;
-			case 12: kernel = std::make_shared<pmFifth_order_kernel<1,false>>(); break;
-			case 13: kernel = std::make_shared<pmFifth_order_kernel<2,false>>(); break;
-			case 14: kernel = std::make_shared<pmFifth_order_kernel<3,false>>(); break;
-			case 15: kernel = std::make_shared<pmGaussian_kernel<1,false>>(); break;
-			case 16: kernel = std::make_shared<pmGaussian_kernel<2,false>>(); break;
-			case 17: kernel = std::make_shared<pmGaussian_kernel<3,false>>(); break;
+			case 0: bind<pmZeroth_order_kernel<1,false>>(); break;
+			case 1: bind<pmZeroth_order_kernel<2,false>>(); break;
+			case 2: bind<pmZeroth_order_kernel<3,false>>(); break;
+			case 3: bind<pmFirst_order_kernel<1,false>>(); break;
+			case 4: bind<pmFirst_order_kernel<2,false>>(); break;
+			case 5: bind<pmFirst_order_kernel<3,false>>(); break;
+			case 6: bind<pmSecond_order_kernel<1,false>>(); break;
+			case 7: bind<pmSecond_order_kernel<2,false>>(); break;
+			case 8: bind<pmSecond_order_kernel<3,false>>(); break;
+			case 9: bind<pmThird_order_kernel<1,false>>(); break;
+			case 10: bind<pmThird_order_kernel<2,false>>(); break;
+			case 11: bind<pmThird_order_kernel<3,false>>(); break;
+			case 12: bind<pmFifth_order_kernel<1,false>>(); break;
+			case 13: bind<pmFifth_order_kernel<2,false>>(); break;
+			case 14: bind<pmFifth_order_kernel<3,false>>(); break;
+			case 15: bind<pmGaussian_kernel<1,false>>(); break;
+			case 16: bind<pmGaussian_kernel<2,false>>(); break;
+			case 17: bind<pmGaussian_kernel<3,false>>(); break;
 		}
 	}
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////
-/// Evaluates kernel.
-/////////////////////////////////////////////////////////////////////////////////////////
-double pmKernel::evaluate(double const& distance, double const& cell_size) const {
-	return kernel->evaluate(distance, cell_size);
-}
-
 #undef NAUTICLE_PI
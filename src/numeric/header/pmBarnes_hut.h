@@ -0,0 +1,76 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+
+#ifndef _PM_BARNES_HUT_H_
+#define _PM_BARNES_HUT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Nauticle {
+	/** This class implements the Barnes-Hut tree for the approximation of gravitational
+	//  (1/r^2) accelerations. The bodies are sorted by their Morton keys and the quadtree
+	//  (octree in 3D) is formed by splitting the sorted range at each level. The top of
+	//  the tree is split serially, the subtrees below are built in parallel. Each node
+	//  stores the monopole and the quadrupole moment of its bodies. A node is accepted
+	//  as a whole if size/distance < theta, otherwise its children are visited, hence
+	//  theta=0 reproduces the direct summation.
+	*/
+	class pmBarnes_hut {
+	public:
+		static constexpr int leaf_size = 8;
+		static constexpr int max_depth = 21;
+	private:
+		struct pmNode {
+			int begin;
+			int end;
+			int level;
+			int first_child=-1;
+			int num_children=0;
+			bool complete=false;
+			double mass=0;
+			double center[3]={0,0,0};
+			double quadrupole[6]={0,0,0,0,0,0}; // xx, yy, zz, xy, xz, yz
+		};
+		int dimensions=0;
+		double origin[3]={0,0,0};
+		double extent=1;
+		std::vector<std::pair<uint64_t,int>> order;
+		std::vector<double> position;
+		std::vector<double> mass;
+		std::vector<pmNode> tree;
+	private:
+		void sort(size_t const& num_threads);
+		void subdivide(std::vector<pmNode>& nodes, int const& n, int const& limit, std::vector<int>& deferred) const;
+		void leaf_moments(pmNode& node) const;
+		void merge_moments(std::vector<pmNode>& nodes, pmNode& node) const;
+		void finalize(int const& n);
+	public:
+		void build(double const* pos, int const& stride, int const& dims, std::vector<double> const& masses, size_t const& num_threads);
+		void accelerate(double const* x, int const& self, double const& theta, double* acceleration) const;
+		void compute(double const& theta, size_t const& num_threads, std::vector<double>& acceleration) const;
+		int get_number_of_nodes() const;
+	};
+}
+
+#endif //_PM_BARNES_HUT_H_
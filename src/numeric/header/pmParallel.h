@@ -0,0 +1,44 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+    
+    
+#ifndef _PM_PARALLEL_H_
+#define _PM_PARALLEL_H_
+
+#include "pmThread_pool.h"
+
+namespace Nauticle {
+    /** This namespace contains functions for the multi-threaded execution of loops over
+    //  particles, cells or any other index range.
+    */
+    namespace pmParallel {
+        /////////////////////////////////////////////////////////////////////////////////////////
+        /// Calls func(start,end) for chunks covering the [begin,end) range using at most
+        /// num_threads threads of the persistent pool. Chunks are disjoint but their number
+        /// and bounds are not fixed, hence func must not rely on them.
+        /////////////////////////////////////////////////////////////////////////////////////////
+        template <typename F>
+        void parallel_for(int const& begin, int const& end, size_t const& num_threads, F const& func) {
+            pmThread_pool::instance().parallel_for(begin, end, num_threads, func);
+        }
+    }
+}
+
+#endif //_PM_PARALLEL_H_
@@ -0,0 +1,75 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+
+#ifndef _PM_PARTICLE_MESH_H_
+#define _PM_PARTICLE_MESH_H_
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace Nauticle {
+	/** This class implements the particle-mesh solver of long-range (1/r^(D-1)) interactions
+	//  in periodic domains of D dimensions. The masses are assigned to a regular grid by
+	//  NGP, CIC or TSC weights, the Poisson equation is solved by FFT and the accelerations
+	//  are interpolated back to the particles by the same weights. The number of grid cells
+	//  must be a power of two in every direction. The mesh is filled by gathering the
+	//  particles of the surrounding cells for each grid point, hence the result does not
+	//  depend on the number of threads. If a split radius r_s is set, the mesh force is
+	//  filtered by exp(-k^2*r_s^2) and the remaining short-range part is given by
+	//  short_range (P3M).
+	*/
+	class pmParticle_mesh {
+	public:
+		enum Assignment {NGP=1, CIC=2, TSC=3};
+	private:
+		int dimensions=0;
+		int order=TSC;
+		int cells[3]={1,1,1};
+		double origin[3]={0,0,0};
+		double spacing[3]={1,1,1};
+		double split=0;
+		size_t grid_size=1;
+		std::vector<int> first;
+		std::vector<double> weight;
+		std::vector<int> bucket_start;
+		std::vector<int> bucket_idx;
+		std::vector<std::complex<double>> density;
+		std::vector<std::complex<double>> work;
+	private:
+		void assign_weights(double const* pos, int const& stride, int const& n, size_t const& num_threads);
+		void sort_particles(int const& n);
+		void deposit(std::vector<double> const& mass, size_t const& num_threads);
+		void interpolate(int const& n, int const& direction, size_t const& num_threads, std::vector<double>& acceleration) const;
+		void transform(std::vector<std::complex<double>>& data, bool const& inverse, size_t const& num_threads) const;
+		static void fft(std::complex<double>* line, int const& n, bool const& inverse);
+	public:
+		void set_grid(double const* minimum, double const* size, int const* num_cells, int const& dims);
+		void set_order(int const& o);
+		void set_split(double const& rs);
+		double get_split() const;
+		void compute(double const* pos, int const& stride, std::vector<double> const& mass, double const& coef, size_t const& num_threads, std::vector<double>& acceleration);
+		double short_range(double const& r) const;
+		static int next_power_of_two(int const& n);
+	};
+}
+
+#endif //_PM_PARTICLE_MESH_H_
@@ -23,53 +23,116 @@
 
 #include "prolog/pLogger.h"
 #include "pmTensor.h"
-#include <cstdlib>
-#include <random>
+#include <cstdint>
+#include <cmath>
+#include <atomic>
 
 namespace Nauticle {
-    /** This namespace contains functions for random number generation.
+    /** This namespace contains functions for random number generation. The numbers are
+    //  produced by the counter-based Philox4x32-10 generator: each number is a pure function
+    //  of the seed, the call site (stream), the current step, the particle identifier and the
+    //  tensor element, hence no generator state is shared between threads and the results
+    //  do not depend on the number of threads, the evaluation order or the order of the
+    //  particles.
     */
     namespace pmRandom {
         enum RANDOM_TYPE {UNIFORM, NORMAL, LOGNORMAL};
+        struct pmState {
+            uint64_t seed=0;
+            uint64_t step=0;
+            std::atomic<uint32_t> streams{0};
+        };
+
         /////////////////////////////////////////////////////////////////////////////////////////
-        /// Generates a random number with R_TYPE distribution using the parameters p1 and p2.
+        /// Returns the process-wide settings of the generator.
         /////////////////////////////////////////////////////////////////////////////////////////
-        template <RANDOM_TYPE R_TYPE>
-        double random(double const& p1, double const& p2) {
-            static bool pseudo = true;
-            if(!pseudo) {
-                srand(time(NULL));
-                pseudo = false;
+        inline pmState& state() {
+            static pmState s;
+            return s;
+        }
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+        /// Sets the seed of the random numbers.
+        /////////////////////////////////////////////////////////////////////////////////////////
+        inline void set_seed(uint64_t const& seed) {
+            state().seed = seed;
+        }
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+        /// Sets the step counter. Calls of the same step return the same numbers.
+        /////////////////////////////////////////////////////////////////////////////////////////
+        inline void set_step(uint64_t const& step) {
+            state().step = step;
+        }
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+        /// Returns a new stream identifier. Each call site should hold its own stream.
+        /////////////////////////////////////////////////////////////////////////////////////////
+        inline uint32_t new_stream() {
+            return state().streams++;
+        }
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+        /// Philox4x32-10 block function: scrambles the counter ctr with the key.
+        /////////////////////////////////////////////////////////////////////////////////////////
+        inline void philox(uint32_t ctr[4], uint32_t key0, uint32_t key1) {
+            for(int r=0; r<10; r++) {
+                uint64_t p0 = (uint64_t)0xD2511F53u * ctr[0];
+                uint64_t p1 = (uint64_t)0xCD9E8D57u * ctr[2];
+                uint32_t c0 = (uint32_t)(p1>>32) ^ ctr[1] ^ key0;
+                uint32_t c2 = (uint32_t)(p0>>32) ^ ctr[3] ^ key1;
+                ctr[1] = (uint32_t)p1;
+                ctr[3] = (uint32_t)p0;
+                ctr[0] = c0;
+                ctr[2] = c2;
+                key0 += 0x9E3779B9u;
+                key1 += 0xBB67AE85u;
             }
+        }
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+        /// Converts two 32-bit words to a double with 53 random bits in [0,1).
+        /////////////////////////////////////////////////////////////////////////////////////////
+        inline double to_unit(uint32_t const& a, uint32_t const& b) {
+            return ((a>>5)*67108864.0 + (b>>6)) * (1.0/9007199254740992.0);
+        }
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+        /// Generates a random number with R_TYPE distribution using the parameters p1 and p2
+        /// for the given stream, node and element of the node.
+        /////////////////////////////////////////////////////////////////////////////////////////
+        template <RANDOM_TYPE R_TYPE>
+        double random(double const& p1, double const& p2, uint32_t const& stream, uint32_t const& node, uint32_t const& element=0) {
             if(p1>=p2 && R_TYPE==UNIFORM) {
                 ProLog::pLogger::warning_msgf("Random number cannot be generated if the range is incorrect. Returns zero.\n");
                 return 0.0;
             }
-            static std::default_random_engine generator;
+            pmState const& s = state();
+            uint32_t ctr[4] = {node, element, (uint32_t)s.step, (uint32_t)(s.step>>32)};
+            philox(ctr, (uint32_t)s.seed ^ stream, (uint32_t)(s.seed>>32) ^ (stream*0x9E3779B9u));
+            double u1 = to_unit(ctr[0], ctr[1]);
+            double u2 = to_unit(ctr[2], ctr[3]);
             switch(R_TYPE) {
                 default:
-                case UNIFORM:   { std::uniform_real_distribution<double> uniform(p1,p2);
-                                return uniform(generator); }
-                case NORMAL:    { std::normal_distribution<double> normal(p1,p2);
-                                return normal(generator); }
-                case LOGNORMAL:     { std::lognormal_distribution<double> lognormal(p1,p2);
-                                    return lognormal(generator); }
+                case UNIFORM:   return p1 + (p2-p1)*u1;
+                case NORMAL:    return p1 + p2*std::sqrt(-2.0*std::log(1.0-u1))*std::cos(2.0*M_PI*u2);
+                case LOGNORMAL: return std::exp(p1 + p2*std::sqrt(-2.0*std::log(1.0-u1))*std::cos(2.0*M_PI*u2));
             }
         }
 
         /////////////////////////////////////////////////////////////////////////////////////////
-        /// Generates a uniform distributed random tensor between p1 and p2. If the 
+        /// Generates a random tensor with R_TYPE distribution between p1 and p2. If the 
         /// dimensions of the given tensors do not match it returns an empty tensor.
         /////////////////////////////////////////////////////////////////////////////////////////
         template <RANDOM_TYPE R_TYPE> 
-        pmTensor random(Nauticle::pmTensor const& p1, Nauticle::pmTensor const& p2) {
+        pmTensor random(Nauticle::pmTensor const& p1, Nauticle::pmTensor const& p2, uint32_t const& stream, uint32_t const& node) {
             if(p1.get_numrows()!=p2.get_numrows() || p1.get_numcols()!=p2.get_numcols()) {
                 ProLog::pLogger::error_msgf("Random numbers cannot be generated if the dimensions of the limits does not match.\n");
                 return Nauticle::pmTensor{};
             }
             Nauticle::pmTensor random_tensor{p1.get_numrows(), p1.get_numcols()};
             for(int i=0; i<p1.numel(); i++) {
-                random_tensor[i] = random<R_TYPE>((double)p1[i], (double)p2[i]);
+                random_tensor[i] = random<R_TYPE>((double)p1[i], (double)p2[i], stream, node, (uint32_t)i);
             }
             return random_tensor;
         }
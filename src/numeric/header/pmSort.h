@@ -24,6 +24,7 @@
 #include <vector>
 #include <algorithm>
 #include <utility>
+#include <numeric>
 #include "prolog/pLogger.h"
 
 namespace Nauticle {
@@ -85,6 +86,64 @@ namespace Nauticle {
 		        to_reorder[i] = copy[reorder_by[i]];
 		    }
 		}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Reorders a vector holding blocks of stride consecutive elements per item based on another
+	/// vector. Here no sorting is performed.
+	/////////////////////////////////////////////////////////////////////////////////////////
+		template <typename T> void reorder(std::vector<T>& to_reorder, std::vector<int> const& reorder_by, size_t const& stride) {
+			if(to_reorder.size() != reorder_by.size()*stride) {
+				ProLog::pLogger::warning_msgf("Reorder requires vectors of consistent sizes.\n");
+				return;
+			}
+			std::vector<T> copy = to_reorder;
+		    for(int i=0; i<reorder_by.size(); ++i) {
+		        std::copy_n(copy.begin()+reorder_by[i]*stride, stride, to_reorder.begin()+i*stride);
+		    }
+		}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the inverse of the given permutation, i.e. the new position of each old index.
+	/////////////////////////////////////////////////////////////////////////////////////////
+		inline std::vector<int> inverse(std::vector<int> const& reorder_by) {
+			std::vector<int> inv(reorder_by.size());
+			for(int i=0; i<reorder_by.size(); ++i) {
+				inv[reorder_by[i]] = i;
+			}
+			return inv;
+		}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the new position of each of the n old indices after deleting the given ones
+	/// while keeping the order of the remaining ones. Deleted indices are mapped to -1.
+	/////////////////////////////////////////////////////////////////////////////////////////
+		inline std::vector<int> compaction(size_t const& n, std::vector<size_t> const& indices) {
+			std::vector<int> new_index(n, 0);
+			for(auto const& it:indices) {
+				new_index[it] = -1;
+			}
+			int remaining = 0;
+			for(auto& it:new_index) {
+				if(it==0) {
+					it = remaining++;
+				}
+			}
+			return new_index;
+		}
+
+	/////////////////////////////////////////////////////////////////////////////////////////
+	/// Returns the new position of each of the n old indices after deleting the ith one by
+	/// moving the last one in its place. The deleted index is mapped to -1.
+	/////////////////////////////////////////////////////////////////////////////////////////
+		inline std::vector<int> swap_removal(size_t const& n, size_t const& i) {
+			std::vector<int> new_index(n);
+			std::iota(new_index.begin(), new_index.end(), 0);
+			new_index[i] = -1;
+			if(i+1<n) {
+				new_index[n-1] = i;
+			}
+			return new_index;
+		}
 	};
 }
 
@@ -0,0 +1,83 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+
+#ifndef _PM_THREAD_POOL_H_
+#define _PM_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Nauticle {
+	/** This class implements a process-wide pool of persistent worker threads executing
+	//  index ranges. The range of a job is split evenly between the participants, then
+	//  each participant takes chunks of decreasing size (guided scheduling) from the front
+	//  of its own range. Participants running out of work steal the back half of the
+	//  largest remaining range, hence the load is balanced even if the cost of the
+	//  indices varies. The calling thread participates in the job. Nested jobs and jobs
+	//  submitted while the pool is busy are executed serially by the calling thread.
+	*/
+	class pmThread_pool {
+	public:
+		using Func_range = std::function<void(int const&, int const&)>;
+	private:
+		struct pmRange {
+			std::atomic<uint64_t> bounds{0};
+			char padding[64-sizeof(std::atomic<uint64_t>)];
+		};
+		std::vector<std::thread> worker;
+		std::unique_ptr<pmRange[]> range;
+		std::mutex job_mutex;
+		std::mutex mtx;
+		std::condition_variable start_condition;
+		std::condition_variable finish_condition;
+		Func_range const* job=nullptr;
+		int participants=0;
+		int grain=1;
+		size_t generation=0;
+		int running=0;
+		bool stop=false;
+	private:
+		pmThread_pool() {}
+		void work(int const id, size_t seen);
+		void participate(int const& id);
+		bool take(int const& id, int& start, int& end);
+		bool steal(int const& id);
+		static uint64_t pack(int const& start, int const& end);
+		static void unpack(uint64_t const& bounds, int& start, int& end);
+		void terminate();
+	public:
+		pmThread_pool(pmThread_pool const&)=delete;
+		pmThread_pool& operator=(pmThread_pool const&)=delete;
+		~pmThread_pool();
+		static pmThread_pool& instance();
+		void resize(size_t const& num_threads);
+		size_t get_number_of_threads() const;
+		void parallel_for(int const& begin, int const& end, size_t const& num_threads, Func_range const& func);
+	};
+}
+
+#endif //_PM_THREAD_POOL_H_
@@ -0,0 +1,321 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+
+#include "pmBarnes_hut.h"
+#include "pmParallel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace Nauticle;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Sorts the (key, index) pairs. The partitions of the threads are sorted separately
+/// and merged pairwise afterwards. Ties are broken by the index, hence the order does
+/// not depend on the number of threads.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmBarnes_hut::sort(size_t const& num_threads) {
+	int n = order.size();
+	int nt = std::max(1, std::min((int)num_threads, n));
+	int ppt = (n+nt-1)/nt; // bodies per thread
+	pmParallel::parallel_for(0, nt, nt, [&](int const& start, int const& end) {
+		for(int t=start; t<end; t++) {
+			std::sort(order.begin()+std::min(n, t*ppt), order.begin()+std::min(n, (t+1)*ppt));
+		}
+	});
+	std::vector<std::pair<uint64_t,int>> buffer(n);
+	for(int width=ppt; width<n; width*=2) {
+		int num_merges = (n+2*width-1)/(2*width);
+		pmParallel::parallel_for(0, num_merges, nt, [&](int const& start, int const& end) {
+			for(int m=start; m<end; m++) {
+				int first = m*2*width;
+				int middle = std::min(n, first+width);
+				int last = std::min(n, first+2*width);
+				std::merge(order.begin()+first, order.begin()+middle, order.begin()+middle, order.begin()+last, buffer.begin()+first);
+			}
+		});
+		order.swap(buffer);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Creates the children of the nth node recursively. Nodes holding at most limit bodies
+/// are not split but collected in deferred.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmBarnes_hut::subdivide(std::vector<pmNode>& nodes, int const& n, int const& limit, std::vector<int>& deferred) const {
+	pmNode node = nodes[n];
+	int size = node.end-node.begin;
+	if(size<=leaf_size || node.level==max_depth) {
+		leaf_moments(node);
+		nodes[n] = node;
+		return;
+	}
+	if(size<=limit) {
+		deferred.push_back(n);
+		return;
+	}
+	int shift = (max_depth-1-node.level)*dimensions;
+	uint64_t mask = (uint64_t{1}<<dimensions)-1;
+	node.first_child = nodes.size();
+	for(int b=node.begin; b<node.end;) {
+		uint64_t digit = (order[b].first>>shift)&mask;
+		int e = std::partition_point(order.begin()+b, order.begin()+node.end, [&](std::pair<uint64_t,int> const& it) {
+			return ((it.first>>shift)&mask)==digit;
+		}) - order.begin();
+		nodes.push_back(pmNode{b, e, node.level+1});
+		b = e;
+	}
+	node.num_children = nodes.size()-node.first_child;
+	nodes[n] = node;
+	for(int c=node.first_child; c<node.first_child+node.num_children; c++) {
+		subdivide(nodes, c, limit, deferred);
+	}
+	merge_moments(nodes, nodes[n]);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Calculates the moments of a leaf from its bodies.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmBarnes_hut::leaf_moments(pmNode& node) const {
+	double sum[3] = {0,0,0};
+	double unweighted[3] = {0,0,0};
+	node.mass = 0;
+	for(int b=node.begin; b<node.end; b++) {
+		node.mass += mass[b];
+		for(int d=0; d<3; d++) {
+			sum[d] += mass[b]*position[b*3+d];
+			unweighted[d] += position[b*3+d];
+		}
+	}
+	for(int d=0; d<3; d++) {
+		node.center[d] = node.mass>0 ? sum[d]/node.mass : unweighted[d]/(node.end-node.begin);
+	}
+	std::fill_n(node.quadrupole, 6, 0.0);
+	for(int b=node.begin; b<node.end; b++) {
+		double y[3] = {position[b*3]-node.center[0], position[b*3+1]-node.center[1], position[b*3+2]-node.center[2]};
+		double y2 = y[0]*y[0]+y[1]*y[1]+y[2]*y[2];
+		node.quadrupole[0] += mass[b]*(3*y[0]*y[0]-y2);
+		node.quadrupole[1] += mass[b]*(3*y[1]*y[1]-y2);
+		node.quadrupole[2] += mass[b]*(3*y[2]*y[2]-y2);
+		node.quadrupole[3] += mass[b]*3*y[0]*y[1];
+		node.quadrupole[4] += mass[b]*3*y[0]*y[2];
+		node.quadrupole[5] += mass[b]*3*y[1]*y[2];
+	}
+	node.complete = true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Calculates the moments of a node from its children if all of them are complete.
+/// The quadrupoles of the children are shifted to the center of mass of the node.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmBarnes_hut::merge_moments(std::vector<pmNode>& nodes, pmNode& node) const {
+	double sum[3] = {0,0,0};
+	double unweighted[3] = {0,0,0};
+	node.mass = 0;
+	for(int c=node.first_child; c<node.first_child+node.num_children; c++) {
+		if(!nodes[c].complete) { return; }
+		node.mass += nodes[c].mass;
+		for(int d=0; d<3; d++) {
+			sum[d] += nodes[c].mass*nodes[c].center[d];
+			unweighted[d] += nodes[c].center[d];
+		}
+	}
+	for(int d=0; d<3; d++) {
+		node.center[d] = node.mass>0 ? sum[d]/node.mass : unweighted[d]/node.num_children;
+	}
+	std::fill_n(node.quadrupole, 6, 0.0);
+	for(int c=node.first_child; c<node.first_child+node.num_children; c++) {
+		pmNode const& child = nodes[c];
+		double s[3] = {child.center[0]-node.center[0], child.center[1]-node.center[1], child.center[2]-node.center[2]};
+		double s2 = s[0]*s[0]+s[1]*s[1]+s[2]*s[2];
+		node.quadrupole[0] += child.quadrupole[0]+child.mass*(3*s[0]*s[0]-s2);
+		node.quadrupole[1] += child.quadrupole[1]+child.mass*(3*s[1]*s[1]-s2);
+		node.quadrupole[2] += child.quadrupole[2]+child.mass*(3*s[2]*s[2]-s2);
+		node.quadrupole[3] += child.quadrupole[3]+child.mass*3*s[0]*s[1];
+		node.quadrupole[4] += child.quadrupole[4]+child.mass*3*s[0]*s[2];
+		node.quadrupole[5] += child.quadrupole[5]+child.mass*3*s[1]*s[2];
+	}
+	node.complete = true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Completes the moments of the nodes above the subtrees built in parallel.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmBarnes_hut::finalize(int const& n) {
+	if(tree[n].complete) { return; }
+	for(int c=tree[n].first_child; c<tree[n].first_child+tree[n].num_children; c++) {
+		finalize(c);
+	}
+	merge_moments(tree, tree[n]);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Builds the tree of the bodies at the given positions. The position of the ith body
+/// starts at pos[i*stride] and has dims coordinates.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmBarnes_hut::build(double const* pos, int const& stride, int const& dims, std::vector<double> const& masses, size_t const& num_threads) {
+	int n = masses.size();
+	dimensions = std::max(1, std::min(dims, 3));
+	tree.clear();
+	order.resize(n);
+	position.resize(n*3);
+	mass.resize(n);
+	if(n==0) { return; }
+	int nt = std::max(1, std::min((int)num_threads, n));
+	// bounding box
+	double minimum[3] = {0,0,0};
+	double maximum[3] = {0,0,0};
+	for(int d=0; d<dimensions; d++) {
+		minimum[d] = maximum[d] = pos[d];
+	}
+	for(int i=0; i<n; i++) {
+		for(int d=0; d<dimensions; d++) {
+			minimum[d] = std::min(minimum[d], pos[i*stride+d]);
+			maximum[d] = std::max(maximum[d], pos[i*stride+d]);
+		}
+	}
+	extent = 0;
+	for(int d=0; d<3; d++) {
+		origin[d] = minimum[d];
+		extent = std::max(extent, maximum[d]-minimum[d]);
+	}
+	if(extent<=0) { extent = 1; }
+	// Morton keys
+	double scale = std::ldexp(1.0, max_depth)/extent;
+	uint32_t const max_cell = (uint32_t{1}<<max_depth)-1;
+	pmParallel::parallel_for(0, n, nt, [&](int const& start, int const& end) {
+		for(int i=start; i<end; i++) {
+			uint64_t key = 0;
+			for(int d=0; d<dimensions; d++) {
+				uint32_t q = std::min(max_cell, (uint32_t)((pos[i*stride+d]-origin[d])*scale));
+				for(int b=0; b<max_depth; b++) {
+					key |= (uint64_t)((q>>b)&1) << (b*dimensions+d);
+				}
+			}
+			order[i] = std::make_pair(key, i);
+		}
+	});
+	sort(num_threads);
+	pmParallel::parallel_for(0, n, nt, [&](int const& start, int const& end) {
+		for(int k=start; k<end; k++) {
+			int i = order[k].second;
+			for(int d=0; d<3; d++) {
+				position[k*3+d] = d<dimensions ? pos[i*stride+d] : 0.0;
+			}
+			mass[k] = masses[i];
+		}
+	});
+	// top of the tree
+	int limit = nt>1 ? std::max(leaf_size, n/(nt*8)) : 0;
+	std::vector<int> deferred;
+	tree.push_back(pmNode{0, n, 0});
+	subdivide(tree, 0, limit, deferred);
+	// subtrees
+	std::vector<std::vector<pmNode>> subtree(deferred.size());
+	pmParallel::parallel_for(0, deferred.size(), nt, [&](int const& start, int const& end) {
+		for(int s=start; s<end; s++) {
+			std::vector<int> unused;
+			subtree[s].push_back(tree[deferred[s]]);
+			subdivide(subtree[s], 0, 0, unused);
+		}
+	});
+	for(int s=0; s<deferred.size(); s++) {
+		int offset = (int)tree.size()-1;
+		for(auto& it:subtree[s]) {
+			if(it.num_children>0) {
+				it.first_child += offset;
+			}
+		}
+		tree[deferred[s]] = subtree[s][0];
+		tree.insert(tree.end(), subtree[s].begin()+1, subtree[s].end());
+	}
+	finalize(0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Calculates the acceleration at the point x. The body with the original index self is
+/// excluded. Coincident bodies are skipped.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmBarnes_hut::accelerate(double const* x, int const& self, double const& theta, double* acceleration) const {
+	acceleration[0] = acceleration[1] = acceleration[2] = 0;
+	if(tree.empty()) { return; }
+	double x3[3] = {x[0], dimensions>1 ? x[1] : 0.0, dimensions>2 ? x[2] : 0.0};
+	double theta2 = theta*theta;
+	int stack[max_depth*8+1];
+	int top = 0;
+	stack[top++] = 0;
+	while(top>0) {
+		pmNode const& node = tree[stack[--top]];
+		if(node.num_children==0) {
+			for(int b=node.begin; b<node.end; b++) {
+				if(order[b].second==self) { continue; }
+				double r[3] = {position[b*3]-x3[0], position[b*3+1]-x3[1], position[b*3+2]-x3[2]};
+				double r2 = r[0]*r[0]+r[1]*r[1]+r[2]*r[2];
+				if(r2==0) { continue; }
+				double f = mass[b]/(r2*std::sqrt(r2));
+				for(int d=0; d<3; d++) {
+					acceleration[d] += f*r[d];
+				}
+			}
+			continue;
+		}
+		double r[3] = {x3[0]-node.center[0], x3[1]-node.center[1], x3[2]-node.center[2]};
+		double r2 = r[0]*r[0]+r[1]*r[1]+r[2]*r[2];
+		double size = std::ldexp(extent, -node.level);
+		if(size*size < theta2*r2) {
+			double const* Q = node.quadrupole;
+			double Qr[3] = {Q[0]*r[0]+Q[3]*r[1]+Q[4]*r[2], Q[3]*r[0]+Q[1]*r[1]+Q[5]*r[2], Q[4]*r[0]+Q[5]*r[1]+Q[2]*r[2]};
+			double rQr = r[0]*Qr[0]+r[1]*Qr[1]+r[2]*Qr[2];
+			double inv_r2 = 1.0/r2;
+			double inv_r3 = inv_r2/std::sqrt(r2);
+			double inv_r5 = inv_r3*inv_r2;
+			for(int d=0; d<3; d++) {
+				acceleration[d] += -node.mass*inv_r3*r[d] + inv_r5*Qr[d] - 2.5*rQr*inv_r5*inv_r2*r[d];
+			}
+		} else {
+			for(int c=node.first_child+node.num_children-1; c>=node.first_child; c--) {
+				stack[top++] = c;
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Calculates the acceleration of all bodies in parallel. The result of the ith body is
+/// stored at acceleration[i*3].
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmBarnes_hut::compute(double const& theta, size_t const& num_threads, std::vector<double>& acceleration) const {
+	int n = order.size();
+	acceleration.resize(n*3);
+	pmParallel::parallel_for(0, n, num_threads, [&](int const& start, int const& end) {
+		for(int k=start; k<end; k++) {
+			int i = order[k].second;
+			accelerate(&position[k*3], i, theta, &acceleration[i*3]);
+		}
+	});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the number of nodes in the tree.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmBarnes_hut::get_number_of_nodes() const {
+	return tree.size();
+}
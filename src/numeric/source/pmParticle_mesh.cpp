@@ -0,0 +1,340 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+
+#include "pmParticle_mesh.h"
+#include "pmParallel.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace Nauticle;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the smallest power of two not less than n.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmParticle_mesh::next_power_of_two(int const& n) {
+	int p = 1;
+	while(p<n) {
+		p *= 2;
+	}
+	return p;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Sets the periodic grid spanning the box of the given size from minimum.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_mesh::set_grid(double const* minimum, double const* size, int const* num_cells, int const& dims) {
+	dimensions = std::max(1, std::min(dims, 3));
+	grid_size = 1;
+	for(int d=0; d<3; d++) {
+		cells[d] = d<dimensions ? next_power_of_two(std::max(1, num_cells[d])) : 1;
+		origin[d] = d<dimensions ? minimum[d] : 0.0;
+		spacing[d] = d<dimensions ? size[d]/cells[d] : 1.0;
+		grid_size *= cells[d];
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Sets the order of the mass assignment (NGP, CIC or TSC).
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_mesh::set_order(int const& o) {
+	order = std::max((int)NGP, std::min(o, (int)TSC));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Sets the radius splitting the short- and long-range forces. Zero turns off splitting.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_mesh::set_split(double const& rs) {
+	split = rs;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the split radius.
+/////////////////////////////////////////////////////////////////////////////////////////
+double pmParticle_mesh::get_split() const {
+	return split;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the fraction of the pairwise 1/r^(D-1) force at distance r missing from the
+/// filtered mesh force.
+/////////////////////////////////////////////////////////////////////////////////////////
+double pmParticle_mesh::short_range(double const& r) const {
+	if(split<=0) { return 0; }
+	double x = r/(2*split);
+	switch(dimensions) {
+		case 1: return std::erfc(x);
+		case 2: return std::exp(-x*x);
+		default: return std::erfc(x) + 2*x/std::sqrt(M_PI)*std::exp(-x*x);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Calculates the first grid point and the weights of each particle in every direction.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_mesh::assign_weights(double const* pos, int const& stride, int const& n, size_t const& num_threads) {
+	first.resize(n*3);
+	weight.resize(n*3*order);
+	pmParallel::parallel_for(0, n, num_threads, [&](int const& start, int const& end) {
+		for(int i=start; i<end; i++) {
+			for(int d=0; d<3; d++) {
+				double* w = &weight[(i*3+d)*order];
+				std::fill_n(w, order, 0.0);
+				if(d>=dimensions) {
+					first[i*3+d] = 0;
+					w[0] = 1;
+					continue;
+				}
+				double u = (pos[i*stride+d]-origin[d])/spacing[d];
+				u -= std::floor(u/cells[d])*cells[d];
+				int b;
+				if(order==NGP) {
+					b = (int)std::round(u);
+					w[0] = 1;
+				} else if(order==CIC) {
+					b = (int)std::floor(u);
+					double t = u-b;
+					w[0] = 1-t;
+					w[1] = t;
+				} else {
+					int c = (int)std::round(u);
+					double t = u-c;
+					b = c-1;
+					w[0] = 0.5*(0.5-t)*(0.5-t);
+					w[1] = 0.75-t*t;
+					w[2] = 0.5*(0.5+t)*(0.5+t);
+				}
+				first[i*3+d] = ((b%cells[d])+cells[d])%cells[d];
+			}
+		}
+	});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Sorts the particles into buckets by their first grid point (counting sort). The grid
+/// points and the weights are stored in the sorted order for the sake of locality.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_mesh::sort_particles(int const& n) {
+	bucket_start.assign(grid_size+1, 0);
+	bucket_idx.resize(n);
+	auto key = [&](int const& i) {
+		return first[i*3] + (size_t)cells[0]*(first[i*3+1] + (size_t)cells[1]*first[i*3+2]);
+	};
+	for(int i=0; i<n; i++) {
+		bucket_start[key(i)+1]++;
+	}
+	for(size_t g=0; g<grid_size; g++) {
+		bucket_start[g+1] += bucket_start[g];
+	}
+	std::vector<int> fill(bucket_start.begin(), bucket_start.end()-1);
+	for(int i=0; i<n; i++) {
+		bucket_idx[fill[key(i)]++] = i;
+	}
+	std::vector<int> unsorted_first = first;
+	std::vector<double> unsorted_weight = weight;
+	for(int c=0; c<n; c++) {
+		int i = bucket_idx[c];
+		std::copy_n(&unsorted_first[i*3], 3, &first[c*3]);
+		std::copy_n(&unsorted_weight[i*3*order], 3*order, &weight[c*3*order]);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Calculates the density at the grid points by gathering the weighted masses of the
+/// particles whose stencil covers the grid point.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_mesh::deposit(std::vector<double> const& mass, size_t const& num_threads) {
+	int span[3];
+	double volume = 1;
+	for(int d=0; d<3; d++) {
+		span[d] = d<dimensions ? order : 1;
+		volume *= d<dimensions ? spacing[d] : 1.0;
+	}
+	std::vector<double> sorted_mass(mass.size());
+	pmParallel::parallel_for(0, mass.size(), num_threads, [&](int const& start, int const& end) {
+		for(int c=start; c<end; c++) {
+			sorted_mass[c] = mass[bucket_idx[c]];
+		}
+	});
+	density.resize(grid_size);
+	pmParallel::parallel_for(0, grid_size, num_threads, [&](int const& start, int const& end) {
+		for(int g=start; g<end; g++) {
+			int gx = g%cells[0];
+			int gy = (g/cells[0])%cells[1];
+			int gz = g/cells[0]/cells[1];
+			double sum = 0;
+			for(int oz=0; oz<span[2]; oz++) {
+				int bz = gz-oz<0 ? gz-oz+cells[2] : gz-oz;
+				for(int oy=0; oy<span[1]; oy++) {
+					int by = gy-oy<0 ? gy-oy+cells[1] : gy-oy;
+					for(int ox=0; ox<span[0]; ox++) {
+						int bx = gx-ox<0 ? gx-ox+cells[0] : gx-ox;
+						size_t b = bx + (size_t)cells[0]*(by + (size_t)cells[1]*bz);
+						for(int c=bucket_start[b]; c<bucket_start[b+1]; c++) {
+							sum += sorted_mass[c]*weight[(c*3)*order+ox]*weight[(c*3+1)*order+oy]*weight[(c*3+2)*order+oz];
+						}
+					}
+				}
+			}
+			density[g] = sum/volume;
+		}
+	});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Interpolates the given component of the acceleration from the grid (stored in the
+/// real part of work) to the particles.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_mesh::interpolate(int const& n, int const& direction, size_t const& num_threads, std::vector<double>& acceleration) const {
+	int span[3];
+	for(int d=0; d<3; d++) {
+		span[d] = d<dimensions ? order : 1;
+	}
+	pmParallel::parallel_for(0, n, num_threads, [&](int const& start, int const& end) {
+		for(int c=start; c<end; c++) {
+			double sum = 0;
+			for(int oz=0; oz<span[2]; oz++) {
+				int gz = first[c*3+2]+oz<cells[2] ? first[c*3+2]+oz : first[c*3+2]+oz-cells[2];
+				for(int oy=0; oy<span[1]; oy++) {
+					int gy = first[c*3+1]+oy<cells[1] ? first[c*3+1]+oy : first[c*3+1]+oy-cells[1];
+					double wyz = weight[(c*3+1)*order+oy]*weight[(c*3+2)*order+oz];
+					for(int ox=0; ox<span[0]; ox++) {
+						int gx = first[c*3]+ox<cells[0] ? first[c*3]+ox : first[c*3]+ox-cells[0];
+						sum += weight[(c*3)*order+ox]*wyz*work[gx + (size_t)cells[0]*(gy + (size_t)cells[1]*gz)].real();
+					}
+				}
+			}
+			acceleration[bucket_idx[c]*3+direction] = sum;
+		}
+	});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// In-place radix-2 FFT of n complex values. The inverse is not normalized.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_mesh::fft(std::complex<double>* line, int const& n, bool const& inverse) {
+	for(int i=1, j=0; i<n; i++) {
+		int bit = n>>1;
+		for(; j&bit; bit>>=1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if(i<j) {
+			std::swap(line[i], line[j]);
+		}
+	}
+	for(int length=2; length<=n; length<<=1) {
+		double angle = (inverse ? 2 : -2)*M_PI/length;
+		std::complex<double> root{std::cos(angle), std::sin(angle)};
+		for(int i=0; i<n; i+=length) {
+			std::complex<double> w{1,0};
+			for(int k=0; k<length/2; k++) {
+				std::complex<double> u = line[i+k];
+				std::complex<double> v = line[i+k+length/2]*w;
+				line[i+k] = u+v;
+				line[i+k+length/2] = u-v;
+				w *= root;
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Multidimensional FFT of the grid data. The lines of each direction are transformed
+/// in parallel.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_mesh::transform(std::vector<std::complex<double>>& data, bool const& inverse, size_t const& num_threads) const {
+	size_t stride = 1;
+	for(int d=0; d<dimensions; d++) {
+		int n = cells[d];
+		int num_lines = grid_size/n;
+		pmParallel::parallel_for(0, num_lines, num_threads, [&](int const& start, int const& end) {
+			std::vector<std::complex<double>> line(n);
+			for(int l=start; l<end; l++) {
+				size_t base = l%stride + (l/stride)*stride*n;
+				for(int k=0; k<n; k++) {
+					line[k] = data[base+k*stride];
+				}
+				fft(line.data(), n, inverse);
+				for(int k=0; k<n; k++) {
+					data[base+k*stride] = line[k];
+				}
+			}
+		});
+		stride *= n;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Calculates the accelerations of the particles due to the masses with the interaction
+/// coefficient coef (positive means attraction). The result of the ith particle is
+/// stored at acceleration[i*3]. The assignment window is deconvolved in Fourier space.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmParticle_mesh::compute(double const* pos, int const& stride, std::vector<double> const& mass, double const& coef, size_t const& num_threads, std::vector<double>& acceleration) {
+	int n = mass.size();
+	acceleration.assign(n*3, 0.0);
+	if(n==0 || dimensions==0) { return; }
+	assign_weights(pos, stride, n, num_threads);
+	sort_particles(n);
+	deposit(mass, num_threads);
+	transform(density, false, num_threads);
+	// Poisson equation: laplace(phi) = S_D*coef*rho, where S_D is the surface of the unit sphere
+	double surface = dimensions==1 ? 2.0 : (dimensions==2 ? 2.0*M_PI : 4.0*M_PI);
+	pmParallel::parallel_for(0, grid_size, num_threads, [&](int const& start, int const& end) {
+		for(int g=start; g<end; g++) {
+			int index[3] = {g%cells[0], (g/cells[0])%cells[1], g/cells[0]/cells[1]};
+			double k2 = 0;
+			double window = 1;
+			for(int d=0; d<dimensions; d++) {
+				int m = index[d]<cells[d]/2 ? index[d] : index[d]-cells[d];
+				double k = 2*M_PI*m/(cells[d]*spacing[d]);
+				double x = 0.5*k*spacing[d];
+				double sinc = x==0 ? 1.0 : std::sin(x)/x;
+				k2 += k*k;
+				window *= std::pow(sinc, order);
+			}
+			if(k2==0) {
+				density[g] = 0;
+			} else {
+				density[g] *= -surface*coef/k2*std::exp(-k2*split*split)/(window*window);
+			}
+		}
+	});
+	// acceleration = -grad(phi)
+	for(int direction=0; direction<dimensions; direction++) {
+		work.resize(grid_size);
+		pmParallel::parallel_for(0, grid_size, num_threads, [&](int const& start, int const& end) {
+			for(int g=start; g<end; g++) {
+				int index = (g/(direction==0 ? 1 : (direction==1 ? cells[0] : cells[0]*cells[1])))%cells[direction];
+				int m = index<cells[direction]/2 ? index : index-cells[direction];
+				if(2*m==-cells[direction]) { m = 0; }
+				double k = 2*M_PI*m/(cells[direction]*spacing[direction]);
+				work[g] = std::complex<double>{0,-k}*density[g];
+			}
+		});
+		transform(work, true, num_threads);
+		pmParallel::parallel_for(0, grid_size, num_threads, [&](int const& start, int const& end) {
+			for(int g=start; g<end; g++) {
+				work[g] /= (double)grid_size;
+			}
+		});
+		interpolate(n, direction, num_threads, acceleration);
+	}
+}
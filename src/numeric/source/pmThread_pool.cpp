@@ -0,0 +1,225 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+
+#include "pmThread_pool.h"
+#include <algorithm>
+
+using namespace Nauticle;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// True on the worker threads and on the thread executing a job. Jobs submitted from
+/// these threads are executed serially.
+/////////////////////////////////////////////////////////////////////////////////////////
+static thread_local bool inside_job = false;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the process-wide pool.
+/////////////////////////////////////////////////////////////////////////////////////////
+pmThread_pool& pmThread_pool::instance() {
+	static pmThread_pool pool;
+	return pool;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Destructor. Stops the workers.
+/////////////////////////////////////////////////////////////////////////////////////////
+pmThread_pool::~pmThread_pool() {
+	terminate();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Stops and joins the workers.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmThread_pool::terminate() {
+	{
+		std::lock_guard<std::mutex> lock{mtx};
+		stop = true;
+	}
+	start_condition.notify_all();
+	for(auto& it:worker) {
+		it.join();
+	}
+	worker.clear();
+	stop = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Sets the number of threads including the calling thread. Workers are started once
+/// and reused by all the subsequent jobs.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmThread_pool::resize(size_t const& num_threads) {
+	if(inside_job) { return; }
+	std::lock_guard<std::mutex> job_lock{job_mutex};
+	size_t n = std::max((size_t)1, num_threads);
+	if(n==worker.size()+1 && range) { return; }
+	terminate();
+	range.reset(new pmRange[n]);
+	for(int id=1; id<n; id++) {
+		worker.push_back(std::thread{&pmThread_pool::work, this, id, generation});
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the number of threads including the calling thread.
+/////////////////////////////////////////////////////////////////////////////////////////
+size_t pmThread_pool::get_number_of_threads() const {
+	return worker.size()+1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Packs the bounds of a range into a single word.
+/////////////////////////////////////////////////////////////////////////////////////////
+uint64_t pmThread_pool::pack(int const& start, int const& end) {
+	return ((uint64_t)(uint32_t)start<<32) | (uint64_t)(uint32_t)end;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Unpacks the bounds of a range.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmThread_pool::unpack(uint64_t const& bounds, int& start, int& end) {
+	start = (int)(uint32_t)(bounds>>32);
+	end = (int)(uint32_t)bounds;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Takes the next chunk from the front of the own range of participant id. The chunk
+/// size is a quarter of the remaining range but at least the grain size.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmThread_pool::take(int const& id, int& start, int& end) {
+	uint64_t bounds = range[id].bounds.load();
+	while(true) {
+		int s, e;
+		unpack(bounds, s, e);
+		if(s>=e) { return false; }
+		int chunk = std::max(grain, (e-s)/4);
+		int ns = std::min(e, s+chunk);
+		if(range[id].bounds.compare_exchange_weak(bounds, pack(ns,e))) {
+			start = s;
+			end = ns;
+			return true;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Moves the back half of the largest remaining range of the other participants to
+/// participant id. Returns false if there is nothing left to steal.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmThread_pool::steal(int const& id) {
+	while(true) {
+		int victim = -1;
+		int largest = 0;
+		for(int t=0; t<participants; t++) {
+			if(t==id) { continue; }
+			int s, e;
+			unpack(range[t].bounds.load(), s, e);
+			if(e-s>largest) {
+				largest = e-s;
+				victim = t;
+			}
+		}
+		if(victim<0) { return false; }
+		uint64_t bounds = range[victim].bounds.load();
+		int s, e;
+		unpack(bounds, s, e);
+		if(e<=s) { continue; }
+		int half = (e-s+1)/2;
+		if(range[victim].bounds.compare_exchange_strong(bounds, pack(s,e-half))) {
+			range[id].bounds.store(pack(e-half,e));
+			return true;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Executes chunks of the current job until all ranges are exhausted.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmThread_pool::participate(int const& id) {
+	int start, end;
+	do {
+		while(take(id, start, end)) {
+			(*job)(start, end);
+		}
+	} while(steal(id));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Main loop of the workers. Each worker waits for a new job and participates if its
+/// id is lower than the number of participants.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmThread_pool::work(int const id, size_t seen) {
+	inside_job = true;
+	std::unique_lock<std::mutex> lock{mtx};
+	while(true) {
+		start_condition.wait(lock, [&](){ return stop || generation!=seen; });
+		if(stop) { return; }
+		seen = generation;
+		if(id>=participants) { continue; }
+		lock.unlock();
+		participate(id);
+		lock.lock();
+		running--;
+		if(running==0) {
+			finish_condition.notify_all();
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Calls func(start,end) for chunks covering the [begin,end) range using at most
+/// num_threads threads. Returns when all the chunks are processed.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmThread_pool::parallel_for(int const& begin, int const& end, size_t const& num_threads, Func_range const& func) {
+	int size = end-begin;
+	if(size<=0) { return; }
+	if(inside_job || num_threads<2 || size<2) {
+		func(begin, end);
+		return;
+	}
+	if(num_threads>get_number_of_threads()) {
+		resize(num_threads);
+	}
+	std::unique_lock<std::mutex> job_lock{job_mutex, std::try_to_lock};
+	if(!job_lock.owns_lock()) {
+		func(begin, end);
+		return;
+	}
+	int n = std::min({(int)num_threads, (int)get_number_of_threads(), size});
+	int ppt = (size+n-1)/n; // items per participant
+	for(int t=0; t<n; t++) {
+		range[t].bounds.store(pack(begin+std::min(size,t*ppt), begin+std::min(size,(t+1)*ppt)));
+	}
+	{
+		std::lock_guard<std::mutex> lock{mtx};
+		job = &func;
+		participants = n;
+		grain = std::max(1, size/(n*64));
+		running = n-1;
+		generation++;
+	}
+	start_condition.notify_all();
+	inside_job = true;
+	participate(0);
+	inside_job = false;
+	std::unique_lock<std::mutex> lock{mtx};
+	finish_condition.wait(lock, [&](){ return running==0; });
+	job = nullptr;
+}
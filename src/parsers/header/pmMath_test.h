@@ -30,7 +30,7 @@ namespace Nauticle {
 	protected:
 		std::string const one_op_minus = "#";
 		// list of functions and operators
-		static std::string const list_of_functions[95];
+		static std::string const list_of_functions[100];
 		static std::string const list_of_operators[];
 	protected:
 		virtual ~pmMath_test()=default;
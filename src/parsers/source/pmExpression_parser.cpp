@@ -230,6 +230,10 @@ void pmExpression_parser::stack_extract(std::stack<std::shared_ptr<pmExpression>
 /////////////////////////////////////////////////////////////////////////////////////////
 std::shared_ptr<pmExpression> pmExpression_parser::build_expression_tree(std::vector<std::string> const& postfix, std::shared_ptr<pmWorkspace> workspace/*=std::make_shared<pmWorkspace>()*/) {
 	std::stack<std::shared_ptr<pmExpression>> e;
+	std::shared_ptr<pmField> id;
+	if(workspace.use_count()>0) {
+		id = std::dynamic_pointer_cast<pmField>(workspace->get_instance("id", false).lock());
+	}
 	for(auto const& it : postfix) {
 		if(is_word(it)) {
 			if(workspace.use_count()>0) {
@@ -284,12 +288,22 @@ std::shared_ptr<pmExpression> pmExpression_parser::build_expression_tree(std::ve
 				stack_extract(e, operands);
 				e.push(std::make_shared<pmArithmetic_function<CROSS,2>>(operands));
 			}
-			using nbody = pmNbody_operator;
-			ADD_INTERACTION(2, nbody, "pmNbody_operator")
+			using nbody = pmNbody_operator<DIRECT,2>;
+			ADD_INTERACTION(2, nbody, "pmNbody_operator<DIRECT,2>")
+			using nbody_bh = pmNbody_operator<BARNES_HUT,3>;
+			ADD_INTERACTION(3, nbody_bh, "pmNbody_operator<BARNES_HUT,3>")
+			using nbody_pm = pmNbody_operator<PARTICLE_MESH,2>;
+			ADD_INTERACTION(2, nbody_pm, "pmNbody_operator<PARTICLE_MESH,2>")
+			using nbody_p3m = pmNbody_operator<P3M,2>;
+			ADD_INTERACTION(2, nbody_p3m, "pmNbody_operator<P3M,2>")
 			using dem_l = pmDem_operator<LINEAR,7>;
 			ADD_INTERACTION(7, dem_l, "pmDem_operator<LINEAR,7>")
 			using dem_a = pmDem_operator<ANGULAR,7>;
 			ADD_INTERACTION(7, dem_a, "pmDem_operator<ANGULAR,7>")
+			using dem_lh = pmDem_operator<LINEAR,8>;
+			ADD_INTERACTION(8, dem_lh, "pmDem_operator<LINEAR,8>")
+			using dem_ah = pmDem_operator<ANGULAR,8>;
+			ADD_INTERACTION(8, dem_ah, "pmDem_operator<ANGULAR,8>")
 			using sph_X = pmSph_operator<XSAMPLE,0,0,5>;
 			ADD_INTERACTION(5, sph_X, "pmSph_operator<XSAMPLE,0,0,5>")
 			using sph_S = pmSph_operator<SAMPLE,0,0,5>;
@@ -607,22 +621,30 @@ std::shared_ptr<pmExpression> pmExpression_parser::build_expression_tree(std::ve
 			if(it=="rand") {
 				std::array<std::shared_ptr<pmExpression>,2> operands;
 				stack_extract(e, operands);
-				e.push(std::make_shared<pmArithmetic_function<URAND,2>>(operands));
+				auto random = std::make_shared<pmArithmetic_function<URAND,2>>(operands);
+				random->set_id(id);
+				e.push(random);
 			}
 			if(it=="urand") {
 				std::array<std::shared_ptr<pmExpression>,2> operands;
 				stack_extract(e, operands);
-				e.push(std::make_shared<pmArithmetic_function<URAND,2>>(operands));
+				auto random = std::make_shared<pmArithmetic_function<URAND,2>>(operands);
+				random->set_id(id);
+				e.push(random);
 			}
 			if(it=="nrand") {
 				std::array<std::shared_ptr<pmExpression>,2> operands;
 				stack_extract(e, operands);
-				e.push(std::make_shared<pmArithmetic_function<NRAND,2>>(operands));
+				auto random = std::make_shared<pmArithmetic_function<NRAND,2>>(operands);
+				random->set_id(id);
+				e.push(random);
 			}
 			if(it=="lnrand") {
 				std::array<std::shared_ptr<pmExpression>,2> operands;
 				stack_extract(e, operands);
-				e.push(std::make_shared<pmArithmetic_function<LNRAND,2>>(operands));
+				auto random = std::make_shared<pmArithmetic_function<LNRAND,2>>(operands);
+				random->set_id(id);
+				e.push(random);
 			}
 			if(it=="and") {
 				std::array<std::shared_ptr<pmExpression>,2> operands;
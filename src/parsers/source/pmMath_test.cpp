@@ -22,7 +22,7 @@
 
 using namespace Nauticle;
 
-std::string const pmMath_test::list_of_functions[95] = {"abs", "acos", "acot", "and", "asin", "atan", "atan2", "cos", "cosh", "cot", "coth", "dem_l", "dem_a", "div", "elem", "exp", "floor", "fmax", "fmean", "fmin", "fsum", "grad", "gt", "gte", "if", "log", "logm", "lt", "lte", "magnitude", "deQ", "deR", "max", "min", "mod", "not", "or", "rand", "urand", "nrand", "lnrand", "sgn", "sin", "sinh", "sph_D00", "sph_D01", "sph_D10", "sph_D11", "sph_D", "sph_G00", "sph_G01", "sph_G10", "sph_G11", "sph_G", "sph_L0", "sph_L1", "sph_L2", "sph_S", "sph_X", "sph_I", "sph_T", "sph_A", "sph_A0", "sph_A1", "dvm", "sqrt", "tan", "tanh", "trace", "eigsys", "eigval", "transpose", "trunc", "xor", "identity", "neighbors", "nbody", "cross", "inverse", "determinant", "eq", "neq", "euler", "predictor", "corrector", "sfm", "verlet_r", "verlet_v", "limit", "md", "kuramoto", "collision_handler", "occlusion", "spring", "hysteron"};
+std::string const pmMath_test::list_of_functions[100] = {"abs", "acos", "acot", "and", "asin", "atan", "atan2", "cos", "cosh", "cot", "coth", "dem_l", "dem_a", "dem_lh", "dem_ah", "div", "elem", "exp", "floor", "fmax", "fmean", "fmin", "fsum", "grad", "gt", "gte", "if", "log", "logm", "lt", "lte", "magnitude", "deQ", "deR", "max", "min", "mod", "not", "or", "rand", "urand", "nrand", "lnrand", "sgn", "sin", "sinh", "sph_D00", "sph_D01", "sph_D10", "sph_D11", "sph_D", "sph_G00", "sph_G01", "sph_G10", "sph_G11", "sph_G", "sph_L0", "sph_L1", "sph_L2", "sph_S", "sph_X", "sph_I", "sph_T", "sph_A", "sph_A0", "sph_A1", "dvm", "sqrt", "tan", "tanh", "trace", "eigsys", "eigval", "transpose", "trunc", "xor", "identity", "neighbors", "nbody", "nbody_bh", "nbody_pm", "nbody_p3m", "cross", "inverse", "determinant", "eq", "neq", "euler", "predictor", "corrector", "sfm", "verlet_r", "verlet_v", "limit", "md", "kuramoto", "collision_handler", "occlusion", "spring", "hysteron"};
 std::string const pmMath_test::list_of_operators[] = {	"+", "-", "*", "/", "^", "#", ":", "%"};
 
 /////////////////////////////////////////////////////////////////////////////////////////
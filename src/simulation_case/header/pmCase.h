@@ -51,6 +51,9 @@ namespace Nauticle {
 		std::vector<std::shared_ptr<pmTime_series>> time_series;
 		std::shared_ptr<pmRigid_body_system> rbsys;
 		std::vector<std::shared_ptr<pmOutput>> output;
+		bool fused_interactions=true;
+	private:
+		void fuse_interactions(size_t const& first, size_t const& num_threads);
 	public:
 		pmCase() {}
 		pmCase(pmCase const& other);
@@ -82,6 +85,8 @@ namespace Nauticle {
 		void add_rigid_body_system(std::shared_ptr<pmRigid_body_system> rbs);
 		void add_output(std::shared_ptr<pmOutput> outp);
 		void initialize();
+		void set_bytecode(bool const& use);
+		void set_fused_interactions(bool const& fuse);
 	};
 }
 
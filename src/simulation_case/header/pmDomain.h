@@ -23,6 +23,8 @@
 
 #include "pmTensor.h"
 #include <vector>
+#include <array>
+#include <cstdint>
 
 namespace Nauticle {
 	/** This class represents the domain in which a particle system can be
@@ -36,14 +38,30 @@ namespace Nauticle {
 		pmTensor cell_size;
 		pmTensor boundary;
 	protected:
+		bool sparse_grid=false;
 		std::vector<pmTensor> cell_iterator;
-		std::vector<int> cidx;
+		std::vector<int> cell_start;
+		std::vector<int> cell_count;
+		std::vector<int64_t> cell_keys;
+		std::vector<int> stencil_offset;
+		std::vector<int> grid_cells;
+		std::vector<int64_t> cell_stride;
+		std::vector<std::vector<int>> neighbor_index;
+		std::vector<std::vector<int>> neighbor_image;
+		std::vector<std::array<double,3>> image_scale;
+		std::vector<std::array<double,3>> image_shift;
+		std::vector<pmTensor> image_guide;
+		std::vector<char> image_mirrored;
 	protected:
 		double flatten(pmTensor const& cells, pmTensor const& grid_pos, size_t i) const;
-		void combinations_recursive(std::vector<int> const& elems, size_t comb_len, std::vector<size_t> &pos, size_t depth);
-		void combinations(std::vector<int> const& elems, size_t comb_len);
-		int hash_key(pmTensor const& grid_pos) const;
+		void combinations_recursive(std::vector<int> const& elems, size_t comb_len, std::vector<size_t> &pos, size_t depth, std::vector<pmTensor>& comb);
+		void combinations(std::vector<int> const& elems, size_t comb_len, std::vector<pmTensor>& comb);
+		int64_t hash_key(pmTensor const& grid_pos) const;
+		int64_t cell_key(pmTensor const& point) const;
+		uint64_t morton_key(pmTensor const& grid_pos) const;
 		void build_cell_iterator();
+		void build_stencil();
+		int grid_index(double const& x, int const& k) const;
 	public:
 		pmDomain()=default;
 		pmDomain(pmTensor const& dmin, pmTensor const& dmax, pmTensor const& csize, pmTensor const& bnd);
@@ -63,6 +81,8 @@ namespace Nauticle {
 		void set_maximum(pmTensor const& mx);
 		void set_cell_size(pmTensor const& csize);
 		void set_boundary(pmTensor const& bnd);
+		void set_sparse_grid(bool const& sp);
+		bool is_sparse_grid() const;
 		pmTensor grid_coordinates(pmTensor const& point) const;
 		virtual void printv() const;
 	};
@@ -26,10 +26,12 @@
 #include <vector>
 #include <memory>
 #include <thread>
+#include <atomic>
 #include <cmath>
 #include <sstream>
 #include "prolog/pLogger.h"
 #include "pmExpression.h"
+#include "pmBytecode.h"
 #include "pmWorkspace.h"
 
 namespace Nauticle {
@@ -39,6 +41,9 @@ namespace Nauticle {
 	//  When a pmEquation object is destroyed the lhs and rhs pmExpression-s are destroyed
 	//  as well except if they are pmVariable or pmConstant objects. They are always managed
 	//  by the pmWorkspace object. (TODO: std::shared_ptr) 
+	//  If the rhs or the condition reads the lhs at other nodes (e.g. through an interaction),
+	//  the results are written into a scratch buffer and copied to the lhs after all nodes
+	//  are evaluated, hence the solution does not depend on the number of threads.
 	*/
 	class pmEquation final {
 	protected:
@@ -47,6 +52,19 @@ namespace Nauticle {
 		std::shared_ptr<pmExpression> rhs;
 		std::shared_ptr<pmExpression> condition;
 		bool rhs_interaction;
+		std::shared_ptr<pmBytecode> bytecode;
+		int rhs_register=-1;
+		int condition_register=-1;
+		pmBytecode::Kernel kernel=nullptr;
+		std::atomic<bool> bytecode_failed{false};
+		bool double_buffered=false;
+		int buffer_rows=0;
+		int buffer_columns=0;
+		std::vector<double> buffer;
+		std::vector<char> written;
+	private:
+		void set_result(pmTensor const& value, int const& i);
+		void apply_buffer(int const& start, int const& end);
 	public:
 		pmEquation(std::string n, std::shared_ptr<pmSymbol> ex1, std::shared_ptr<pmExpression> ex2, std::shared_ptr<pmExpression> cond);
 		pmEquation(pmEquation const&);
@@ -71,6 +89,12 @@ namespace Nauticle {
 		void set_rhs(std::shared_ptr<pmExpression> right);
 		void set_condition(std::shared_ptr<pmExpression> cond);
 		bool const& is_interaction() const;
+		bool set_bytecode(bool const& use, bool const& interactions=false);
+		bool is_bytecode() const;
+		bool is_double_buffered() const;
+		bool generate_code(std::ostream& os, std::string const& function_name) const;
+		void set_kernel(pmBytecode::Kernel k);
+		void join_sweep(pmSph_sweep& sweep) const;
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////////////
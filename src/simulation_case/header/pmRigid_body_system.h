@@ -41,6 +41,7 @@ namespace Nauticle {
 		void initialize(std::string const& fn, std::shared_ptr<pmParticle_system> ps, std::shared_ptr<pmExpression> force, std::shared_ptr<pmSymbol> velocity, std::shared_ptr<pmField> rmatrix, std::shared_ptr<pmField> imatrix, std::shared_ptr<pmSymbol> mass, std::shared_ptr<pmExpression> ptheta, std::shared_ptr<pmField> rid);
         void print() const;
         void update(double const& time_step);
+        void reorder(std::vector<int> const& order);
 	};
 }
 
@@ -0,0 +1,58 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+
+#ifndef _PM_RUNTIME_COMPILER_H_
+#define _PM_RUNTIME_COMPILER_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "prolog/pLogger.h"
+#include "pmEquation.h"
+
+namespace Nauticle {
+	/** This class translates the equations of a case into C++ source code, compiles it
+	//  with the system compiler (CXX environment variable or c++) into a shared object
+	//  and loads the kernels into the equations. Shared objects are cached in the
+	//  binary_case directory keyed by the hash of the generated source, hence a case
+	//  is compiled only once. The interactions are lowered as well, SPH operators are
+	//  generated as neighbour sums. Equations which cannot be lowered into bytecode keep
+	//  their former evaluation mode.
+	*/
+	class pmRuntime_compiler {
+	private:
+		std::string directory = "binary_case";
+		std::string compiler = "c++";
+		std::string flags = "-O3 -ffp-contract=off -shared -fPIC";
+		void* handle = nullptr;
+		std::vector<std::shared_ptr<pmEquation>> compiled;
+		std::vector<bool> was_bytecode;
+	public:
+		pmRuntime_compiler();
+		pmRuntime_compiler(pmRuntime_compiler const&)=delete;
+		pmRuntime_compiler& operator=(pmRuntime_compiler const&)=delete;
+		~pmRuntime_compiler();
+		bool compile(std::vector<std::shared_ptr<pmEquation>> const& equations);
+		void release();
+	};
+}
+
+#endif //_PM_RUNTIME_COMPILER_H_
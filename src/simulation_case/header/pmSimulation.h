@@ -31,6 +31,7 @@
 #include "pmVTK_writer.h"
 #include "pmParameter_space.h"
 #include "pmScript.h"
+#include "pmRuntime_compiler.h"
 
 namespace Nauticle {
 	/** This class represents the problem to solve. The contructor recieves the file
@@ -49,6 +50,7 @@ namespace Nauticle {
 		std::shared_ptr<pmCase> cas;
 		std::shared_ptr<pmParameter_space> parameter_space;
 		std::vector<std::shared_ptr<pmScript>> script;
+		std::shared_ptr<pmRuntime_compiler> runtime_compiler;
 		write_mode vtk_write_mode = ASCII;
 		void print() const;
 		void simulate(size_t const& num_threads);
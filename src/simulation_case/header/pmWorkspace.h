@@ -46,6 +46,14 @@ namespace Nauticle {
 		size_t num_variables;
 		std::vector<std::shared_ptr<pmExpression>> interactions;
 		std::shared_ptr<pmVariable> num_particles;
+		struct pmRecorded_value {
+			std::shared_ptr<pmField> field;
+			pmTensor value;
+			size_t index;
+		};
+		std::vector<size_t> birth_parent;
+		std::vector<pmRecorded_value> recorded_value;
+		std::vector<size_t> death;
 	private:
 		bool verify_name(std::string const& name) const;
 		bool is_constant(std::shared_ptr<pmSymbol> term) const;
@@ -70,7 +78,9 @@ namespace Nauticle {
 		std::shared_ptr<pmParticle_system> get_particle_system() const;
 		template <typename T> void print_content(std::string const& title) const;
 		void print() const;
-		bool update();
+		bool update(size_t const& num_threads=1);
+		bool sort_particles(std::vector<int>& order);
+		void advance_time_levels();
 		std::vector<std::shared_ptr<pmSymbol>> get_definitions();
 		std::shared_ptr<pmWorkspace> clone() const;
 		size_t get_number_of_nodes() const;
@@ -85,6 +95,10 @@ namespace Nauticle {
 		void delete_particle(size_t const& i);
 		void delete_particle_set(std::vector<size_t> const& delete_indices);
 		void duplicate_particle(size_t const& i);
+		size_t record_birth(size_t const& parent);
+		void record_value(std::shared_ptr<pmField> const& field, pmTensor const& value, size_t const& i);
+		void record_death(size_t const& i);
+		void commit_particles(size_t const& num_threads=1);
 		bool number_of_particles_changed() const;
 		size_t get_dimensions() const;
 	};
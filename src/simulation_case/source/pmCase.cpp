@@ -19,6 +19,7 @@
 */
 
 #include "pmCase.h"
+#include "pmSph_sweep.h"
 
 using namespace Nauticle;
 using namespace ProLog;
@@ -174,23 +175,38 @@ std::vector<std::shared_ptr<pmBackground>> const& pmCase::get_background() const
 /// Solves the equation with the given name or all equations in order if name is empty.
 /////////////////////////////////////////////////////////////////////////////////////////
 bool pmCase::solve(double const& current_time, size_t const& num_threads, std::string const& name/*=""*/) {
+	if(name=="") {
+		workspace->advance_time_levels();
+	}
 	this->update_particle_modifiers(num_threads);
 	this->update_background_fields(workspace->get_instance("dt").lock()->evaluate(0)[0]);
 	this->update_time_series_variables(current_time);
 	this->update_rigid_bodies(workspace->get_instance("dt").lock()->evaluate(0)[0]);
-	bool success = workspace->update();
+	bool success = workspace->update(num_threads);
 	if(!success) {
 		return false;
 	}
+	std::vector<int> order;
+	if(workspace->sort_particles(order)) {
+		if(rbsys.use_count()>0) {
+			rbsys->reorder(order);
+		}
+		success = workspace->update(num_threads);
+		if(!success) { return false; }
+	}
 	if(name=="") {
-		for(auto const& it:equations) {
+		for(size_t e=0; e<equations.size(); e++) {
+			auto const& it = equations[e];
 			if(it->is_interaction()) {
-				success = workspace->update();
+				success = workspace->update(num_threads);
 				if(!success) { return false; }
+				if(fused_interactions) {
+					this->fuse_interactions(e, num_threads);
+				}
 			}
 			it->solve(num_threads);
 			if(it->get_lhs()->get_name()=="r") {
-				success = workspace->update();
+				success = workspace->update(num_threads);
 				if(!success) { return false; }
 			}
 		}
@@ -198,7 +214,7 @@ bool pmCase::solve(double const& current_time, size_t const& num_threads, std::s
 		for(auto const& it:equations) {
 			if(it->get_name()==name) {
 				if(it->is_interaction() && it->get_lhs()->get_name()=="r") {
-					workspace->update();
+					workspace->update(num_threads);
 				}
 				it->solve(num_threads);
 			}
@@ -209,6 +225,23 @@ bool pmCase::solve(double const& current_time, size_t const& num_threads, std::s
 	return true;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Evaluates the SPH operators of the equations from the first one onwards in a single
+/// neighbour sweep. An operator is included only if its operands are not overwritten by
+/// the equations preceding it, hence the results do not change. The results are kept by
+/// the operators until their equations are solved.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmCase::fuse_interactions(size_t const& first, size_t const& num_threads) {
+	pmSph_sweep sweep;
+	for(size_t e=first; e<equations.size(); e++) {
+		equations[e]->join_sweep(sweep);
+		sweep.add_written(equations[e]->get_lhs()->get_name());
+	}
+	if(sweep.get_number_of_members()>1) {
+		sweep.execute(num_threads);
+	}
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Assigns the particle system of the workspace to all equations.
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -241,7 +274,7 @@ void pmCase::merge(std::shared_ptr<pmCase> const& other) {
 /// Updates particle splitters and mergers.
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmCase::update_particle_modifiers(size_t const& num_threads) {
-	workspace->update();
+	workspace->update(num_threads);
 	for(auto& it:particle_modifier) {
 		it->update(num_threads);
 	}
@@ -308,4 +341,26 @@ void pmCase::add_time_series(std::shared_ptr<pmTime_series> ts) {
 
 void pmCase::add_rigid_body_system(std::shared_ptr<pmRigid_body_system> rbs) {
 	rbsys = rbs;
-}
\ No newline at end of file
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Switches the bytecode evaluation of the equations on or off.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmCase::set_bytecode(bool const& use) {
+	int compiled = 0;
+	for(auto const& it:equations) {
+		if(it->set_bytecode(use)) {
+			compiled++;
+		}
+	}
+	if(use) {
+		pLogger::logf<LCY>("  %i of %i equations are evaluated through bytecode.\n", compiled, (int)equations.size());
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Switches the common neighbour sweep of the independent SPH operators on or off.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmCase::set_fused_interactions(bool const& fuse) {
+	fused_interactions = fuse;
+}
@@ -109,29 +109,40 @@ void pmDomain::set_boundary(pmTensor const& bnd) {
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Generates the component of the cell_iterator.
+/// Turns on/off the sparse cell grid. A sparse grid stores the occupied cells only.
 /////////////////////////////////////////////////////////////////////////////////////////
-void pmDomain::combinations_recursive(std::vector<int> const& elems, size_t comb_len, std::vector<size_t> &pos, size_t depth) {
+void pmDomain::set_sparse_grid(bool const& sp) {
+	sparse_grid = sp;
+}
+
+bool pmDomain::is_sparse_grid() const {
+	return sparse_grid;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Generates the components of a cell stencil.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmDomain::combinations_recursive(std::vector<int> const& elems, size_t comb_len, std::vector<size_t> &pos, size_t depth, std::vector<pmTensor>& comb) {
 	if(depth>=comb_len) {
 		pmTensor tensor = minimum;
 		for (size_t i = 0; i < pos.size(); ++i) {
 			tensor[i] = elems[pos[i]];
 		}
-		cell_iterator.push_back(tensor);
+		comb.push_back(tensor);
 		return;
 	}
 	for(size_t i=0;i<elems.size();i++) {
 		pos[depth] = i;
-		combinations_recursive(elems, comb_len, pos, depth + 1);
+		combinations_recursive(elems, comb_len, pos, depth + 1, comb);
 	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
-/// Generates the cell_iterator.
+/// Generates a cell stencil from the given cell offsets.
 /////////////////////////////////////////////////////////////////////////////////////////
-void pmDomain::combinations(std::vector<int> const& elems, size_t comb_len) {
+void pmDomain::combinations(std::vector<int> const& elems, size_t comb_len, std::vector<pmTensor>& comb) {
 	std::vector<size_t> positions(comb_len, 0);
-	combinations_recursive(elems, comb_len, positions, 0);
+	combinations_recursive(elems, comb_len, positions, 0, comb);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -140,7 +151,93 @@ void pmDomain::combinations(std::vector<int> const& elems, size_t comb_len) {
 void pmDomain::build_cell_iterator() {
 	if(!cell_iterator.empty()) { return; }
 	std::vector<int> elements = {-1, 0, 1};
-	combinations(elements, this->get_dimensions());
+	combinations(elements, this->get_dimensions(), cell_iterator);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Precomputes the integer stencil of the neighbour cell traversal:
+///  - stencil_offset: integer offsets of the cells in the cell iterator,
+///  - neighbor_index: wrapped grid coordinate of the (grid coordinate, offset) pairs in
+///    each dimension (-1 if the neighbour is cut off),
+///  - neighbor_image: image code (delta+1) of the neighbour in each dimension,
+///  - image_scale and image_shift: per-dimension transformation of the neighbour position
+///    for each image (periodic shift or symmetric reflection),
+///  - image_guide: guide tensors for all combinations of the per-dimension images,
+///  - image_mirrored: true for the images reflected in any symmetric direction.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmDomain::build_stencil() {
+	this->build_cell_iterator();
+	int dimensions = this->get_dimensions();
+	stencil_offset.resize(cell_iterator.size()*dimensions);
+	for(int s=0; s<cell_iterator.size(); s++) {
+		for(int k=0; k<dimensions; k++) {
+			stencil_offset[s*dimensions+k] = std::round(cell_iterator[s][k]);
+		}
+	}
+	grid_cells.resize(dimensions);
+	cell_stride.resize(dimensions);
+	neighbor_index.resize(dimensions);
+	neighbor_image.resize(dimensions);
+	image_scale.resize(dimensions);
+	image_shift.resize(dimensions);
+	pmTensor physical_minimum = this->get_physical_minimum();
+	pmTensor physical_maximum = this->get_physical_maximum();
+	pmTensor physical_size = this->get_physical_size();
+	int64_t stride = 1;
+	for(int k=0; k<dimensions; k++) {
+		int cells = std::round(maximum[k]-minimum[k]);
+		grid_cells[k] = cells;
+		cell_stride[k] = stride;
+		stride *= cells;
+		neighbor_index[k].resize(3*cells);
+		neighbor_image[k].resize(3*cells);
+		for(int g=0; g<cells; g++) {
+			for(int o=-1; o<=1; o++) {
+				int idx = 3*g+o+1;
+				int g_j = g+o;
+				int delta = g_j<0 ? 1 : (g_j>=cells ? -1 : 0);
+				neighbor_image[k][idx] = delta+1;
+				if(delta==0) {
+					neighbor_index[k][idx] = g_j;
+				} else if(boundary[k]==0) {
+					neighbor_index[k][idx] = g_j+delta*cells;
+				} else if(boundary[k]==1) {
+					neighbor_index[k][idx] = delta>0 ? -1-g_j : 2*cells-1-g_j;
+				} else {
+					neighbor_index[k][idx] = -1;
+				}
+			}
+		}
+		for(int d=0; d<3; d++) {
+			int delta = d-1;
+			if(boundary[k]==1 && delta!=0) {
+				image_scale[k][d] = -1.0;
+				image_shift[k][d] = delta>0 ? 2.0*physical_minimum[k] : 2.0*physical_maximum[k];
+			} else {
+				image_scale[k][d] = 1.0;
+				image_shift[k][d] = boundary[k]==0 ? -delta*physical_size[k] : 0.0;
+			}
+		}
+	}
+	image_guide.resize(cell_iterator.size());
+	image_mirrored.resize(cell_iterator.size());
+	for(int s=0; s<cell_iterator.size(); s++) {
+		image_guide[s] = cell_iterator[s];
+		image_mirrored[s] = false;
+		for(int k=0; k<dimensions; k++) {
+			image_guide[s][k] *= boundary[k]==1;
+			if(image_guide[s][k]!=0) {
+				image_mirrored[s] = true;
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the grid coordinate of x in the kth dimension.
+/////////////////////////////////////////////////////////////////////////////////////////
+int pmDomain::grid_index(double const& x, int const& k) const {
+	return std::round(std::floor(x/cell_size[k])-minimum[k]);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -154,10 +251,46 @@ double pmDomain::flatten(pmTensor const& cells, pmTensor const& grid_pos, size_t
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Returns hash key for the given grid cell.
 /////////////////////////////////////////////////////////////////////////////////////////
-int pmDomain::hash_key(pmTensor const& grid_pos) const {
+int64_t pmDomain::hash_key(pmTensor const& grid_pos) const {
 	return flatten(maximum-minimum, grid_pos, 0);
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the hash key of the cell containing the given point using integer arithmetics.
+/// The key is identical to hash_key(grid_coordinates(point)). Returns -1 if the point is
+/// outside the domain.
+/////////////////////////////////////////////////////////////////////////////////////////
+int64_t pmDomain::cell_key(pmTensor const& point) const {
+	int64_t key = 0;
+	int64_t stride = 1;
+	for(int k=0; k<cell_size.numel(); k++) {
+		int cells = std::round(maximum[k]-minimum[k]);
+		int grid_pos = std::round(std::floor(point[k]/cell_size[k])-minimum[k]);
+		if(grid_pos<0 || grid_pos>=cells) {
+			return -1;
+		}
+		key += grid_pos*stride;
+		stride *= cells;
+	}
+	return key;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns the Morton (Z-order) key of the given grid cell. Cells close in space get close
+/// keys, hence ordering particles by this key improves memory locality.
+/////////////////////////////////////////////////////////////////////////////////////////
+uint64_t pmDomain::morton_key(pmTensor const& grid_pos) const {
+	size_t dimensions = this->get_dimensions();
+	uint64_t key = 0;
+	for(size_t bit=0; bit<64/dimensions; bit++) {
+		for(size_t k=0; k<dimensions; k++) {
+			uint64_t crd = grid_pos[k]<0 ? 0 : (uint64_t)grid_pos[k];
+			key |= ((crd>>bit)&1ull) << (bit*dimensions+k);
+		}
+	}
+	return key;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Returns the grid coordingate of point.
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -19,7 +19,7 @@
 */
     
 #include "pmEquation.h"
-#include <thread>
+#include "pmParallel.h"
 #include <algorithm>
 
 using namespace Nauticle;
@@ -56,6 +56,8 @@ pmEquation& pmEquation::operator=(pmEquation const& other) {
 		rhs = other.rhs->clone();
 		condition = other.condition->clone();
 		this->rhs_interaction = other.rhs_interaction;
+		bytecode.reset();
+		kernel = nullptr;
 	}
 	return *this;
 }
@@ -81,6 +83,8 @@ pmEquation& pmEquation::operator=(pmEquation&& other) {
 		rhs = std::move(other.rhs);
 		condition = other.condition->clone();
 		this->rhs_interaction = std::move(other.rhs_interaction);
+		bytecode.reset();
+		kernel = nullptr;
 	}
 	return *this;
 }
@@ -113,21 +117,88 @@ void pmEquation::print() const {
 
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Solves equation for all nodes included in the field inside the variables of the rhs.
+/// If the equation is lowered into bytecode, it is executed in blocks of nodes or through
+/// the runtime compiled kernel. The arrays of the kernel are kept by each thread and
+/// reused by the consecutive calls. If an interaction does not match its compiled shape,
+/// the rest of the range is interpreted and the bytecode is dropped by solve.
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmEquation::evaluate(int const& start, int const& end) {
 	int p_end = end>lhs->get_field_size() ? lhs->get_field_size() : end;
-	for(int i=start; i<p_end; i++) {
+	int interpreted = start;
+	if(kernel!=nullptr && !bytecode_failed) {
+		static thread_local pmBytecode::pmRun_memory memory;
+		int numel = bytecode->get_numel(rhs_register);
+		if(bytecode->run(kernel, start, p_end, rhs_register, memory)) {
+			for(int i=start; i<p_end; i++) {
+				if(memory.condition[i-start]) {
+					set_result(bytecode->make_tensor(rhs_register, &memory.value[(size_t)(i-start)*numel]), i);
+				}
+			}
+			return;
+		}
+		bytecode_failed = true;
+	}
+	if(bytecode.use_count()>0 && !bytecode_failed) {
+		std::vector<double> memory(bytecode->get_memory_size());
+		for(; interpreted<p_end; interpreted+=pmBytecode::block_size) {
+			int n = std::min(pmBytecode::block_size, p_end-interpreted);
+			if(!bytecode->execute(interpreted, n, memory)) {
+				bytecode_failed = true;
+				break;
+			}
+			for(int p=0; p<n; p++) {
+				if(bytecode->get_tensor(memory, condition_register, p)[0]) {
+					set_result(bytecode->get_tensor(memory, rhs_register, p), interpreted+p);
+				}
+			}
+		}
+		if(interpreted>=p_end) { return; }
+	}
+	for(int i=interpreted; i<p_end; i++) {
 		if(condition->evaluate(i, 0)[0]) {
 			pmTensor tensor = rhs->evaluate(i, 0);
 			if(tensor.numel()==0) {
-				lhs->set_value(lhs->get_value(i)*0.0, i);
+				set_result(lhs->get_value(i)*0.0, i);
 			} else {
-				lhs->set_value(tensor, i);
+				set_result(tensor, i);
 			}
 		}
 	}
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Writes the result of the ith node to the lhs or to the scratch buffer.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmEquation::set_result(pmTensor const& value, int const& i) {
+	if(!double_buffered) {
+		lhs->set_value(value, i);
+		return;
+	}
+	int numel = buffer_rows*buffer_columns;
+	if(value.numel()!=numel) {
+		ProLog::pLogger::error_msgf("Inconsistent tensor sizes in equation %s\n", name.c_str());
+	}
+	for(int e=0; e<numel; e++) {
+		buffer[(size_t)i*numel+e] = value[e];
+	}
+	written[i] = 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Copies the buffered results of the nodes in the given range to the lhs.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmEquation::apply_buffer(int const& start, int const& end) {
+	int numel = buffer_rows*buffer_columns;
+	for(int i=start; i<end; i++) {
+		if(!written[i]) { continue; }
+		pmTensor value{buffer_rows, buffer_columns};
+		for(int e=0; e<numel; e++) {
+			value[e] = buffer[(size_t)i*numel+e];
+		}
+		lhs->set_value(value, i);
+	}
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Solves equation for all nodes included in the field inside the variables of the rhs.
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -137,18 +208,42 @@ void pmEquation::solve(size_t const& num_threads) {
 	}
 	int p_end = lhs->get_field_size();
 
+	rhs->precompute(num_threads);
+	condition->precompute(num_threads);
+	double_buffered = p_end>1 && is_double_buffered();
+	if(double_buffered) {
+		pmTensor shape = lhs->evaluate(0);
+		buffer_rows = shape.get_numrows();
+		buffer_columns = shape.get_numcols();
+		buffer.resize((size_t)p_end*shape.numel());
+		written.assign(p_end, 0);
+	}
 	auto process = [&](int const& start, int const& end){
 		this->evaluate(start, end);
 	};
-	std::vector<std::thread> th;
-	int number_of_threads = std::min((int)num_threads,p_end);
-	int ppt = p_end/number_of_threads; // particle per thread
-	for(int i=0; i<p_end; i+=ppt) {
-		th.push_back(std::thread{process, i, i+ppt});
+	pmParallel::parallel_for(0, p_end, num_threads, process);
+	if(bytecode_failed) {
+		ProLog::pLogger::warning_msgf("The shape of an interaction differs from its compiled shape in equation %s. The equation is interpreted.\n", name.c_str());
+		bytecode.reset();
+		kernel = nullptr;
+		bytecode_failed = false;
 	}
-	for(auto& it:th) {
-		it.join();
+	if(double_buffered) {
+		pmParallel::parallel_for(0, p_end, num_threads, [&](int const& start, int const& end){
+			this->apply_buffer(start, end);
+		});
+		double_buffered = false;
 	}
+	rhs->release_precomputed();
+	condition->release_precomputed();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns true if the rhs or the condition reads the lhs at other nodes, i.e. the
+/// equation is solved through the scratch buffer.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmEquation::is_double_buffered() const {
+	return rhs->is_reading_neighbors(lhs->get_name()) || condition->is_reading_neighbors(lhs->get_name());
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -220,6 +315,8 @@ void pmEquation::set_lhs(std::shared_ptr<pmSymbol> left) {
 void pmEquation::set_rhs(std::shared_ptr<pmExpression> right) {
 	rhs = right;
 	rhs_interaction = rhs->is_interaction();
+	bytecode.reset();
+	kernel = nullptr;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -227,23 +324,63 @@ void pmEquation::set_rhs(std::shared_ptr<pmExpression> right) {
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmEquation::set_condition(std::shared_ptr<pmExpression> cond) {
 	condition = cond;
+	bytecode.reset();
+	kernel = nullptr;
 }
 
 bool const& pmEquation::is_interaction() const {
 	return rhs_interaction;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Offers the SPH operators of the rhs and the condition to the given sweep. Equations
+/// lowered into bytecode (with or without a compiled kernel) sum up their neighbours
+/// themselves, hence they do not join.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmEquation::join_sweep(pmSph_sweep& sweep) const {
+	if(is_bytecode()) { return; }
+	rhs->join_sweep(sweep);
+	condition->join_sweep(sweep);
+}
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Lowers the rhs and the condition into bytecode if use is true. Interactions are lowered
+/// only if interactions is true, otherwise equations containing them remain interpreted,
+/// as well as the ones containing functions which cannot be lowered. Returns true if the
+/// equation is evaluated through bytecode.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmEquation::set_bytecode(bool const& use, bool const& interactions/*=false*/) {
+	bytecode.reset();
+	kernel = nullptr;
+	if(!use || (rhs_interaction && !interactions)) { return false; }
+	std::shared_ptr<pmBytecode> code = std::make_shared<pmBytecode>(interactions);
+	rhs_register = rhs->compile(*code);
+	condition_register = condition->compile(*code);
+	if(rhs_register<0 || condition_register<0) { return false; }
+	bytecode = code;
+	return true;
+}
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Returns true if the equation is evaluated through bytecode.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmEquation::is_bytecode() const {
+	return bytecode.use_count()>0;
+}
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Writes the C++ kernel of the equation with the given name to the stream. Returns false
+/// if the equation is not lowered into bytecode.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmEquation::generate_code(std::ostream& os, std::string const& function_name) const {
+	if(bytecode.use_count()==0) { return false; }
+	bytecode->generate_code(os, function_name, rhs_register, condition_register);
+	return true;
+}
 
-
-
-
-
-
-
-
-
-
-
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Sets the compiled kernel generated by generate_code. It requires the bytecode to be present.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmEquation::set_kernel(pmBytecode::Kernel k) {
+	kernel = bytecode.use_count()>0 ? k : nullptr;
+}
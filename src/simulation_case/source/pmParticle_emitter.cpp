@@ -55,16 +55,17 @@ void pmParticle_emitter::print() const {
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmParticle_emitter::update(size_t const& num_threads) {
 	std::vector<pmTensor> positions = grid->get_merged_grid()->get_grid();
+	std::shared_ptr<pmParticle_system> ps = workspace->get_particle_system();
 	for(auto const& jt:positions) {
 		if(condition->evaluate(0)[0]) {
-			workspace->duplicate_particle(0);
-			size_t num_particles = workspace->get_number_of_nodes();
-			workspace->get_particle_system()->set_value(jt,num_particles-1);
+			size_t idx = workspace->record_birth(0);
+			workspace->record_value(ps,jt,idx);
 			for(auto const& it:initializer) {
-				it.field->set_value(it.expression->evaluate(0),num_particles-1);
+				workspace->record_value(it.field,it.expression->evaluate(0),idx);
 			}
 		}
 	}
+	workspace->commit_particles(num_threads);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
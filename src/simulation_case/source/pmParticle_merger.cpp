@@ -139,11 +139,10 @@ pmTensor pmParticle_merger::pmNearest_neighbor::evaluate(int const& i, size_t co
 void pmParticle_merger::update(size_t const& num_threads) {
     std::tuple<std::vector<size_t>,std::vector<size_t>,std::vector<size_t>> tuples;
     this->make_tuples(tuples, this->get_candidates());
-    std::shared_ptr<pmParticle_system> ps = workspace->get<pmParticle_system>()[0];
+    std::shared_ptr<pmParticle_system> ps = workspace->get_particle_system();
     int dims = ps->get_dimensions();
     pmKernel W;
     W.set_kernel_type(dims==2?16:17, false);
-    std::vector<size_t> delete_indices;
     for(int i=0; i<std::get<0>(tuples).size(); i++) {
         size_t const id0 = std::get<0>(tuples)[i];
         size_t const id1 = std::get<1>(tuples)[i];
@@ -247,22 +246,21 @@ void pmParticle_merger::update(size_t const& num_threads) {
                 vel_2 += tangential_vel*cross(G/G.norm(),direction3D);
             }
         }
-        workspace->duplicate_particle(id1);
-        workspace->duplicate_particle(id1);
-        size_t num_nodes = workspace->get_number_of_nodes();
-        mass->set_value(mass_M,num_nodes-1);
-        mass->set_value(mass_M,num_nodes-2);
-        radius->set_value(hM,num_nodes-1);
-        radius->set_value(hM,num_nodes-2);
-        ps->set_value(pos_a,num_nodes-1);
-        ps->set_value(pos_b,num_nodes-2);
-        velocity->set_value(vel_1,num_nodes-1);
-        velocity->set_value(vel_2,num_nodes-2);
-        delete_indices.push_back(id0);
-        delete_indices.push_back(id1);
-        delete_indices.push_back(id2);
+        size_t idx_b = workspace->record_birth(id1);
+        size_t idx_a = workspace->record_birth(id1);
+        workspace->record_value(mass,mass_M,idx_a);
+        workspace->record_value(mass,mass_M,idx_b);
+        workspace->record_value(radius,hM,idx_a);
+        workspace->record_value(radius,hM,idx_b);
+        workspace->record_value(ps,pos_a,idx_a);
+        workspace->record_value(ps,pos_b,idx_b);
+        workspace->record_value(velocity,vel_1,idx_a);
+        workspace->record_value(velocity,vel_2,idx_b);
+        workspace->record_death(id0);
+        workspace->record_death(id1);
+        workspace->record_death(id2);
     }
-    workspace->delete_particle_set(delete_indices);
+    workspace->commit_particles(num_threads);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
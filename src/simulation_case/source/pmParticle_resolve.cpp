@@ -19,6 +19,7 @@
 */
 
 #include "pmParticle_resolve.h"
+#include "pmThread_pool.h"
 
 using namespace Nauticle;
 
@@ -27,11 +28,13 @@ using namespace Nauticle;
 /////////////////////////////////////////////////////////////////////////////////////////
 std::vector<size_t> pmParticle_resolve::get_candidates() const {
 	std::vector<size_t> indices;
+    condition->precompute(pmThread_pool::instance().get_number_of_threads());
     for(int i=0; i<workspace->get_number_of_nodes(); i++) {
         if(condition->evaluate(i,0)[0]) {
             indices.push_back(i);
         }
     }
+    condition->release_precomputed();
     return indices;
 }
 
@@ -21,8 +21,7 @@
 #include "pmParticle_sink.h"
 #include <vtkSmartPointer.h>
 #include <vtkUnstructuredGrid.h>
-#include <thread>
-#include <mutex>
+#include "pmParallel.h"
 
 using namespace Nauticle;
 using namespace ProLog;
@@ -45,26 +44,20 @@ void pmParticle_sink::print() const {
 /// Reads input if not read yet, and performs interpolation.
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmParticle_sink::update(size_t const& num_threads) {
-	std::mutex mtx;
 	int p_end = workspace->get_number_of_nodes();
+	std::vector<char> marked(p_end, 0);
+	condition->precompute(num_threads);
+	pmParallel::parallel_for(0, p_end, num_threads, [&](int const& start, int const& end){
+		for(int i=start; i<end; i++) {
+			marked[i] = (bool)condition->evaluate(i)[0];
+		}
+	});
+	condition->release_precomputed();
 	std::vector<size_t> del;
-	auto process = [&](int const& start, int const& end){
-		for(size_t i=start; i<end; i++) {
-			if(condition->evaluate(i)[0]) {
-				mtx.lock();
-				del.push_back(i);
-				mtx.unlock();
-			}
+	for(int i=0; i<p_end; i++) {
+		if(marked[i]) {
+			del.push_back(i);
 		}
-	};
-	std::vector<std::thread> th;
-	int number_of_threads = std::min((int)num_threads,p_end);
-	int ppt = p_end/number_of_threads; // particle per thread
-	for(int i=0; i<p_end; i+=ppt) {
-		th.push_back(std::thread{process, i, i+ppt<p_end?i+ppt:p_end});
-	}
-	for(auto& it:th) {
-		it.join();
 	}
 	workspace->delete_particle_set(del);
 }
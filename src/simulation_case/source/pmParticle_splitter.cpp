@@ -28,8 +28,7 @@ using namespace Nauticle;
 /////////////////////////////////////////////////////////////////////////////////////////
 void pmParticle_splitter::update(size_t const& num_threads) {
     std::vector<size_t> candidates = this->get_candidates();
-    std::vector<size_t> delete_indices;
-    std::shared_ptr<pmParticle_system> ps = workspace->get<pmParticle_system>()[0];
+    std::shared_ptr<pmParticle_system> ps = workspace->get_particle_system();
     int dims = ps->get_dimensions();
     for(auto const& it:candidates) {
         double alpha = smoothing_ratio->evaluate(it,0)[0];
@@ -37,29 +36,27 @@ void pmParticle_splitter::update(size_t const& num_threads) {
         bool generate_at_parent = (bool)parent->evaluate(it,0)[0];
         double R_original = radius->evaluate(it,0)[0];
         double m_original = mass->evaluate(it,0)[0];
+        pmTensor pos_original = ps->evaluate(it,0);
         size_t num_daughters = (dims==3?(size_t)daughters->evaluate(it,0)[0]:((size_t)daughters->evaluate(it,0)[0]-(generate_at_parent?1:0)));
         if(passive.use_count()!=0) {
             if(generate_at_parent) {
-                workspace->duplicate_particle(it);
-                size_t num_nodes = workspace->get_number_of_nodes();
-                radius->set_value(alpha*R_original,num_nodes-1);
-                mass->set_value(m_original/(num_daughters+1),num_nodes-1);
+                size_t idx = workspace->record_birth(it);
+                workspace->record_value(radius,alpha*R_original,idx);
+                workspace->record_value(mass,m_original/(num_daughters+1),idx);
             }
         } else {
             if(generate_at_parent) {
                 radius->set_value(alpha*R_original,it);
                 mass->set_value(m_original/(num_daughters+1),it);
             } else {
-                delete_indices.push_back(it);
+                workspace->record_death(it);
             }
         }
         double step = 2.0*NAUTICLE_PI/num_daughters;
         pmTensor angle = rotation->evaluate(it,0);
         for(int i=0; i<num_daughters; i++) {
-            workspace->duplicate_particle(it);
-            size_t num_nodes = workspace->get_number_of_nodes();
-            std::shared_ptr<pmParticle_system> ps = workspace->get<pmParticle_system>()[0];
-            pmTensor new_pos = ps->evaluate(num_nodes-1,0);
+            size_t idx = workspace->record_birth(it);
+            pmTensor new_pos = pos_original;
             if(dims==3) {
                 new_pos[0] += R_original/std::sqrt(2.0)*epsilon*std::sin(i*step+angle[0]);
                 new_pos[1] += R_original/std::sqrt(2.0)*epsilon*std::cos(i*step+angle[0]);
@@ -68,18 +65,18 @@ void pmParticle_splitter::update(size_t const& num_threads) {
                 new_pos[1] += R_original*epsilon*std::sin(i*step+angle[0]);
                 new_pos[0] += R_original*epsilon*std::cos(i*step+angle[0]);
             }
-            ps->set_value(new_pos,num_nodes-1);
-            radius->set_value(alpha*R_original,num_nodes-1);
-            mass->set_value(m_original/(num_daughters+(generate_at_parent?1:0)),num_nodes-1);
+            workspace->record_value(ps,new_pos,idx);
+            workspace->record_value(radius,alpha*R_original,idx);
+            workspace->record_value(mass,m_original/(num_daughters+(generate_at_parent?1:0)),idx);
             if(active.use_count()!=0) {
-                active->set_value(1,num_nodes-1);
+                workspace->record_value(active,1,idx);
             }
         }
         if(passive.use_count()!=0) {
-            passive->set_value(1.0,it);
+            workspace->record_value(passive,1.0,it);
         }
     }
-    workspace->delete_particle_set(delete_indices);
+    workspace->commit_particles(num_threads);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
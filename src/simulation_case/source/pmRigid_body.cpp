@@ -41,6 +41,12 @@ void pmRigid_body::remove_particle(size_t const& idx) {
 	}
 }
 
+void pmRigid_body::renumber(std::vector<int> const& new_index) {
+	for(auto& it:particle_idx) {
+		it = new_index[it];
+	}
+}
+
 void pmRigid_body::initialize(std::shared_ptr<pmParticle_system> psys, std::shared_ptr<pmSymbol> particle_velocity, std::shared_ptr<pmField> rid) {
 	for(int i=0; i<particle_idx.size(); i++) {
 		linear_velocity += particle_velocity->evaluate(particle_idx[i]);
@@ -101,5 +101,12 @@ void pmRigid_body_system::update(double const& time_step) {
     }
 }
 
+void pmRigid_body_system::reorder(std::vector<int> const& order) {
+    std::vector<int> new_index = pmSort::inverse(order);
+    for(auto& it:rigid_body) {
+        it->renumber(new_index);
+    }
+}
+
 #include "Color_undefine.h"
 
@@ -0,0 +1,148 @@
+/*
+    Copyright 2016-2020 Balazs Havasi-Toth
+    This file is part of Nauticle.
+
+    Nauticle is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Nauticle is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Nauticle.  If not, see <http://www.gnu.org/licenses/>.
+
+    For more information please visit: https://bitbucket.org/nauticleproject/
+*/
+
+
+#include "pmRuntime_compiler.h"
+#include <sstream>
+#include <fstream>
+#include <functional>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <dlfcn.h>
+
+using namespace Nauticle;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Constructor. The compiler given in the CXX environment variable is used if set.
+/////////////////////////////////////////////////////////////////////////////////////////
+pmRuntime_compiler::pmRuntime_compiler() {
+	char const* cxx = std::getenv("CXX");
+	if(cxx!=nullptr && std::string{cxx}!="") {
+		compiler = cxx;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Destructor.
+/////////////////////////////////////////////////////////////////////////////////////////
+pmRuntime_compiler::~pmRuntime_compiler() {
+	release();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Detaches the kernels from the equations, restores their former evaluation mode and
+/// unloads the shared object.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmRuntime_compiler::release() {
+	for(int k=0; k<compiled.size(); k++) {
+		compiled[k]->set_bytecode(was_bytecode[k]);
+	}
+	compiled.clear();
+	was_bytecode.clear();
+	if(handle!=nullptr) {
+		dlclose(handle);
+		handle = nullptr;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Generates, compiles and loads the kernels of the given equations. The equations are
+/// lowered together with their interactions. Only the equations bound to a kernel are
+/// switched, the others keep their former evaluation mode. Returns false if the
+/// compilation or loading fails. In that case all equations keep their former mode.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmRuntime_compiler::compile(std::vector<std::shared_ptr<pmEquation>> const& equations) {
+	release();
+	std::ostringstream source;
+	source << "// Generated by Nauticle from the equations of the case.\n";
+	source << "#include <cmath>\n#include <cstddef>\n#include <algorithm>\n#include <limits>\n\n";
+	std::vector<std::string> name;
+	std::vector<std::shared_ptr<pmEquation>> candidate;
+	std::vector<bool> previous;
+	for(int k=0; k<equations.size(); k++) {
+		bool former = equations[k]->is_bytecode();
+		equations[k]->set_bytecode(true, true);
+		std::string function_name = "nauticle_equation_"+std::to_string(k);
+		if(equations[k]->generate_code(source, function_name)) {
+			name.push_back(function_name);
+			candidate.push_back(equations[k]);
+			previous.push_back(former);
+		} else {
+			equations[k]->set_bytecode(former);
+		}
+	}
+	auto restore = [&]() {
+		for(int k=0; k<candidate.size(); k++) {
+			candidate[k]->set_bytecode(previous[k]);
+		}
+	};
+	if(candidate.empty()) {
+		ProLog::pLogger::logf<ProLog::LCY>("  No equation can be compiled, the case is interpreted.\n");
+		return true;
+	}
+	std::string code = source.str();
+	std::stringstream hash;
+	hash << std::hex << std::hash<std::string>{}(compiler+" "+flags+"\n"+code);
+	std::string base = directory+"/case_"+hash.str();
+	std::string library = base+".so";
+	if(access(library.c_str(), F_OK)!=0) {
+		mkdir(directory.c_str(), 0755);
+		std::ofstream file{base+".cpp"};
+		file << code;
+		file.close();
+		ProLog::pLogger::logf<ProLog::LCY>("  Compiling case into %s\n", library.c_str());
+		std::string temporary = base+"_"+std::to_string(getpid())+".so";
+		std::string command = compiler+" "+flags+" -o "+temporary+" "+base+".cpp";
+		if(std::system(command.c_str())!=0 || std::rename(temporary.c_str(), library.c_str())!=0) {
+			ProLog::pLogger::warning_msgf("Unable to compile the case with \"%s\".\n", command.c_str());
+			std::remove(temporary.c_str());
+			restore();
+			return false;
+		}
+	} else {
+		ProLog::pLogger::logf<ProLog::LCY>("  Using compiled case %s\n", library.c_str());
+	}
+	handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if(handle==nullptr) {
+		ProLog::pLogger::warning_msgf("Unable to load the compiled case: %s\n", dlerror());
+		restore();
+		return false;
+	}
+	std::vector<pmBytecode::Kernel> kernel;
+	for(int k=0; k<candidate.size(); k++) {
+		void* symbol = dlsym(handle, name[k].c_str());
+		if(symbol==nullptr) {
+			ProLog::pLogger::warning_msgf("Kernel \"%s\" is missing from the compiled case.\n", name[k].c_str());
+			restore();
+			release();
+			return false;
+		}
+		kernel.push_back(reinterpret_cast<pmBytecode::Kernel>(symbol));
+	}
+	for(int k=0; k<candidate.size(); k++) {
+		candidate[k]->set_kernel(kernel[k]);
+		compiled.push_back(candidate[k]);
+		was_bytecode.push_back(previous[k]);
+	}
+	ProLog::pLogger::logf<ProLog::LCY>("  %i of %i equations are compiled.\n", (int)compiled.size(), (int)equations.size());
+	return true;
+}
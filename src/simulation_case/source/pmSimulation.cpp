@@ -21,6 +21,8 @@
 #include "pmSimulation.h"
 #include "pmLog_stream.h"
 #include "pmYAML_processor.h"
+#include "pmThread_pool.h"
+#include "pmRandom.h"
 
 using namespace Nauticle;
 
@@ -30,6 +32,7 @@ using namespace Nauticle;
 void pmSimulation::simulate(size_t const& num_threads) {
 	size_t max_num_threads = std::thread::hardware_concurrency();
 	ProLog::pLogger::logf<ProLog::LGN>("   Number of threads used: %i (%i available)\n", num_threads, max_num_threads);
+	pmThread_pool::instance().resize(num_threads);
 	pmLog_stream log_stream{(int)parameter_space->get_parameter_value("file_start")[0]};
 	log_stream.print_start();
 	double current_time=0;
@@ -58,6 +61,8 @@ void pmSimulation::simulate(size_t const& num_threads) {
 			cas->get_workspace()->get_instance("dt").lock()->set_value(pmTensor{1,1,next_dt});
 			ws_write_case->set_value(pmTensor{1,1,1});
 		}
+		// Random numbers are keyed on the step, not on the thread or evaluation order
+		pmRandom::set_step((uint64_t)ws_all_steps->get_value()[0]);
 		// Solve equations
 		bool success = (this->*solver)(current_time, num_threads); //solver->solve(current_time, num_threads);
 		current_time += next_dt;
@@ -141,6 +146,11 @@ void pmSimulation::read_file(std::string const& filename) {
 	script = yaml_loader->get_script(cas->get_workspace());
 	parameter_space = yaml_loader->get_parameter_space(cas->get_workspace());
 	vtk_write_mode = parameter_space->get_parameter_value("output_format")[0] ? BINARY : ASCII;
+	if(parameter_space->get_parameter_value("bytecode")[0]) {
+		cas->set_bytecode(true);
+	}
+	pmRandom::set_seed((uint64_t)parameter_space->get_parameter_value("random_seed")[0]);
+	cas->set_fused_interactions(parameter_space->get_parameter_value("fuse_interactions")[0]);
 	ProLog::pLogger::log<ProLog::LCY>("  Case initialization is completed.\n");
 	ProLog::pLogger::footer<ProLog::LCY>();
 	ProLog::pLogger::line_feed(1);
@@ -173,8 +183,20 @@ bool pmSimulation::interpreter_solve(double const& current_time, size_t const& n
 	return cas->solve(current_time, num_threads);
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Solves the case with the runtime compiled equations. The case is compiled at the first
+/// call after the neighbour search is updated, since the shapes of the interactions are
+/// determined by evaluation. If the compilation fails, the simulation continues in
+/// interpreter mode.
+/////////////////////////////////////////////////////////////////////////////////////////
 bool pmSimulation::binary_solve(double const& current_time, size_t const& num_threads/*=8*/) {
-	ProLog::pLogger::logf<ProLog::WHT>("Note: Nauticle does not support runtime compilation and binary execution. Simulation has been started in interpreter mode. For runtime compilation, use Jellyfish instead.\n");
-	solver = &pmSimulation::interpreter_solve;
+	if(runtime_compiler.use_count()==0) {
+		if(!cas->get_workspace()->update(num_threads)) { return false; }
+		runtime_compiler = std::make_shared<pmRuntime_compiler>();
+		if(!runtime_compiler->compile(cas->get_equations())) {
+			ProLog::pLogger::logf<ProLog::WHT>("Note: runtime compilation of the case failed. Simulation continues in interpreter mode.\n");
+			solver = &pmSimulation::interpreter_solve;
+		}
+	}
 	return cas->solve(current_time, num_threads);
 }
\ No newline at end of file
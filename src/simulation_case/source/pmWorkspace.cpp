@@ -20,6 +20,7 @@
 
 #include "pmWorkspace.h"
 #include <numeric>
+#include <algorithm>
 #include "pmConstant.h"
 #include "pmVariable.h"
 #include "pmLong_range.h"
@@ -373,27 +374,55 @@ void pmWorkspace::print() const {
 
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Sorts all fields and particle systems in the workspace based on the positions of the 
-/// particles.
+/// particles. The neighbour list and the pair cache are built on num_threads threads.
 /////////////////////////////////////////////////////////////////////////////////////////
-bool pmWorkspace::update() {
+bool pmWorkspace::update(size_t const& num_threads/*=1*/) {
 	std::shared_ptr<pmParticle_system> psys = this->get_particle_system();
 	if(psys->is_up_to_date()) { return true; }
 	std::vector<size_t> del;
 	psys->restrict_particles(del);
 	this->delete_particle_set(del);
-	bool success = psys->update_neighbor_list();
+	bool success = psys->update_neighbor_list(num_threads);
 	if(!success) { return false; }
 	if(num_nodes==0) {
 		ProLog::pLogger::error_msgf("Workspace size cannot be set to zero.\n");
 	}
 	if(success) {
 		for(auto& it:interactions) {
-			it->update();
+			it->update(0, num_threads);
 		}
 	}
+	psys->build_pair_cache(num_threads);
 	return success;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Reorders the particles along the Morton curve of the grid cells if it is due. All fields
+/// and pairwise connections are permuted accordingly. The applied order is returned in the
+/// order vector. Returns true if the particles are reordered.
+/////////////////////////////////////////////////////////////////////////////////////////
+bool pmWorkspace::sort_particles(std::vector<int>& order) {
+	std::shared_ptr<pmParticle_system> psys = this->get_particle_system();
+	if(!psys->is_sorting_due()) { return false; }
+	order = psys->get_spatial_order();
+	for(auto& it:this->get<pmField>()) {
+		it->reorder(order);
+	}
+	for(auto& it:interactions) {
+		it->reorder(order);
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Advances the time levels of all fields. Called once at the beginning of each step.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmWorkspace::advance_time_levels() {
+	for(auto& it:this->get<pmField>(true)) {
+		it->advance_levels();
+	}
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Returns the vector of definitions
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -559,6 +588,69 @@ void pmWorkspace::duplicate_particle(size_t const& i) {
 	num_particles->set_value(pmTensor{1,1,(double)num_nodes});
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Records the birth of a copy of the given parent particle. The new particle is created
+/// by commit_particles and its index is returned. The number of particles counts the
+/// recorded births already.
+/////////////////////////////////////////////////////////////////////////////////////////
+size_t pmWorkspace::record_birth(size_t const& parent) {
+	birth_parent.push_back(parent);
+	size_t i = num_nodes+birth_parent.size()-1;
+	num_particles->set_value(pmTensor{1,1,(double)(i+1)});
+	return i;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Records the value of the ith member of the given field. The value is set by
+/// commit_particles after the recorded births, hence i may refer to a new particle.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmWorkspace::record_value(std::shared_ptr<pmField> const& field, pmTensor const& value, size_t const& i) {
+	recorded_value.push_back(pmRecorded_value{field, value, i});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Records the deletion of the ith particle. The particle is deleted by commit_particles.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmWorkspace::record_death(size_t const& i) {
+	death.push_back(i);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Applies the recorded births, values and deaths. All fields are resized and filled
+/// once for the births, then the recorded values are set and the recorded particles
+/// are deleted at once.
+/////////////////////////////////////////////////////////////////////////////////////////
+void pmWorkspace::commit_particles(size_t const& num_threads/*=1*/) {
+	if(!birth_parent.empty()) {
+		for(auto& it:this->get<pmField>()) {
+			it->append_members(birth_parent, num_threads);
+			if(it->get_name()=="id") {
+				for(size_t i=num_nodes; i<num_nodes+birth_parent.size(); i++) {
+					if(deleted_ids.empty()) {
+						it->set_value(pmTensor{1,1,(double)i},i);
+					} else {
+						it->set_value(pmTensor{1,1,(double)deleted_ids.top()},i);
+						deleted_ids.pop();
+					}
+				}
+			}
+		}
+		num_nodes += birth_parent.size();
+		num_particles->set_value(pmTensor{1,1,(double)num_nodes});
+		birth_parent.clear();
+	}
+	for(auto const& it:recorded_value) {
+		it.field->set_value(it.value,it.index);
+	}
+	recorded_value.clear();
+	if(!death.empty()) {
+		std::sort(death.begin(), death.end());
+		death.erase(std::unique(death.begin(), death.end()), death.end());
+		this->delete_particle_set(death);
+		death.clear();
+	}
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 /// Returns true if the particle number changed since the last check.
 /////////////////////////////////////////////////////////////////////////////////////////